@@ -76,6 +76,11 @@ volatile uint8_t Bluetooth::txIndex = 0;
 volatile uint8_t Bluetooth::rxInBuffer = 0;
 volatile uint8_t Bluetooth::txInBuffer = 0;
 volatile bool Bluetooth::txComplete = true;
+volatile bool Bluetooth::rxOverflow = false;
+volatile bool Bluetooth::rxResync = false;
+volatile uint8_t Bluetooth::rxResyncIndex = 0;
+volatile uint16_t Bluetooth::rxLastByte = 0;
+volatile uint16_t Bluetooth::RxDropped = 0;
 
 const char newLine[] = { 0x0D,0x0A };
 
@@ -232,7 +237,7 @@ bool Bluetooth::HasData()
 bool Bluetooth::ReadByte(uint8_t& destination)
 {
     bool retval = false;
-    if (rxInBuffer != rxIndex)
+    if ((rxInBuffer != rxIndex) && !rxOverflow)
     {
         destination = rxBuffer[rxInBuffer];
         rxInBuffer++;
@@ -253,6 +258,30 @@ uint8_t Bluetooth::read()
     return byte;
 }
 
+bool Bluetooth::TakeRxOverflow()
+{
+    uint16_t state = __get_interrupt_state();
+    __disable_interrupt();
+    bool overflow = rxOverflow;
+    if (overflow)
+    {
+        // The bytes before the hole belong to a message that cannot be finished. Once the line has gone quiet
+        // the bytes from rxResyncIndex on start a new one, so they stay.
+        rxInBuffer = rxResync ? rxIndex : rxResyncIndex;
+        rxOverflow = false;
+    }
+    __set_interrupt_state(state);
+    return overflow;
+}
+
+void Bluetooth::FlushRx()
+{
+    uint16_t state = __get_interrupt_state();
+    __disable_interrupt();
+    rxInBuffer = rxIndex;
+    __set_interrupt_state(state);
+}
+
 
 /************************************************************************/
 /*                      Implementation (INTERRUPTS)                     */
@@ -272,17 +301,46 @@ void __attribute__((interrupt(USCI_A0_VECTOR))) USCI0RX_ISR(void)
     {
     case  0: break;                          // No interrupt
     case  2:                                  // rx buffer full
-        // get char from hardware buffer
-        Bluetooth::rxBuffer[Bluetooth::rxIndex] = UCA0RXBUF_L;
+    {
+        // get char from hardware buffer, which also clears the interrupt
+        uint8_t data = UCA0RXBUF_L;
+        uint16_t now = FRAME_TIMER_COUNT;
+        uint16_t quiet = now - Bluetooth::rxLastByte;
+        Bluetooth::rxLastByte = now;
 
-        // update the insertion point
-        Bluetooth::rxIndex++;
-        if (Bluetooth::rxIndex >= BT_BUFFER_LEN)
+        if (Bluetooth::rxResync)
         {
-            Bluetooth::rxIndex = 0;
+            // The message the overflow cut into goes on for as long as the bytes keep coming. A quiet spell longer
+            // than FRAME_TIMER wraps can read as short, which only means waiting for the next one.
+            if (quiet < BT_RESYNC_GAP)
+            {
+                Bluetooth::RxDropped++;
+                break;
+            }
+            // the line was quiet, so this byte starts a message
+            Bluetooth::rxResync = false;
+            Bluetooth::rxResyncIndex = Bluetooth::rxIndex;
+        }
+
+        uint8_t next = Bluetooth::rxIndex + 1;
+        if (next >= BT_BUFFER_LEN)
+        {
+            next = 0;
+        }
+        if (next == Bluetooth::rxInBuffer)
+        {
+            // the ring is full: drop the new byte rather than write over bytes not read yet
+            Bluetooth::RxDropped++;
+            Bluetooth::rxOverflow = true;
+            Bluetooth::rxResync = true;
+            break;
         }
 
+        Bluetooth::rxBuffer[Bluetooth::rxIndex] = data;
+        // update the insertion point
+        Bluetooth::rxIndex = next;
         break;
+    }
     case  4:                                // Tx buffer empty
         if (Bluetooth::txInBuffer != Bluetooth::txIndex)
         {
@@ -25,6 +25,9 @@
 /*                         #define declarations                         */
 /************************************************************************/
 #define BT_BUFFER_LEN   128
+// FRAME_TIMER ticks (1us) of silence on the line that mark the start of a message after an RX overflow.
+// A byte takes 1042us at 9600 baud and the bytes of a message come back to back, so this is about 3 bytes.
+#define BT_RESYNC_GAP   3000
 
 /************************************************************************/
 /*                         Forward declarations                         */
@@ -59,7 +62,20 @@ class Bluetooth
 
     volatile static bool txComplete;
 
+    // set when a byte is dropped because the RX ring is full, cleared by TakeRxOverflow()
+    volatile static bool rxOverflow;
+    // set by an RX overflow: bytes are dropped until the line has been quiet for BT_RESYNC_GAP
+    volatile static bool rxResync;
+    // where the first byte after the last quiet spell went in the ring, while resyncing
+    volatile static uint8_t rxResyncIndex;
+    // FRAME_TIMER_COUNT when the last byte came in
+    volatile static uint16_t rxLastByte;
+
 public:
+    // bytes dropped because the RX ring was full, or while waiting for the line to go quiet after that,
+    // since this was last cleared
+    volatile static uint16_t RxDropped;
+
     static void Init();
     static void Send(const char* buffer, int length);
     static void print(const char* buffer);
@@ -67,8 +83,19 @@ public:
     static void println(uint32_t val);
     static void println(const char* buffer);
     static bool HasData();
+    // @return bool: false if the ring is empty, or the next byte comes after a hole left by an RX overflow.
+    //               Nothing more is read until TakeRxOverflow() and FlushRx().
     static bool ReadByte(uint8_t& destination);
     static uint8_t read();
+
+    // After an RX overflow the bytes after the hole are dropped too, until the line goes quiet for BT_RESYNC_GAP,
+    // so the first byte kept after it starts a message. The bytes before the hole are thrown away here.
+    // @return bool: true if RX bytes were dropped since the last call, so the message being received has a hole
+    //               in it. The next byte read starts a message.
+    static bool TakeRxOverflow();
+
+    // Throw away every received byte not read yet
+    static void FlushRx();
 };
 
 /************************************************************************/
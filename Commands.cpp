@@ -0,0 +1,257 @@
+/**
+* @brief      Bluetooth commands from the phone app
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    processCommands() parses the LEDCommands messages in the bluetooth RX ring and runs them on the halo.
+*               Each message is a command byte and its bytes, see commandBuffer. A message is taken a byte at a time
+*               as the bytes come in, so Loop() never waits for the rest of one.
+*               After an RX overflow the message with the hole in it is dropped, and parsing starts again at the
+*               first byte after the line goes quiet (Bluetooth::TakeRxOverflow()).
+*
+*               Kept out of main.cpp so the host tools can run the same parser.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "LaserTarget.h"
+#include "HaloVM.h"
+#include "HaloPack.h"
+#include "HaloStream.h"
+#include "HaloEffect.h"
+#include "HaloCompositor.h"
+#include "Bluetooth.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+
+// LEDCommands message being received over bluetooth. 0 while waiting for a command byte
+uint8_t commandId = 0;
+// message bytes received after the command byte
+uint8_t commandReceived = 0;
+// message bytes after the command byte. STORE_PATTERN: slot, length, pattern. STREAM_FRAME: sequence, length, records.
+// PLAY_EFFECT: effect, red, green, blue, speed, param, seed high byte, seed low byte
+// STORE_PACK: pack slot, offset high byte, offset low byte, length, pack bytes. A length of 0 finishes the pack.
+// PLAY_PACK: pack slot
+uint8_t commandBuffer[PATTERN_SLOT_SIZE + 1];
+static_assert(HALO_STREAM_FRAME_BYTES + 2 <= PATTERN_SLOT_SIZE + 1, "a streamed frame does not fit the command buffer");
+static_assert(HALO_PACK_PART_MAX + 4 <= PATTERN_SLOT_SIZE + 1, "a pack part does not fit the command buffer");
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+void processCommands(void)
+{
+    if (Bluetooth::TakeRxOverflow())
+    {
+        // Bytes were lost, so the message being received has a hole in it. Bluetooth has thrown away what came
+        // before the hole, and drops what follows until the line goes quiet, so the next byte is a command.
+        // A stream picks up again at its next keyframe, and the phone resends a pack part it gets no reply for.
+        commandId = 0;
+        Bluetooth::println("Bluetooth RX overflow");
+    }
+
+    uint8_t byte;
+    while (Bluetooth::ReadByte(byte))
+    {
+        if (0 == commandId)
+        {
+            commandId = byte;
+            commandReceived = 0;
+
+            if (PLAY_IDLE == commandId)
+            {
+                // back to the idle animation
+                HaloVM::Stop();
+                HaloPack::Stop();
+                HaloStream::Stop();
+                HaloEffect::Stop();
+                restartAnimation();
+                commandId = 0;
+            }
+            else if ((STORE_PATTERN != commandId) && (PLAY_PATTERN != commandId) && (STREAM_FRAME != commandId)
+                && (PLAY_EFFECT != commandId) && (STORE_PACK != commandId) && (PLAY_PACK != commandId))
+            {
+                // not a command we handle, wait for the next one
+                commandId = 0;
+            }
+            continue;
+        }
+
+        commandBuffer[commandReceived++] = byte;
+
+        switch (commandId)
+        {
+        case PLAY_PATTERN:
+            // slot
+            if (HaloVM::LoadSlot(commandBuffer[0]))
+            {
+                HaloPack::Stop();
+                HaloStream::Stop();
+                HaloEffect::Stop();
+            }
+            else
+            {
+                Bluetooth::println("Pattern slot empty");
+            }
+            restartAnimation();
+            commandId = 0;
+            break;
+
+        case PLAY_PACK:
+            // slot
+            if (HaloPack::LoadStored(commandBuffer[0]))
+            {
+                HaloVM::Stop();
+                HaloStream::Stop();
+                HaloEffect::Stop();
+            }
+            else
+            {
+                Bluetooth::println("Pack slot empty");
+            }
+            restartAnimation();
+            commandId = 0;
+            break;
+
+        case STORE_PATTERN:
+            // slot, length, then the pattern itself
+            if (2 == commandReceived)
+            {
+                if ((0 == commandBuffer[1]) || (commandBuffer[1] >= PATTERN_SLOT_SIZE))
+                {
+                    Bluetooth::println("Pattern too long");
+                    commandId = 0;
+                }
+            }
+            else if ((commandReceived > 2) && (commandReceived == commandBuffer[1] + 2))
+            {
+                if (HaloVM::StorePattern(commandBuffer[0], &commandBuffer[2], commandBuffer[1]))
+                {
+                    Bluetooth::println("Pattern stored");
+                }
+                else
+                {
+                    Bluetooth::println("Pattern slot invalid");
+                }
+                commandId = 0;
+            }
+            break;
+
+        case STREAM_FRAME:
+            // sequence, length and keyframe flag, then the records
+            if (2 == commandReceived)
+            {
+                uint8_t length = commandBuffer[1] & ~HALO_STREAM_KEYFRAME;
+                if ((0 == length) || (length > HALO_STREAM_FRAME_BYTES))
+                {
+                    Bluetooth::println("Stream frame too long");
+                    commandId = 0;
+                }
+            }
+            else if ((commandReceived > 2) && (commandReceived == (commandBuffer[1] & ~HALO_STREAM_KEYFRAME) + 2))
+            {
+                // the jitter buffer counts the frames it drops
+                HaloStream::Push(commandBuffer[0], commandBuffer[1], &commandBuffer[2]);
+                commandId = 0;
+            }
+            break;
+
+        case PLAY_EFFECT:
+            // effect, red, green, blue, speed, param, seed
+            if (8 == commandReceived)
+            {
+                // the same seed plays the effect the same way every time
+                HaloEffect::Seed(((uint16_t)commandBuffer[6] << 8) | commandBuffer[7]);
+                HaloRGB color = HaloRGB{ commandBuffer[1], commandBuffer[2], commandBuffer[3] };
+                if (HaloEffect::Start((HaloEffectId)commandBuffer[0], color, commandBuffer[4], commandBuffer[5]))
+                {
+                    HaloVM::Stop();
+                    HaloPack::Stop();
+                    HaloStream::Stop();
+                }
+                else
+                {
+                    Bluetooth::println("Effect unknown");
+                }
+                restartAnimation();
+                commandId = 0;
+            }
+            break;
+
+        case STORE_PACK:
+            // slot, offset, length, then the part of the pack
+            if (4 == commandReceived)
+            {
+                if (0 == commandBuffer[3])
+                {
+                    Bluetooth::println(HaloPack::FinishStore(commandBuffer[0]) ? "Pack stored" : "Pack invalid");
+                    commandId = 0;
+                }
+                else if (commandBuffer[3] > HALO_PACK_PART_MAX)
+                {
+                    Bluetooth::println("Pack part too long");
+                    commandId = 0;
+                }
+            }
+            else if ((commandReceived > 4) && (commandReceived == commandBuffer[3] + 4))
+            {
+                uint16_t offset = ((uint16_t)commandBuffer[1] << 8) | commandBuffer[2];
+                // the phone waits for the reply before it sends the next part
+                if (HaloPack::StorePart(commandBuffer[0], offset, &commandBuffer[4], commandBuffer[3]))
+                {
+                    Bluetooth::println("Pack part stored");
+                }
+                else
+                {
+                    Bluetooth::println("Pack part rejected");
+                }
+                commandId = 0;
+            }
+            break;
+
+        default:
+            commandId = 0;
+            break;
+        }
+    }
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
@@ -0,0 +1,164 @@
+/**
+* @brief      Integer HSV and color wheel kernels for the halo
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    8-bit HSV to RGB conversion, blending and heat colors without a single division.
+*               The MSP430 has no FPU and no hardware divider, so the hue sectors come from multiplying by 6
+*               with shifts, and every "/ 255" is replaced by Scale8(). The kernels are constexpr so
+*               they can be checked against a floating point reference at compile time.
+*               The fill routines draw into a HaloLayer, so HaloCompositor blends them and puts them through the
+*               gamma table like any other layer.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "HaloColorWheel.h"
+#include "HaloFramebuffer.h"
+#include "HaloGamma.h"
+#include "HaloCompositor.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// largest difference allowed between HsvToRgb() and the floating point reference, in levels
+#define HSV_MAX_ERROR 2
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// Textbook floating point HSV to RGB for one channel, the reference for HsvToRgb().
+// Only ever evaluated by the compiler.
+// @param channel: 0 red, 1 green, 2 blue
+constexpr double ReferenceHsv(uint8_t hue, uint8_t sat, uint8_t val, uint8_t channel)
+{
+    double h = hue * 6.0 / 256.0;
+    uint8_t sector = (uint8_t)h;
+    double f = h - sector;
+    double s = sat / 255.0;
+    double v = val;
+
+    double p = v * (1.0 - s);
+    double q = v * (1.0 - s * f);
+    double t = v * (1.0 - s * (1.0 - f));
+
+    // sector by sector: red, green, blue
+    const double rgb[6][3] = {
+        { v, t, p }, { q, v, p }, { p, v, t }, { p, q, v }, { t, p, v }, { v, p, q }
+    };
+    return rgb[sector][channel];
+}
+
+// @return double: the worst channel error of HsvToRgb() over every hue, for a spread of saturations and values
+constexpr double HsvMaxError()
+{
+    double worst = 0.0;
+    for (uint16_t sat = 0; sat < 256; sat += 51)
+    {
+        for (uint16_t val = 0; val < 256; val += 51)
+        {
+            for (uint16_t hue = 0; hue < 256; hue++)
+            {
+                HaloRGB rgb = HsvToRgb(hue, sat, val);
+                const uint8_t channels[3] = { rgb.Red, rgb.Green, rgb.Blue };
+                for (uint8_t c = 0; c < 3; c++)
+                {
+                    double error = channels[c] - ReferenceHsv(hue, sat, val, c);
+                    if (error < 0.0)
+                    {
+                        error = -error;
+                    }
+                    if (error > worst)
+                    {
+                        worst = error;
+                    }
+                }
+            }
+        }
+    }
+    return worst;
+}
+
+static_assert(HsvMaxError() <= HSV_MAX_ERROR, "HsvToRgb is too far from the floating point reference");
+
+// the primaries have to be exact
+static_assert(ColorWheel(0).Red == 255 && ColorWheel(0).Green == 0 && ColorWheel(0).Blue == 0,
+    "color wheel does not start at red");
+static_assert(HsvToRgb(0, 0, 255).Red == 255 && HsvToRgb(0, 0, 255).Green == 255 && HsvToRgb(0, 0, 255).Blue == 255,
+    "zero saturation is not white");
+static_assert(HeatColor(255).Red == 255 && HeatColor(255).Green == 255 && HeatColor(255).Blue == 253,
+    "heat scale does not end near white");
+static_assert(BlendRGB(HaloRGB{ 10, 20, 30 }, HaloRGB{ 200, 100, 0 }, 255).Red == 200
+    && BlendRGB(HaloRGB{ 10, 20, 30 }, HaloRGB{ 200, 100, 0 }, 0).Blue == 30,
+    "blend end points are wrong");
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+HaloColorWheel::HaloColorWheel()
+{
+}
+
+HaloColorWheel::~HaloColorWheel()
+{
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+void HaloColorWheel::SetPixel(uint8_t led, HaloRGB color)
+{
+    HaloFrame.SetPixel(led, HaloGamma::ToGS(color.Red), HaloGamma::ToGS(color.Green), HaloGamma::ToGS(color.Blue));
+}
+
+void HaloColorWheel::FillRainbow(HaloLayer& layer, uint8_t startHue, uint8_t hueStep, uint8_t sat, uint8_t val)
+{
+    uint8_t hue = startHue;
+    for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+    {
+        layer.SetPixel(led, HsvToRgb(hue, sat, val));
+        // wraps around the wheel
+        hue += hueStep;
+    }
+}
+
+void HaloColorWheel::FillHeat(HaloLayer& layer, const uint8_t* temperatures)
+{
+    for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+    {
+        layer.SetPixel(led, HeatColor(temperatures[led]));
+    }
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
@@ -0,0 +1,149 @@
+/**
+* @brief      Integer HSV and color wheel kernels for the halo
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    8-bit HSV to RGB conversion, blending and heat colors without a single division.
+*               The MSP430 has no FPU and no hardware divider, so the hue sectors come from multiplying by 6
+*               with shifts, and every "/ 255" is replaced by Scale8(). The kernels are constexpr so
+*               they can be checked against a floating point reference at compile time.
+*               The fill routines draw into a HaloLayer, so HaloCompositor blends them and puts them through the
+*               gamma table like any other layer.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef HALO_COLOR_WHEEL_H
+#define HALO_COLOR_WHEEL_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+class HaloLayer;
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// A color as 8-bit intensity levels
+struct HaloRGB
+{
+	uint8_t Red;
+	uint8_t Green;
+	uint8_t Blue;
+};
+
+// @return uint8_t: value * scale / 256, with a scale of 255 leaving the value untouched.
+constexpr uint8_t Scale8(uint8_t value, uint8_t scale)
+{
+	return (uint8_t)(((uint16_t)value * (uint16_t)(scale + 1)) >> 8);
+}
+
+// Convert a hue, saturation, value color to RGB.
+// @param hue: 0 - 255 goes once around the color wheel, starting and ending at red
+// @param sat: 0 is white, 255 is the pure hue
+// @param val: brightness
+constexpr HaloRGB HsvToRgb(uint8_t hue, uint8_t sat, uint8_t val)
+{
+	// hue * 6 splits the wheel into 6 sectors of 256 steps: the sector is the high byte, the position in it the low byte
+	uint16_t hue6 = ((uint16_t)hue << 2) + ((uint16_t)hue << 1);
+	uint8_t sector = hue6 >> 8;
+	uint8_t fraction = hue6 & 0xFF;
+
+	uint8_t p = Scale8(val, 255 - sat);
+	uint8_t q = Scale8(val, 255 - Scale8(sat, fraction));
+	uint8_t t = Scale8(val, 255 - Scale8(sat, 255 - fraction));
+
+	switch (sector)
+	{
+	case 0: return HaloRGB{ val, t, p };
+	case 1: return HaloRGB{ q, val, p };
+	case 2: return HaloRGB{ p, val, t };
+	case 3: return HaloRGB{ p, q, val };
+	case 4: return HaloRGB{ t, p, val };
+	default: return HaloRGB{ val, p, q };
+	}
+}
+
+// @return HaloRGB: the fully saturated, full brightness color at a position on the color wheel
+constexpr HaloRGB ColorWheel(uint8_t position)
+{
+	return HsvToRgb(position, 255, 255);
+}
+
+// Linear interpolation between two colors.
+// @param amount: 0 returns from, 255 returns to
+constexpr HaloRGB BlendRGB(HaloRGB from, HaloRGB to, uint8_t amount)
+{
+	return HaloRGB{
+		(uint8_t)(from.Red - Scale8(from.Red, amount) + Scale8(to.Red, amount)),
+		(uint8_t)(from.Green - Scale8(from.Green, amount) + Scale8(to.Green, amount)),
+		(uint8_t)(from.Blue - Scale8(from.Blue, amount) + Scale8(to.Blue, amount))
+	};
+}
+
+// Black body style "heat" color: black, red, yellow, then white as the temperature rises.
+constexpr HaloRGB HeatColor(uint8_t temperature)
+{
+	// temperature * 3 splits the scale into 3 ramps of 256 steps
+	uint16_t heat3 = ((uint16_t)temperature << 1) + temperature;
+	uint8_t ramp = heat3 & 0xFF;
+
+	switch (heat3 >> 8)
+	{
+	case 0: return HaloRGB{ ramp, 0, 0 };
+	case 1: return HaloRGB{ 255, ramp, 0 };
+	default: return HaloRGB{ 255, 255, ramp };
+	}
+}
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+class HaloColorWheel
+{
+	HaloColorWheel();
+	~HaloColorWheel();
+
+public:
+
+	// Set one halo LED to a color, through the gamma table. This is the framebuffer write of HaloCompositor::Render(),
+	// patterns draw into a layer.
+	// @param led: halo position. Zero indexed.
+	static void SetPixel(uint8_t led, HaloRGB color);
+
+	// Spread the color wheel around the halo.
+	// @param layer: the layer to draw every LED of
+	// @param startHue: hue of LED 0
+	// @param hueStep: hue change from one LED to the next. 256 / RGB_LED_COUNT shows the whole wheel once.
+	// @param sat: saturation of every LED
+	// @param val: brightness of every LED
+	static void FillRainbow(HaloLayer& layer, uint8_t startHue, uint8_t hueStep, uint8_t sat, uint8_t val);
+
+	// Color every LED from its own temperature.
+	// @param layer: the layer to draw every LED of
+	// @param temperatures: one temperature per LED, RGB_LED_COUNT of them
+	static void FillHeat(HaloLayer& layer, const uint8_t* temperatures);
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !HALO_COLOR_WHEEL_H
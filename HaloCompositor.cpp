@@ -0,0 +1,273 @@
+/**
+* @brief      Layered halo compositor
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Patterns draw into layers of 8-bit colors instead of writing the framebuffer themselves.
+*               Once per frame Render() stacks the layers (idle background, game state, hit flash) with each
+*               layer's alpha and LED mask, runs the result through the gamma table into HaloFrame and flushes it.
+*               A hit flash therefore shows on the very next frame, and the idle animation keeps running under it.
+*               The flash fades by the time that has passed on TimeBase, not by the number of Render() calls, so it
+*               lasts as long at any pattern frame rate, with or without the boosted redraws.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "LaserTarget.h"
+#include "HaloCompositor.h"
+#include "HaloFramebuffer.h"
+#include "HaloColorWheel.h"
+#include "TimeBase.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+#ifdef HALO_HOST_RENDER
+#define COUNT_WORK(counter, count) (HaloCompositor::Work.counter += (count))
+#else
+#define COUNT_WORK(counter, count)
+#endif
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+HaloLayer HaloCompositor::layers[(uint8_t)HaloLayerId::Count];
+bool HaloCompositor::presented = false;
+uint32_t HaloCompositor::flashTime = 0;
+uint16_t HaloCompositor::RenderTicksMax = 0;
+#ifdef HALO_HOST_RENDER
+HaloCompositorWork HaloCompositor::Work;
+#endif
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+HaloCompositor::HaloCompositor()
+{
+}
+
+HaloCompositor::~HaloCompositor()
+{
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+HaloLayer::HaloLayer() : Alpha(0xFF)
+{
+    Clear();
+}
+
+void HaloLayer::Clear()
+{
+    for (uint8_t i = HALO_LAYER_MASK_BYTES; i-- > 0;)
+    {
+        Mask[i] = 0;
+    }
+}
+
+void HaloLayer::SetPixel(uint8_t led, HaloRGB color)
+{
+    Pixels[led] = color;
+    Mask[led >> 3] |= (1 << (led & 0x07));
+    COUNT_WORK(LayerPixels, 1);
+}
+
+void HaloLayer::ClearPixel(uint8_t led)
+{
+    Mask[led >> 3] &= ~(1 << (led & 0x07));
+}
+
+void HaloLayer::Fill(HaloRGB color)
+{
+    for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+    {
+        Pixels[led] = color;
+    }
+    for (uint8_t i = HALO_LAYER_MASK_BYTES; i-- > 0;)
+    {
+        Mask[i] = 0xFF;
+    }
+    COUNT_WORK(LayerPixels, RGB_LED_COUNT);
+}
+
+bool HaloLayer::GetPixel(uint8_t led, HaloRGB& color) const
+{
+    if (0 == (Mask[led >> 3] & (1 << (led & 0x07))))
+    {
+        color = HaloRGB{ 0, 0, 0 };
+        return false;
+    }
+
+    color = Pixels[led];
+    return true;
+}
+
+void HaloLayer::Rotate(uint8_t steps)
+{
+    for (steps %= RGB_LED_COUNT; steps > 0; steps--)
+    {
+        // the last LED wraps around to the first
+        HaloRGB wrapped;
+        bool wrappedDrawn = GetPixel(RGB_LED_COUNT - 1, wrapped);
+
+        for (uint8_t led = RGB_LED_COUNT - 1; led > 0; led--)
+        {
+            HaloRGB color;
+            if (GetPixel(led - 1, color))
+            {
+                SetPixel(led, color);
+            }
+            else
+            {
+                ClearPixel(led);
+            }
+        }
+
+        if (wrappedDrawn)
+        {
+            SetPixel(0, wrapped);
+        }
+        else
+        {
+            ClearPixel(0);
+        }
+    }
+}
+
+bool HaloLayer::Empty() const
+{
+    if (0 == Alpha)
+    {
+        return true;
+    }
+
+    for (uint8_t i = HALO_LAYER_MASK_BYTES; i-- > 0;)
+    {
+        if (0 != Mask[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+HaloLayer& HaloCompositor::Layer(HaloLayerId id)
+{
+    return layers[(uint8_t)id];
+}
+
+void HaloCompositor::Flash(HaloRGB color)
+{
+    HaloLayer& flash = layers[(uint8_t)HaloLayerId::HitFlash];
+    flash.Fill(color);
+    flash.Alpha = 0xFF;
+    flashTime = TimeBase::Now();
+}
+
+bool HaloCompositor::OverlaysEmpty()
+{
+    for (uint8_t id = (uint8_t)HaloLayerId::Background + 1; id < (uint8_t)HaloLayerId::Count; id++)
+    {
+        if (!layers[id].Empty())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void HaloCompositor::Presented()
+{
+    presented = true;
+}
+
+bool HaloCompositor::Render()
+{
+    uint16_t start = FRAME_TIMER_COUNT;
+    bool sent = false;
+
+    if (presented)
+    {
+        presented = false;
+    }
+    else
+    {
+        for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+        {
+            // LEDs no layer draws are off
+            HaloRGB out = { 0, 0, 0 };
+            for (uint8_t id = 0; id < (uint8_t)HaloLayerId::Count; id++)
+            {
+                const HaloLayer& layer = layers[id];
+                HaloRGB color;
+                if ((0 != layer.Alpha) && layer.GetPixel(led, color))
+                {
+                    out = (0xFF == layer.Alpha) ? color : BlendRGB(out, color, layer.Alpha);
+                }
+            }
+            HaloColorWheel::SetPixel(led, out);
+        }
+        COUNT_WORK(Composed, RGB_LED_COUNT);
+
+        sent = HaloFrame.Flush();
+        COUNT_WORK(Flushed, sent ? 1 : 0);
+    }
+
+    // The hit flash fades out on its own, one step per HIT_FLASH_STEP_TICKS that have passed.
+    // A late Render() catches up, a boosted redraw between steps leaves it as it is.
+    HaloLayer& flash = layers[(uint8_t)HaloLayerId::HitFlash];
+    if (0 != flash.Alpha)
+    {
+        uint32_t now = TimeBase::Now();
+        while ((0 != flash.Alpha) && (now - flashTime >= HIT_FLASH_STEP_TICKS))
+        {
+            flashTime += HIT_FLASH_STEP_TICKS;
+            flash.Alpha = Scale8(flash.Alpha, HIT_FLASH_DECAY);
+            if (flash.Alpha < HIT_FLASH_CUTOFF)
+            {
+                flash.Alpha = 0;
+            }
+        }
+    }
+
+    uint16_t ticks = FRAME_TIMER_COUNT - start;
+    if (ticks > RenderTicksMax)
+    {
+        RenderTicksMax = ticks;
+    }
+
+    return sent;
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
@@ -0,0 +1,169 @@
+/**
+* @brief      Layered halo compositor
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Patterns draw into layers of 8-bit colors instead of writing the framebuffer themselves.
+*               Once per frame Render() stacks the layers (idle background, game state, hit flash) with each
+*               layer's alpha and LED mask, runs the result through the gamma table into HaloFrame and flushes it.
+*               A hit flash therefore shows on the very next frame, and the idle animation keeps running under it.
+*               The flash fades by the time that has passed on TimeBase, not by the number of Render() calls, so it
+*               lasts as long at any pattern frame rate, with or without the boosted redraws.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef HALO_COMPOSITOR_H
+#define HALO_COMPOSITOR_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+
+#include "HaloFramebuffer.h"
+#include "HaloColorWheel.h"
+#include "HaloFrameRate.h"
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// one mask bit per LED
+#define HALO_LAYER_MASK_BYTES ((RGB_LED_COUNT + 7) / 8)
+
+// hit flash alpha is scaled by this / 256 every HIT_FLASH_STEP_TICKS
+#define HIT_FLASH_DECAY 200
+// FRAME_TIMER ticks (1us) per hit flash decay step, the HALO_FPS_BOOST redraw period
+#define HIT_FLASH_STEP_TICKS (FRAME_TIMER_HZ / HALO_FPS_BOOST)
+// hit flash alpha below this is switched off
+#define HIT_FLASH_CUTOFF 8
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// Layers from the bottom up. Higher layers cover lower ones.
+enum class HaloLayerId : uint8_t
+{
+	// idle animation and played patterns
+	Background,
+	// game mode status
+	GameState,
+	// transient hit feedback
+	HitFlash,
+	Count
+};
+
+#ifdef HALO_HOST_RENDER
+// What the layers and the compositor did since this was last cleared, for the cost model in tools/halorender
+struct HaloCompositorWork
+{
+	// LEDs drawn into a layer
+	uint16_t LayerPixels;
+	// LEDs blended into the framebuffer
+	uint16_t Composed;
+	// frames built into transfer words and sent by Render()
+	uint16_t Flushed;
+};
+#endif
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+// One layer of the halo: a color and a "drawn" mask bit per LED, and an alpha for the whole layer
+class HaloLayer
+{
+	// layer colors, as intensity levels
+	HaloRGB Pixels[RGB_LED_COUNT];
+	// bit n set when LED n is drawn on this layer. LEDs that are not drawn show the layers below.
+	uint8_t Mask[HALO_LAYER_MASK_BYTES];
+
+public:
+	// how much of the layer shows over the layers below. 0 hides it, 255 covers them.
+	uint8_t Alpha;
+
+	// Starts out transparent everywhere, at full alpha
+	HaloLayer();
+
+	// Make every LED transparent
+	void Clear();
+
+	// Draw one LED.
+	// @param led: halo position. Zero indexed.
+	void SetPixel(uint8_t led, HaloRGB color);
+
+	// Make one LED transparent.
+	// @param led: halo position. Zero indexed.
+	void ClearPixel(uint8_t led);
+
+	// Draw every LED
+	void Fill(HaloRGB color);
+
+	// Read back one LED.
+	// @param led: halo position. Zero indexed.
+	// @param color: receives the LED color. Black when it is not drawn.
+	// @return bool: true if the LED is drawn on this layer
+	bool GetPixel(uint8_t led, HaloRGB& color) const;
+
+	// Move every LED, drawn or not, around the halo, wrapping at the end.
+	// @param steps: positions to move each LED towards the higher positions
+	void Rotate(uint8_t steps);
+
+	// @return bool: true if the layer has no effect on the halo: nothing drawn, or fully transparent.
+	bool Empty() const;
+};
+
+class HaloCompositor
+{
+	HaloCompositor();
+	~HaloCompositor();
+
+	static HaloLayer layers[(uint8_t)HaloLayerId::Count];
+
+	// true when the halo already shows the current frame, so the next Render() has nothing to do
+	static bool presented;
+
+	// TimeBase time the hit flash alpha was last decayed up to
+	static uint32_t flashTime;
+
+public:
+	// longest Render() since this was last cleared, in FRAME_TIMER ticks (1us)
+	static uint16_t RenderTicksMax;
+#ifdef HALO_HOST_RENDER
+	static HaloCompositorWork Work;
+#endif
+
+	// @return HaloLayer&: the layer to draw into
+	static HaloLayer& Layer(HaloLayerId id);
+
+	// Flash the whole halo, fading out over the next frames.
+	static void Flash(HaloRGB color);
+
+	// @return bool: true if only the background layer affects the halo
+	static bool OverlaysEmpty();
+
+	// Tell the compositor the halo already shows this frame, because a pattern sent it directly
+	// (HaloFramebuffer::Replay()). Only valid while OverlaysEmpty().
+	static void Presented();
+
+	// Blend the layers into HaloFrame and flush it. Call once per frame, after the patterns have drawn.
+	// @return bool: true if a frame was sent to the halo.
+	static bool Render();
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !HALO_COMPOSITOR_H
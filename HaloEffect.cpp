@@ -0,0 +1,304 @@
+/**
+* @brief      Procedural halo effects
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Comet, breathe, sparkle and wipe, worked out every frame in integer math instead of stored as
+*               a pattern. Each effect keeps one 8-bit brightness level per LED, moves it on one step every few
+*               frame ticks, and draws the levels into the background layer of HaloCompositor.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "LaserTarget.h"
+#include "HaloEffect.h"
+#include "HaloCompositor.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// breathe phase: up over the first half, down over the second
+#define BREATHE_PHASES 512
+
+#ifdef HALO_HOST_RENDER
+#define COUNT_WORK(counter, count) (HaloEffect::Work.counter += (count))
+#else
+#define COUNT_WORK(counter, count)
+#endif
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+uint16_t HaloEffect::random = HALO_EFFECT_DEFAULT_SEED;
+bool HaloEffect::playing = false;
+HaloEffectId HaloEffect::effect = HaloEffectId::Comet;
+uint8_t HaloEffect::speed = 1;
+uint8_t HaloEffect::param = 0;
+uint8_t HaloEffect::stepTicks = 1;
+uint16_t HaloEffect::position = 0;
+uint8_t HaloEffect::levels[RGB_LED_COUNT];
+HaloRGB HaloEffect::colors[RGB_LED_COUNT];
+uint16_t HaloEffect::RenderTicksMax = 0;
+uint16_t HaloEffect::OverBudget = 0;
+#ifdef HALO_HOST_RENDER
+HaloEffectWork HaloEffect::Work;
+#endif
+
+static const uint16_t budgets[(uint8_t)HaloEffectId::Count] = {
+    HALO_EFFECT_BUDGET_COMET,
+    HALO_EFFECT_BUDGET_BREATHE,
+    HALO_EFFECT_BUDGET_SPARKLE,
+    HALO_EFFECT_BUDGET_WIPE
+};
+
+static const uint8_t frameRates[(uint8_t)HaloEffectId::Count] = {
+    HALO_EFFECT_FPS_COMET,
+    HALO_EFFECT_FPS_BREATHE,
+    HALO_EFFECT_FPS_SPARKLE,
+    HALO_EFFECT_FPS_WIPE
+};
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+HaloEffect::HaloEffect()
+{
+}
+
+HaloEffect::~HaloEffect()
+{
+}
+
+bool HaloEffect::step()
+{
+    bool more = true;
+    COUNT_WORK(Steps, 1);
+
+    switch (effect)
+    {
+    case HaloEffectId::Comet:
+        // the tail fades, and the head moves on one LED
+        for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+        {
+            levels[led] = Scale8(levels[led], param);
+        }
+        COUNT_WORK(Levels, RGB_LED_COUNT);
+        if (++position >= RGB_LED_COUNT)
+        {
+            position = 0;
+            more = false;
+        }
+        levels[position] = 0xFF;
+        break;
+
+    case HaloEffectId::Breathe:
+    {
+        position += (0 == param) ? 1 : param;
+        if (position >= BREATHE_PHASES)
+        {
+            position -= BREATHE_PHASES;
+            more = false;
+        }
+        // triangle wave. The gamma table in the compositor makes the steps look even.
+        uint8_t level = (position < BREATHE_PHASES / 2) ? position : (BREATHE_PHASES - 1 - position);
+        for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+        {
+            levels[led] = level;
+        }
+        COUNT_WORK(Levels, RGB_LED_COUNT);
+        break;
+    }
+
+    case HaloEffectId::Sparkle:
+        for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+        {
+            levels[led] = Scale8(levels[led], HALO_EFFECT_SPARKLE_DECAY);
+        }
+        COUNT_WORK(Levels, RGB_LED_COUNT);
+        if ((uint8_t)Random() < param)
+        {
+            // the top byte times the LED count, over 256, picks an LED without a division
+            uint8_t led = (uint8_t)(((Random() >> 8) * RGB_LED_COUNT) >> 8);
+            levels[led] = 0xFF;
+        }
+        // a cycle is 256 steps, the sparkles themselves never repeat
+        position = (position + 1) & 0xFF;
+        more = (0 != position);
+        break;
+
+    case HaloEffectId::Wipe:
+        // filling up over the first RGB_LED_COUNT steps, emptying over the next
+        if (++position >= 2 * RGB_LED_COUNT)
+        {
+            position = 0;
+            more = false;
+        }
+        if (position < RGB_LED_COUNT)
+        {
+            levels[position] = 0xFF;
+        }
+        else
+        {
+            levels[position - RGB_LED_COUNT] = 0;
+        }
+        COUNT_WORK(Levels, 1);
+        break;
+
+    default:
+        break;
+    }
+
+    return more;
+}
+
+void HaloEffect::draw()
+{
+    HaloLayer& layer = HaloCompositor::Layer(HaloLayerId::Background);
+    for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+    {
+        uint8_t level = levels[led];
+        const HaloRGB& full = colors[led];
+        layer.SetPixel(led, HaloRGB{ Scale8(full.Red, level), Scale8(full.Green, level), Scale8(full.Blue, level) });
+    }
+    COUNT_WORK(Pixels, RGB_LED_COUNT);
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+void HaloEffect::Seed(uint16_t seed)
+{
+    random = (0 == seed) ? HALO_EFFECT_DEFAULT_SEED : seed;
+}
+
+uint16_t HaloEffect::Random()
+{
+    // xorshift16, shifts 7, 9, 8: period 65535, three shifts and three XORs per number
+    random ^= random << 7;
+    random ^= random >> 9;
+    random ^= random << 8;
+    COUNT_WORK(Randoms, 1);
+    return random;
+}
+
+uint16_t HaloEffect::Budget(HaloEffectId id)
+{
+    return ((uint8_t)id < (uint8_t)HaloEffectId::Count) ? budgets[(uint8_t)id] : 0;
+}
+
+uint8_t HaloEffect::FrameRate()
+{
+    return frameRates[(uint8_t)effect];
+}
+
+bool HaloEffect::Start(HaloEffectId id, HaloRGB effectColor, uint8_t effectSpeed, uint8_t effectParam)
+{
+    if ((uint8_t)id >= (uint8_t)HaloEffectId::Count)
+    {
+        return false;
+    }
+
+    effect = id;
+    speed = (0 == effectSpeed) ? 1 : effectSpeed;
+    param = effectParam;
+    stepTicks = speed;
+    position = 0;
+
+    bool wheel = (0 == effectColor.Red) && (0 == effectColor.Green) && (0 == effectColor.Blue);
+    for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+    {
+        colors[led] = wheel ? ColorWheel((uint8_t)(((uint16_t)led << 8) / RGB_LED_COUNT)) : effectColor;
+        levels[led] = 0;
+    }
+    if ((HaloEffectId::Comet == id) || (HaloEffectId::Wipe == id))
+    {
+        // both start with LED 0 lit
+        levels[0] = 0xFF;
+    }
+
+    draw();
+    playing = true;
+    return true;
+}
+
+void HaloEffect::Stop()
+{
+    playing = false;
+}
+
+bool HaloEffect::Playing()
+{
+    return playing;
+}
+
+bool HaloEffect::RenderFrame(uint8_t frames)
+{
+#ifdef HALO_HOST_RENDER
+    Work = HaloEffectWork();
+#endif
+    if (!playing)
+    {
+        return false;
+    }
+
+    uint16_t start = FRAME_TIMER_COUNT;
+    bool more = true;
+    bool moved = false;
+    for (uint8_t tick = 0; tick < frames; tick++)
+    {
+        if (0 == --stepTicks)
+        {
+            stepTicks = speed;
+            more = step() && more;
+            moved = true;
+        }
+    }
+    if (moved)
+    {
+        draw();
+    }
+
+    uint16_t ticks = FRAME_TIMER_COUNT - start;
+    if (ticks > RenderTicksMax)
+    {
+        RenderTicksMax = ticks;
+    }
+    if (ticks > (uint32_t)budgets[(uint8_t)effect] * frames)
+    {
+        OverBudget++;
+    }
+
+    return more;
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
@@ -0,0 +1,179 @@
+/**
+* @brief      Procedural halo effects
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Comet, breathe, sparkle and wipe, worked out every frame in integer math instead of stored as
+*               a pattern. Each effect keeps one 8-bit brightness level per LED, moves it on one step every few
+*               frame ticks, and draws the levels into the background layer of HaloCompositor.
+*               Random choices come from a 16-bit xorshift generator with a settable seed, so an effect started
+*               with the same seed plays the same way every time, on the target and in tools/halorender.
+*
+*               Every effect has a per frame time budget. RenderFrame() measures itself against it on the target,
+*               and "halorender -b" checks the worst frame of each effect against it with a cost model.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef HALO_EFFECT_H
+#define HALO_EFFECT_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+
+#include "HaloFramebuffer.h"
+#include "HaloColorWheel.h"
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// RenderFrame() budget for one frame tick of each effect, in FRAME_TIMER ticks (1us).
+// The worst frame of halorender -b at MCLK = 16MHz plus about 20%. Drawing all the LEDs is most of it,
+// about 0.2% of a frame tick at HALO_FPS_DEFAULT.
+#define HALO_EFFECT_BUDGET_COMET 170
+#define HALO_EFFECT_BUDGET_BREATHE 170
+#define HALO_EFFECT_BUDGET_SPARKLE 170
+#define HALO_EFFECT_BUDGET_WIPE 140
+
+// seed used until Seed() is called. The generator never leaves 0, so 0 is not a seed.
+#define HALO_EFFECT_DEFAULT_SEED 0xACE1
+
+// frame ticks per second of each effect. The speed argument counts these ticks.
+#define HALO_EFFECT_FPS_COMET 30
+#define HALO_EFFECT_FPS_BREATHE 20
+#define HALO_EFFECT_FPS_SPARKLE 20
+#define HALO_EFFECT_FPS_WIPE 10
+
+// sparkle brightness kept per step, out of 256
+#define HALO_EFFECT_SPARKLE_DECAY 192
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// The effects, with what their speed and param arguments mean.
+// A black color draws each LED in its own color wheel hue instead, spread once around the halo.
+enum class HaloEffectId : uint8_t
+{
+	// A bright head going round the halo, leaving a fading tail.
+	// speed: frame ticks per LED moved. param: tail brightness kept per step, out of 256.
+	Comet,
+	// The whole halo fading up and down.
+	// speed: frame ticks per step. param: brightness change per step, out of 256 for the way up.
+	Breathe,
+	// LEDs lighting up at random and fading out.
+	// speed: frame ticks per step. param: chance of a new sparkle per step, out of 256.
+	Sparkle,
+	// The halo filling up one LED at a time, then emptying the same way.
+	// speed: frame ticks per LED. param: unused.
+	Wipe,
+	Count
+};
+
+#ifdef HALO_HOST_RENDER
+// What the last RenderFrame() did, for the cost model in tools/halorender
+struct HaloEffectWork
+{
+	// effect steps taken
+	uint16_t Steps;
+	// LED brightness levels worked out
+	uint16_t Levels;
+	// random numbers drawn
+	uint16_t Randoms;
+	// LEDs drawn into the layer
+	uint16_t Pixels;
+};
+#endif
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+class HaloEffect
+{
+	HaloEffect();
+	~HaloEffect();
+
+	// xorshift generator state. Never 0.
+	static uint16_t random;
+
+	static bool playing;
+	static HaloEffectId effect;
+	static uint8_t speed;
+	static uint8_t param;
+
+	// frame ticks left until the next step
+	static uint8_t stepTicks;
+	// where the effect is in its cycle: the comet head, the breathe phase, the wipe position
+	static uint16_t position;
+	// brightness of each LED
+	static uint8_t levels[RGB_LED_COUNT];
+	// color of each LED at full brightness
+	static HaloRGB colors[RGB_LED_COUNT];
+
+	// Move the effect on one step.
+	// @return bool: false when the step completed a cycle of the effect.
+	static bool step();
+	// Draw the LED levels into the background layer
+	static void draw();
+
+public:
+	// longest RenderFrame() since this was last cleared, in FRAME_TIMER ticks (1us)
+	static uint16_t RenderTicksMax;
+	// RenderFrame() calls over the budget for the frame ticks they covered, since this was last cleared
+	static uint16_t OverBudget;
+#ifdef HALO_HOST_RENDER
+	static HaloEffectWork Work;
+#endif
+
+	// Restart the random sequence.
+	// @param seed: any value, 0 picks HALO_EFFECT_DEFAULT_SEED
+	static void Seed(uint16_t seed);
+
+	// @return uint16_t: the next number of the random sequence, never 0
+	static uint16_t Random();
+
+	// @return uint16_t: the budget for one frame tick of an effect, in FRAME_TIMER ticks (1us). 0 for no effect.
+	static uint16_t Budget(HaloEffectId id);
+
+	// @return uint8_t: frame ticks per second the playing effect runs at
+	static uint8_t FrameRate();
+
+	// Start an effect from the beginning of its cycle, on a black background layer.
+	// @param id: the effect
+	// @param effectColor: color of the effect, black for the color wheel
+	// @param effectSpeed: frame ticks per step, 0 counts as 1
+	// @param effectParam: see HaloEffectId
+	// @return bool: false if there is no such effect
+	static bool Start(HaloEffectId id, HaloRGB effectColor, uint8_t effectSpeed, uint8_t effectParam);
+
+	// Stop the effect. The background layer keeps its last frame.
+	static void Stop();
+
+	// @return bool: true while an effect is playing
+	static bool Playing();
+
+	// Move the effect on by the frame ticks since the last call and draw it into the background layer.
+	// HaloCompositor::Render() puts it on the halo.
+	// @param frames: frame ticks since the last call. Every step they cover is taken, so the effect keeps time.
+	// @return bool: false when the effect completed a cycle and started the next.
+	static bool RenderFrame(uint8_t frames);
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !HALO_EFFECT_H
@@ -0,0 +1,190 @@
+/**
+* @brief      Background transfer of halo frames to the TLC5957 chain
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Sends a frame of transfer words a few at a time from the TB0 CCR2 compare interrupt, so Loop() does
+*               not wait while the frame goes out. Each interrupt sends HALO_FLUSH_CHUNK_WORDS words through
+*               send16bits(), latches included, and sets the next compare HALO_FLUSH_CHUNK_GAP ticks on.
+*               With HALO_SPI_TRANSPORT the eUSCI_B1 TX interrupt feeds the bytes instead (HaloSPI::StartStream),
+*               and CCR2 only clocks the latched tail of each group, as soon as the ISR hands it over.
+*
+*               With interrupts off, before Setup() enables them or inside an ISR, a frame is sent in the
+*               foreground instead, since CCR2 could not run. The same goes for every frame without HALO_ASYNC_FLUSH.
+*
+* @link       Datasheets:
+*             TI User Guide (MSP430FR2355): https://www.ti.com/lit/ug/slau445i/slau445i.pdf
+*             TI TLC5957 LED Driver : https://www.ti.com/lit/ds/symlink/tlc5957.pdf
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "LaserTarget.h"
+#include "HaloFlush.h"
+#include "HaloPattern.h"
+#include "HaloSPI.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// WRTGS need 1 clock of latch to write data to GS register
+#define LATCH_WRTGS 1
+// LATGS need 3 clock of latch to write data to GS register
+#define LATCH_LATGS 3
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+const uint16_t* volatile HaloFlush::word = nullptr;
+volatile uint8_t HaloFlush::groups = 0;
+uint8_t HaloFlush::part = 0;
+uint8_t HaloFlush::groupPart = 0;
+void (*HaloFlush::complete)(void) = nullptr;
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+void HaloFlush::sendNow(const uint16_t* words, uint8_t groupWords, uint8_t groupCount)
+{
+    for (uint8_t k = groupCount; k-- > 0;)
+    {
+        for (uint8_t w = groupWords - 1; w-- > 0;)
+        {
+            send16bits(*words++);
+        }
+        // WRTGS for each group, the last group closes the frame with LATGS
+        send16bits(*words++, (0 == k) ? LATCH_LATGS : LATCH_WRTGS);
+    }
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+void HaloFlush::Init()
+{
+    Wait();
+    TB0CCTL2 = 0;
+}
+
+void HaloFlush::Start(const uint16_t* words, uint8_t groupWords, uint8_t groupCount, void (*onComplete)(void))
+{
+    Wait();
+
+#ifdef HALO_ASYNC_FLUSH
+    if (0 != (__get_SR_register() & GIE))
+    {
+#ifdef HALO_SPI_TRANSPORT
+        HaloSPI::StartStream(words, groupWords, groupCount, onComplete);
+#else
+        word = words;
+        groupPart = groupWords - 1;
+        part = groupPart;
+        complete = onComplete;
+        groups = groupCount;
+        Schedule(HALO_FLUSH_CHUNK_GAP);
+#endif
+        return;
+    }
+#endif
+
+    sendNow(words, groupWords, groupCount);
+    if (nullptr != onComplete)
+    {
+        onComplete();
+    }
+}
+
+bool HaloFlush::Busy()
+{
+#ifdef HALO_SPI_TRANSPORT
+    return HaloSPI::StreamBusy();
+#else
+    return (0 != groups);
+#endif
+}
+
+void HaloFlush::Wait()
+{
+    // CCR2 and the eUSCI interrupt finish the frame. Nothing is started in the background with interrupts off,
+    // so they are on for as long as this can loop.
+    while (Busy());
+}
+
+void HaloFlush::Schedule(uint16_t ticks)
+{
+    TB0CCR2 = FRAME_TIMER_COUNT + ticks;
+    // also clears a compare that is already pending
+    TB0CCTL2 = CCIE;
+}
+
+void HaloFlush::Tick()
+{
+#ifdef HALO_SPI_TRANSPORT
+    TB0CCTL2 = 0;
+    HaloSPI::Service();
+#else
+    if (0 == groups)
+    {
+        TB0CCTL2 = 0;
+        return;
+    }
+
+    for (uint8_t n = HALO_FLUSH_CHUNK_WORDS; n-- > 0;)
+    {
+        if (0 != part)
+        {
+            send16bits(*word++);
+            part--;
+            continue;
+        }
+
+        // WRTGS for each group, the last group closes the frame with LATGS
+        uint8_t left = groups - 1;
+        send16bits(*word++, (0 == left) ? LATCH_LATGS : LATCH_WRTGS);
+        if (0 == left)
+        {
+            TB0CCTL2 = 0;
+            if (nullptr != complete)
+            {
+                complete();
+            }
+            groups = 0;
+            return;
+        }
+        groups = left;
+        part = groupPart;
+    }
+
+    // counted from the end of this chunk, so a long one still leaves the main loop its gap
+    Schedule(HALO_FLUSH_CHUNK_GAP);
+#endif
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
@@ -0,0 +1,111 @@
+/**
+* @brief      Background transfer of halo frames to the TLC5957 chain
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Sends a frame of transfer words a few at a time from the TB0 CCR2 compare interrupt, so Loop() does
+*               not wait while the frame goes out. Each interrupt sends HALO_FLUSH_CHUNK_WORDS words through
+*               send16bits(), latches included, and sets the next compare HALO_FLUSH_CHUNK_GAP ticks on.
+*               With HALO_SPI_TRANSPORT the eUSCI_B1 TX interrupt feeds the bytes instead (HaloSPI::StartStream),
+*               and CCR2 only clocks the latched tail of each group, as soon as the ISR hands it over.
+*
+*               With interrupts off, before Setup() enables them or inside an ISR, a frame is sent in the
+*               foreground instead, since CCR2 could not run. The same goes for every frame without HALO_ASYNC_FLUSH.
+*
+* @link       Datasheets:
+*             TI User Guide (MSP430FR2355): https://www.ti.com/lit/ug/slau445i/slau445i.pdf
+*             TI TLC5957 LED Driver : https://www.ti.com/lit/ds/symlink/tlc5957.pdf
+**/
+
+#pragma once
+#ifndef HALO_FLUSH_H
+#define HALO_FLUSH_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <msp430.h>
+#include <stdint.h>
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// transfer words bit-banged per CCR2 interrupt. One word takes about 16us at 16MHz,
+// which keeps every interrupt well inside a light sensor sample period (244us).
+#define HALO_FLUSH_CHUNK_WORDS 3
+// FRAME_TIMER ticks (1us) from the end of one chunk to the next, for the main loop and the other interrupts
+#define HALO_FLUSH_CHUNK_GAP 40
+// FRAME_TIMER ticks the eUSCI needs to shift out the byte before a latched tail (HALO_SPI_TRANSPORT)
+#define HALO_FLUSH_TAIL_GAP 5
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+class HaloFlush
+{
+	HaloFlush();
+	~HaloFlush();
+
+	// next word to send
+	static const uint16_t* volatile word;
+	// latched groups left to send, 0 when no frame is in flight
+	volatile static uint8_t groups;
+	// unlatched words left in the current group
+	static uint8_t part;
+	// unlatched words at the start of each group
+	static uint8_t groupPart;
+	// called once the last word has been latched
+	static void (*complete)(void);
+
+	// Send a whole frame now, in the foreground
+	static void sendNow(const uint16_t* words, uint8_t groupWords, uint8_t groupCount);
+
+public:
+
+	// Stop any CCR2 compare left over from before. Call once, before the first frame.
+	static void Init();
+
+	// Send a stream of words, in the background when interrupts are on.
+	// The last word of each group is latched with WRTGS (LATGS for the last group),
+	// which is the layout of both a conventional and a poker mode GS frame.
+	// Waits for the frame before it, if it is still going out.
+	// @param words: the stream. Must stay untouched until Busy() returns false.
+	// @param groupWords: words per group, 3 for each chip in the chain
+	// @param groupCount: number of groups
+	// @param onComplete: called after the last latch, from the interrupt when in the background. May be nullptr.
+	static void Start(const uint16_t* words, uint8_t groupWords, uint8_t groupCount, void (*onComplete)(void));
+
+	// @return bool: true while a frame is still being sent in the background.
+	// Nothing else may drive the halo pins until this returns false.
+	static bool Busy();
+
+	// Block until the frame in flight, if any, has been latched.
+	// Anything else that drives the halo pins has to call this first.
+	static void Wait();
+
+	// Run the CCR2 compare again in a number of FRAME_TIMER ticks. Any context.
+	// @param ticks: FRAME_TIMER ticks (1us) from now
+	static void Schedule(uint16_t ticks);
+
+	// Send the next part of the frame in flight. Call from the CCR2 case of TIMER0_B1_ISR.
+	static void Tick();
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !HALO_FLUSH_H
@@ -0,0 +1,133 @@
+/**
+* @brief      Halo frame rate governor
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    The frame tick comes from TB0 CCR0 instead of the TB0 overflow, so every pattern can run at its own
+*               frame rate. TIMER0_B0_ISR moves TB0CCR0 on by one step each time it fires.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "LaserTarget.h"
+#include "HaloFrameRate.h"
+#include "Interrupts.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// longest compare step, in FRAME_TIMER ticks. Boosted wakeups come at least this often.
+#define FRAME_STEP_MAX (FRAME_TIMER_HZ / HALO_FPS_BOOST)
+
+static_assert(FRAME_STEP_MAX <= 0xFFFF, "a compare step has to fit TB0CCR0");
+static_assert(FRAME_TIMER_HZ / HALO_FPS_MIN / FRAME_STEP_MAX < 0xFF, "the slowest frame tick needs too many steps");
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+uint8_t HaloFrameRate::rate = 0;
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+HaloFrameRate::HaloFrameRate()
+{
+}
+
+HaloFrameRate::~HaloFrameRate()
+{
+}
+
+void HaloFrameRate::program()
+{
+    // Only runs when the rate changes, so the software divisions stay out of the frame loop
+    uint32_t period = FRAME_TIMER_HZ / rate;
+    uint8_t steps = (uint8_t)((period + FRAME_STEP_MAX - 1) / FRAME_STEP_MAX);
+    uint16_t step = (uint16_t)(period / steps);
+
+    uint16_t state = __get_interrupt_state();
+    __disable_interrupt();
+    Interrupts::FrameStep = step;
+    Interrupts::FrameSteps = steps;
+    if (Interrupts::FrameStepsLeft > steps)
+    {
+        Interrupts::FrameStepsLeft = steps;
+    }
+    __set_interrupt_state(state);
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+void HaloFrameRate::Start(uint8_t fps)
+{
+    rate = 0;
+    Set(fps);
+
+    uint16_t state = __get_interrupt_state();
+    __disable_interrupt();
+    Interrupts::FrameStepsLeft = Interrupts::FrameSteps;
+    TB0CCR0 = FRAME_TIMER_COUNT + Interrupts::FrameStep;
+    TB0CCTL0 = CCIE;
+    __set_interrupt_state(state);
+}
+
+void HaloFrameRate::Set(uint8_t fps)
+{
+    if (fps < HALO_FPS_MIN)
+    {
+        fps = HALO_FPS_MIN;
+    }
+    else if (fps > HALO_FPS_MAX)
+    {
+        fps = HALO_FPS_MAX;
+    }
+
+    if (fps != rate)
+    {
+        rate = fps;
+        program();
+    }
+}
+
+uint8_t HaloFrameRate::Get()
+{
+    return rate;
+}
+
+void HaloFrameRate::Boost(bool on)
+{
+    Interrupts::FrameBoost = on;
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
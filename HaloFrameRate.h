@@ -0,0 +1,88 @@
+/**
+* @brief      Halo frame rate governor
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    The frame tick comes from TB0 CCR0 instead of the TB0 overflow, so every pattern can run at its own
+*               frame rate. TIMER0_B0_ISR moves TB0CCR0 on by one step each time it fires, the timer keeps counting
+*               freely, and FRAME_TIMER_COUNT stays a 1us clock.
+*               A frame tick longer than one 16-bit compare is split into equal steps. While a hit flash is showing,
+*               the steps in between wake the main loop as well, so the flash fades at HALO_FPS_BOOST without
+*               speeding up the animation under it.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef HALO_FRAME_RATE_H
+#define HALO_FRAME_RATE_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// frame rate of patterns that do not set their own. About the rate of the old TB0 overflow tick.
+#define HALO_FPS_DEFAULT 15
+#define HALO_FPS_MIN 1
+#define HALO_FPS_MAX 60
+// redraws per second while a hit flash is showing. Also sets the longest compare step.
+#define HALO_FPS_BOOST 30
+
+// FRAME_TIMER ticks per second
+#define FRAME_TIMER_HZ 1000000UL
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+class HaloFrameRate
+{
+	HaloFrameRate();
+	~HaloFrameRate();
+
+	// frame ticks per second now programmed
+	static uint8_t rate;
+
+	// Work out the compare steps for rate and hand them to the interrupt
+	static void program();
+
+public:
+
+	// Start the frame tick on TB0 CCR0. FRAME_TIMER has to be running already.
+	// @param fps: frame ticks per second, clamped to HALO_FPS_MIN - HALO_FPS_MAX
+	static void Start(uint8_t fps);
+
+	// Change the frame rate. The tick in progress finishes at the old rate.
+	// @param fps: frame ticks per second, clamped to HALO_FPS_MIN - HALO_FPS_MAX
+	static void Set(uint8_t fps);
+
+	// @return uint8_t: frame ticks per second
+	static uint8_t Get();
+
+	// Wake the main loop at HALO_FPS_BOOST or the frame rate, whichever is faster, without adding frame ticks.
+	// @param on: true while something on the halo needs the faster redraw
+	static void Boost(bool on);
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !HALO_FRAME_RATE_H
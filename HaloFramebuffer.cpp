@@ -0,0 +1,238 @@
+/**
+* @brief      Grayscale framebuffer for the LED halo
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Holds one 16-bit GS word per color per LED. Patterns only write pixels into the framebuffer,
+*               and Flush() streams it to the TLC5957 with the WRTGS/LATGS latch commands in the right places.
+*
+* @link       Datasheets:
+*             TI TLC5957 LED Driver : https://www.ti.com/lit/ds/symlink/tlc5957.pdf
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "LaserTarget.h"
+#include "HaloFramebuffer.h"
+#include "HaloPattern.h"
+#include "HaloFlush.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+HaloFramebuffer HaloFrame;
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+// Frame completion. Called after the final LATGS, from the CCR2 interrupt when the frame went out in the background
+static void streamComplete(void)
+{
+    // turn on halo
+    P6OUT |= BIT0;
+}
+
+template <uint8_t ChipCount, uint8_t LedsPerChip>
+void HaloChainFramebuffer<ChipCount, LedsPerChip>::sendStream(const uint16_t* words)
+{
+    // Both trans modes latch once per group: per output in conventional mode, per bit-plane in poker mode
+    uint8_t groups = (0 == PokerBits) ? TLC5957_OUTPUT_COUNT : PokerBits;
+
+    // Turn off halo
+    P6OUT &= ~BIT0;
+
+    HaloFlush::Start(words, GroupWords, groups, streamComplete);
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+template <uint8_t ChipCount, uint8_t LedsPerChip>
+void HaloChainFramebuffer<ChipCount, LedsPerChip>::Clear()
+{
+    for (uint16_t i = WordCount; i-- > 0;)
+    {
+        if (0x0000 != GS[i])
+        {
+            GS[i] = 0x0000;
+            Dirty = true;
+        }
+    }
+}
+
+template <uint8_t ChipCount, uint8_t LedsPerChip>
+void HaloChainFramebuffer<ChipCount, LedsPerChip>::SetPixel(uint8_t led, uint16_t red, uint16_t green, uint16_t blue)
+{
+    SetChannel(led, HaloColor::Red, red);
+    SetChannel(led, HaloColor::Green, green);
+    SetChannel(led, HaloColor::Blue, blue);
+}
+
+template <uint8_t ChipCount, uint8_t LedsPerChip>
+void HaloChainFramebuffer<ChipCount, LedsPerChip>::SetChannel(uint8_t led, HaloColor color, uint16_t value)
+{
+    uint16_t* word = &GS[LedOffset(led) + (uint8_t)color];
+    if (*word != value)
+    {
+        *word = value;
+        Dirty = true;
+    }
+}
+
+template <uint8_t ChipCount, uint8_t LedsPerChip>
+uint16_t HaloChainFramebuffer<ChipCount, LedsPerChip>::GetChannel(uint8_t led, HaloColor color) const
+{
+    return GS[LedOffset(led) + (uint8_t)color];
+}
+
+template <uint8_t ChipCount, uint8_t LedsPerChip>
+void HaloChainFramebuffer<ChipCount, LedsPerChip>::Rotate(uint8_t steps)
+{
+    for (steps %= LedCount; steps > 0; steps--)
+    {
+        // the last LED wraps around to the first
+        uint16_t* led = &GS[LedOffset(LedCount - 1)];
+        uint16_t wrapped[RGB_CHANNEL_COUNT] = { led[0], led[1], led[2] };
+
+        for (uint8_t i = LedCount - 1; i > 0; i--)
+        {
+            uint16_t* previous = &GS[LedOffset(i - 1)];
+            led[0] = previous[0];
+            led[1] = previous[1];
+            led[2] = previous[2];
+            led = previous;
+        }
+
+        led[0] = wrapped[0];
+        led[1] = wrapped[1];
+        led[2] = wrapped[2];
+        Dirty = true;
+    }
+}
+
+template <uint8_t ChipCount, uint8_t LedsPerChip>
+void HaloChainFramebuffer<ChipCount, LedsPerChip>::SetPokerBits(uint8_t pwmBits)
+{
+    if (0 != pwmBits)
+    {
+        if (pwmBits < POKER_PWM_BITS_MIN)
+        {
+            pwmBits = POKER_PWM_BITS_MIN;
+        }
+        else if (pwmBits > POKER_PWM_BITS_MAX)
+        {
+            pwmBits = POKER_PWM_BITS_MAX;
+        }
+    }
+
+    if (pwmBits != PokerBits)
+    {
+        PokerBits = pwmBits;
+        Invalidate();
+    }
+}
+
+template <uint8_t ChipCount, uint8_t LedsPerChip>
+uint8_t HaloChainFramebuffer<ChipCount, LedsPerChip>::GetPokerBits() const
+{
+    return PokerBits;
+}
+
+template <uint8_t ChipCount, uint8_t LedsPerChip>
+void HaloChainFramebuffer<ChipCount, LedsPerChip>::Replay(const uint16_t* words)
+{
+    sendStream(words);
+
+    // the halo no longer shows the framebuffer
+    Invalidate();
+    FramesPushed++;
+}
+
+template <uint8_t ChipCount, uint8_t LedsPerChip>
+bool HaloChainFramebuffer<ChipCount, LedsPerChip>::Busy() const
+{
+    return HaloFlush::Busy();
+}
+
+template <uint8_t ChipCount, uint8_t LedsPerChip>
+void HaloChainFramebuffer<ChipCount, LedsPerChip>::Invalidate()
+{
+    ShownValid = false;
+}
+
+template <uint8_t ChipCount, uint8_t LedsPerChip>
+bool HaloChainFramebuffer<ChipCount, LedsPerChip>::Flush()
+{
+    if (ShownValid && Dirty)
+    {
+        // Patterns usually clear and redraw the whole frame, which marks it dirty
+        // even when the result is what is already on the halo.
+        // Comparing the GS words is far cheaper than shifting 16 bits for each one.
+        Dirty = false;
+        for (uint16_t i = WordCount; i-- > 0;)
+        {
+            if (GS[i] != Shown[i])
+            {
+                Dirty = true;
+                break;
+            }
+        }
+    }
+
+    if (ShownValid && !Dirty)
+    {
+        FramesSkipped++;
+        return false;
+    }
+
+    // Stream may still be in use by the previous frame
+    HaloFlush::Wait();
+
+    BuildStream(GS, PokerBits, Stream);
+    sendStream(Stream);
+
+    for (uint16_t i = WordCount; i-- > 0;)
+    {
+        Shown[i] = GS[i];
+    }
+    Dirty = false;
+    ShownValid = true;
+    FramesPushed++;
+
+    return true;
+}
+
+// the chain on this board
+template class HaloChainFramebuffer<HALO_CHIP_COUNT, HALO_LEDS_PER_CHIP>;
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
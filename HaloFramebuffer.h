@@ -0,0 +1,228 @@
+/**
+* @brief      Grayscale framebuffer for the LED halo
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Holds one 16-bit GS word per color per LED. Patterns only write pixels into the framebuffer,
+*               and Flush() streams it to the TLC5957 with the WRTGS/LATGS latch commands in the right places.
+*               Sized at compile time for any number of daisy-chained TLC5957s (HALO_CHIP_COUNT).
+*
+* @link       Datasheets:
+*             TI TLC5957 LED Driver : https://www.ti.com/lit/ds/symlink/tlc5957.pdf
+**/
+
+#pragma once
+#ifndef HALO_FRAMEBUFFER_H
+#define HALO_FRAMEBUFFER_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+
+#include <stdint.h>
+#include "LaserTarget.h"
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// RGB LED outputs on each TLC5957
+#define TLC5957_OUTPUT_COUNT 16
+// LEDs on the whole halo
+#define RGB_LED_COUNT (HALO_CHIP_COUNT * HALO_LEDS_PER_CHIP)
+// one GS word each for red, green, and blue
+#define RGB_CHANNEL_COUNT 3
+
+// PWM depth limits for poker trans mode
+#define POKER_PWM_BITS_MIN 9
+#define POKER_PWM_BITS_MAX 16
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// GS word offset of each color within an LED.
+// The TLC5957 expects Blue, Green, then Red, so the framebuffer is streamed from the top down.
+enum class HaloColor
+{
+	Red,
+	Green,
+	Blue
+};
+
+// Pack one poker trans mode transfer word: the same GS bit of 16 consecutive channels, highest channel first.
+// @param top: one past the highest channel of the word. Channels are read walking down from here.
+// @param mask: selects the GS bit of the current plane
+constexpr uint16_t PackPokerWord(const uint16_t* top, uint16_t mask)
+{
+	uint16_t packed = 0;
+	for (uint8_t b = 16; b-- > 0;)
+	{
+		packed <<= 1;
+		if (*--top & mask)
+		{
+			packed |= 1;
+		}
+	}
+	return packed;
+}
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+// Framebuffer for a chain of ChipCount TLC5957 drivers with LedsPerChip LEDs on each.
+// LED n of the halo is output (n % LedsPerChip) of chip (n / LedsPerChip), chip 0 being the one wired to the MCU.
+// Outputs above LedsPerChip are never written and stay off.
+template <uint8_t ChipCount, uint8_t LedsPerChip>
+class HaloChainFramebuffer
+{
+	static_assert(ChipCount > 0, "the halo needs at least one TLC5957");
+	static_assert(LedsPerChip > 0 && LedsPerChip <= TLC5957_OUTPUT_COUNT, "a TLC5957 drives 1 - 16 RGB LEDs");
+	static_assert(ChipCount * LedsPerChip <= 255, "LEDs are addressed with a uint8_t");
+
+public:
+	// LEDs on the whole chain
+	static constexpr uint8_t LedCount = ChipCount * LedsPerChip;
+	// words in the common shift register of the whole chain. Every WRTGS latches one group of this size.
+	static constexpr uint8_t GroupWords = ChipCount * RGB_CHANNEL_COUNT;
+	// GS words for every output of every chip
+	static constexpr uint16_t WordCount = ChipCount * TLC5957_OUTPUT_COUNT * RGB_CHANNEL_COUNT;
+
+	// @return uint16_t: index of the first GS word of a halo LED
+	static constexpr uint16_t LedOffset(uint8_t led)
+	{
+		// LedsPerChip is a constant, so this folds down to led * 3 for fully populated chips
+		return ((led / LedsPerChip) * TLC5957_OUTPUT_COUNT + (led % LedsPerChip)) * RGB_CHANNEL_COUNT;
+	}
+
+	// Lay a frame out in send order.
+	// Usable at compile time, so fixed frames can be stored as ready-made transfer words.
+	// @param gs: WordCount GS words, indexed [(chip * 16 + output) * RGB_CHANNEL_COUNT + color]
+	// @param pokerBits: PWM depth for poker trans mode. 0 for the conventional GS trans mode.
+	// @param out: receives GroupWords words per latched group (16 groups, or pokerBits planes)
+	static constexpr void BuildStream(const uint16_t* gs, uint8_t pokerBits, uint16_t* out)
+	{
+		if (0 == pokerBits)
+		{
+			// The sending sequence is from the last output to the first. Each group holds that output of every chip,
+			// the last chip in the chain first, and within an LED from MSB to LSB, from Blue color to Green color, and finally, Red color.
+			for (uint8_t output = TLC5957_OUTPUT_COUNT; output-- > 0;)
+			{
+				for (uint8_t chip = ChipCount; chip-- > 0;)
+				{
+					const uint16_t* led = &gs[(chip * TLC5957_OUTPUT_COUNT + output) * RGB_CHANNEL_COUNT];
+					for (uint8_t color = RGB_CHANNEL_COUNT; color-- > 0;)
+					{
+						*out++ = led[color];
+					}
+				}
+			}
+		}
+		else
+		{
+			// In poker trans mode the common shift register of the chain holds the same GS bit of every channel.
+			// Bit-planes are sent MSB first, and only the top pokerBits planes are sent at all.
+			// Within a plane the last chip comes first, and each chip in the conventional order: last LED first, Blue, Green, Red.
+			for (uint8_t plane = 0; plane < pokerBits; plane++)
+			{
+				uint16_t mask = 0x8000 >> plane;
+				const uint16_t* channel = &gs[WordCount];
+
+				for (uint8_t w = GroupWords; w-- > 0;)
+				{
+					*out++ = PackPokerWord(channel, mask);
+					channel -= 16;
+				}
+			}
+		}
+	}
+
+private:
+	// GS data, indexed [(chip * 16 + output) * RGB_CHANNEL_COUNT + color]
+	uint16_t GS[WordCount];
+	// GS data as it was last sent to the TLC5957 chain
+	uint16_t Shown[WordCount];
+
+	// true when a GS word has been written since the last flush
+	bool Dirty;
+	// false until the first flush, or after Invalidate(), so the chip state is unknown
+	bool ShownValid;
+	// PWM depth for poker trans mode. 0 when the conventional GS trans mode is used
+	uint8_t PokerBits;
+
+	// Transfer words for the TLC5957 chain in send order, built from GS by BuildStream()
+	uint16_t Stream[WordCount];
+
+	// Send groups of GroupWords transfer words, each group followed by WRTGS and the last one by LATGS
+	void sendStream(const uint16_t* words);
+
+public:
+	// number of flushes that were streamed to the TLC5957 chain
+	uint32_t FramesPushed;
+	// number of flushes skipped because the frame had not changed
+	uint32_t FramesSkipped;
+
+	// Set every GS word to 0 (all LEDs off)
+	void Clear();
+
+	// Set all three colors of an LED.
+	// @param led: halo position. Zero indexed.
+	void SetPixel(uint8_t led, uint16_t red, uint16_t green, uint16_t blue);
+
+	// Set a single color of an LED.
+	// @param led: halo position. Zero indexed.
+	void SetChannel(uint8_t led, HaloColor color, uint16_t value);
+
+	// Read back a single color of an LED.
+	// @param led: halo position. Zero indexed.
+	uint16_t GetChannel(uint8_t led, HaloColor color) const;
+
+	// Move every LED around the halo, wrapping at the end.
+	// @param steps: positions to move each LED towards the higher positions
+	void Rotate(uint8_t steps);
+
+	// Select the GS trans mode used by Flush(). This does not touch the TLC5957 FC register,
+	// use SetPokerTransMode() to change both together.
+	// @param pwmBits: PWM depth for poker trans mode, clamped to 9 - 16. 0 selects the conventional GS trans mode.
+	void SetPokerBits(uint8_t pwmBits);
+
+	// @return uint8_t: PWM depth for poker trans mode. 0 when the conventional GS trans mode is used
+	uint8_t GetPokerBits() const;
+
+	// Stream precomputed transfer words straight to the TLC5957 chain, bypassing the framebuffer.
+	// The words must already be in send order for the current GS trans mode, as laid out by BuildStream().
+	// @param words: the transfer words, usually a FRAM table
+	void Replay(const uint16_t* words);
+
+	// @return bool: true while a frame is still being sent in the background (HALO_ASYNC_FLUSH).
+	// Nothing may be written to the halo until this returns false.
+	bool Busy() const;
+
+	// Force the next Flush() to send the frame, even if it has not changed.
+	// Call this whenever something other than Flush() has written the TLC5957 GS latches.
+	void Invalidate();
+
+	// Stream the framebuffer to the TLC5957 chain and latch it to the outputs.
+	// Skips the transfer entirely if the frame is identical to the last one sent.
+	// With HALO_ASYNC_FLUSH the transfer runs from the TB0 CCR2 interrupt (HaloFlush) and this returns as soon as it has started.
+	// @return bool: true if the frame was sent.
+	bool Flush();
+};
+
+// The halo as wired on this board
+typedef HaloChainFramebuffer<HALO_CHIP_COUNT, HALO_LEDS_PER_CHIP> HaloFramebuffer;
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+// The framebuffer shared by all halo patterns
+extern HaloFramebuffer HaloFrame;
+
+#endif // !HALO_FRAMEBUFFER_H
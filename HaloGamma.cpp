@@ -0,0 +1,149 @@
+/**
+* @brief      Gamma and brightness conversion for halo colors
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Patterns describe colors as 8-bit intensity levels. ToGS() turns a level into a 16-bit TLC5957 GS value
+*               through a gamma 2.2 table generated at compile time and kept in FRAM, so equal steps in level look
+*               like equal steps in brightness. The global brightness is a right shift of the GS value,
+*               which halves the light output per step without any multiplication.
+*               In poker trans mode only the top PWM bits of a GS value reach the TLC5957, so ToGS() rounds to
+*               that depth and keeps every lit level at least one step above black.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "HaloGamma.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// The const table is placed in FRAM
+constexpr GammaTable Gamma;
+
+// Spot checks against round(65535 * (level / 255)^2.2) worked out in floating point
+static_assert(Gamma.GS[0] == 0 && Gamma.GS[1] == 0 && Gamma.GS[2] == 2 && Gamma.GS[16] == 148,
+    "gamma table is wrong at the dark end");
+static_assert(Gamma.GS[64] == 3131 && Gamma.GS[128] == 14386 && Gamma.GS[192] == 35103,
+    "gamma table is wrong in the middle");
+static_assert(Gamma.GS[254] == 64971 && Gamma.GS[255] == 0xFFFF,
+    "gamma table is wrong at the bright end");
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+uint8_t HaloGamma::brightnessShift = 0;
+uint16_t HaloGamma::depthMask = 0xFFFF;
+uint16_t HaloGamma::depthLsb = 1;
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+HaloGamma::HaloGamma()
+{
+}
+
+HaloGamma::~HaloGamma()
+{
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+void HaloGamma::SetBrightness(uint8_t brightness)
+{
+    if (brightness > HALO_BRIGHTNESS_MAX)
+    {
+        brightness = HALO_BRIGHTNESS_MAX;
+    }
+    brightnessShift = HALO_BRIGHTNESS_MAX - brightness;
+}
+
+uint8_t HaloGamma::GetBrightness()
+{
+    return HALO_BRIGHTNESS_MAX - brightnessShift;
+}
+
+void HaloGamma::SetPwmBits(uint8_t pwmBits)
+{
+    if ((0 == pwmBits) || (pwmBits >= 16))
+    {
+        depthMask = 0xFFFF;
+        depthLsb = 1;
+    }
+    else
+    {
+        depthMask = 0xFFFF << (16 - pwmBits);
+        depthLsb = (uint16_t)~depthMask + 1;
+    }
+}
+
+uint16_t HaloGamma::ToGS(uint8_t level)
+{
+    if (0 == level)
+    {
+        return 0;
+    }
+
+    // round to nearest at the PWM depth, the top step saturates
+    uint16_t gs = Gamma.GS[level] >> brightnessShift;
+    uint16_t half = depthLsb >> 1;
+    if (gs <= (uint16_t)(0xFFFF - half))
+    {
+        gs += half;
+    }
+    gs &= depthMask;
+
+    // a lit level never goes dark
+    if (0 == gs)
+    {
+        gs = depthLsb;
+    }
+    return gs;
+}
+
+uint8_t HaloGamma::ToLevel(uint16_t gs)
+{
+    // binary search, the table only ever rises
+    uint8_t level = 0;
+    for (uint8_t bit = 0x80; bit != 0; bit >>= 1)
+    {
+        if (ToGS(level | bit) <= gs)
+        {
+            level |= bit;
+        }
+    }
+    return level;
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
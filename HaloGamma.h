@@ -0,0 +1,118 @@
+/**
+* @brief      Gamma and brightness conversion for halo colors
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Patterns describe colors as 8-bit intensity levels. ToGS() turns a level into a 16-bit TLC5957 GS value
+*               through a gamma 2.2 table generated at compile time and kept in FRAM, so equal steps in level look
+*               like equal steps in brightness. The global brightness is a right shift of the GS value,
+*               which halves the light output per step without any multiplication.
+*               In poker trans mode the TLC5957 only gets the top bits of each GS value, and at 9 bits anything
+*               under 0x80 would truncate to black: levels 1 - 14 at full brightness, and more at every step down.
+*               ToGS() rounds to the PWM depth set with SetPwmBits() instead, and never rounds a lit level to 0.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef HALO_GAMMA_H
+#define HALO_GAMMA_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// number of 8-bit intensity levels
+#define GAMMA_LEVEL_COUNT 256
+// full brightness. Each step below halves the light output.
+#define HALO_BRIGHTNESS_MAX 7
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// x^2.2 for x in 0 - 1, as x^2 * x^(1/5). The fifth root is found with Newton's method,
+// since the math library is not usable at compile time.
+constexpr double GammaCurve(double x)
+{
+	double root = 1.0;
+	if (x <= 0.0)
+	{
+		return 0.0;
+	}
+	for (uint8_t i = 0; i < 32; i++)
+	{
+		root = (4.0 * root + x / (root * root * root * root)) / 5.0;
+	}
+	return x * x * root;
+}
+
+// 8-bit level to 16-bit GS value, gamma 2.2, rounded to nearest
+struct GammaTable
+{
+	uint16_t GS[GAMMA_LEVEL_COUNT];
+
+	constexpr GammaTable() : GS()
+	{
+		for (uint16_t level = 0; level < GAMMA_LEVEL_COUNT; level++)
+		{
+			GS[level] = (uint16_t)(GammaCurve(level / 255.0) * 65535.0 + 0.5);
+		}
+	}
+};
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+class HaloGamma
+{
+	HaloGamma();
+	~HaloGamma();
+
+	// GS right shift for the current brightness
+	static uint8_t brightnessShift;
+	// GS bits the TLC5957 gets at the current PWM depth, and the lowest of them
+	static uint16_t depthMask;
+	static uint16_t depthLsb;
+
+public:
+
+	// Set the global brightness used by ToGS(). Patterns have to redraw for it to show.
+	// @param brightness: 0 - HALO_BRIGHTNESS_MAX. Clamped.
+	static void SetBrightness(uint8_t brightness);
+
+	// @return uint8_t: the global brightness, 0 - HALO_BRIGHTNESS_MAX
+	static uint8_t GetBrightness();
+
+	// Set the PWM depth ToGS() rounds to. SetPokerTransMode() keeps it in step with the framebuffer.
+	// @param pwmBits: poker mode PWM bits, or 0 for the conventional 16-bit GS transfer
+	static void SetPwmBits(uint8_t pwmBits);
+
+	// @return uint16_t: the GS value for an intensity level at the current brightness, rounded to the PWM depth.
+	//                   0 only for level 0, so dim colors keep the dimmest step the TLC5957 can show.
+	static uint16_t ToGS(uint8_t level);
+
+	// Inverse of ToGS()
+	// @return uint8_t: the highest intensity level whose GS value does not exceed gs
+	static uint8_t ToLevel(uint16_t gs);
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !HALO_GAMMA_H
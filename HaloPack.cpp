@@ -0,0 +1,387 @@
+/**
+* @brief      Streaming decoder for compressed halo animations
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    A pack is a whole animation compiled on the PC by tools/halopack.cpp. Each frame is stored as the
+*               changes from the frame before it: skip the LEDs that stay the same, runs of LEDs set to one color,
+*               and literal colors. The decoder unpacks one frame at a time straight into the background layer
+*               of HaloCompositor, which still holds the previous frame, so it needs no frame buffer of its own.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "LaserTarget.h"
+#include "HaloPack.h"
+#include "HaloCompositor.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// bytes in the FRAM pack store, the budget halopack reports against
+#define HALO_PACK_STORE_SIZE EEPROM_SIZE
+
+static_assert(RGB_LED_COUNT <= 0xFF, "the pack header holds the LED count in a byte");
+static_assert(HALO_PACK_STORE_SIZE <= 0xFFFF, "pack lengths are 16 bits");
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// Where a stored pack is in HaloPackStore::Data
+struct HaloPackSlot
+{
+    uint16_t Offset;
+    // pack length, 0 while empty, being written or being moved
+    uint16_t Length;
+};
+
+// The packs kept in FRAM across power cycles, one after the other from the start of Data
+struct HaloPackStore
+{
+    HaloPackSlot Slots[HALO_PACK_SLOTS];
+    uint8_t Data[HALO_PACK_STORE_SIZE];
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+const uint8_t* HaloPack::pack = nullptr;
+uint16_t HaloPack::length = 0;
+uint16_t HaloPack::offset = 0;
+uint8_t HaloPack::holdFrames = 0;
+uint16_t HaloPack::storeWritten = 0;
+uint8_t HaloPack::storeSlot = 0;
+uint16_t HaloPack::storeStart = 0;
+uint16_t HaloPack::DecodeTicksMax = 0;
+
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma PERSISTENT(PackStore)
+HaloPackStore PackStore =
+#elif defined(__GNUC__)
+HaloPackStore __attribute__((persistent)) PackStore =
+#else
+#error Compiler not supported!
+#endif
+{
+    { { 0, 0 } }, { 0 }
+};
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+HaloPack::HaloPack()
+{
+}
+
+HaloPack::~HaloPack()
+{
+}
+
+uint8_t HaloPack::fetch(const uint8_t* data, uint16_t dataLength, uint16_t& position)
+{
+    if (position >= dataLength)
+    {
+        return 0;
+    }
+    return data[position++];
+}
+
+void HaloPack::rewind()
+{
+    offset = HALO_PACK_HEADER_SIZE;
+    holdFrames = 0;
+}
+
+bool HaloPack::decodeFrame()
+{
+    if (HALO_PACK_HEADER_SIZE == offset)
+    {
+        // the first frame is stored as the changes from an all black halo
+        HaloCompositor::Layer(HaloLayerId::Background).Fill(HaloRGB{ 0, 0, 0 });
+    }
+
+    return Unpack(pack, length, offset, holdFrames);
+}
+
+void HaloPack::removeStored(uint8_t slot)
+{
+    uint16_t gap = PackStore.Slots[slot].Length;
+    uint16_t from = PackStore.Slots[slot].Offset + gap;
+    PackStore.Slots[slot].Length = 0;
+    if (0 == gap)
+    {
+        return;
+    }
+
+    for (;;)
+    {
+        // the next pack after the gap. Lowest first, since each one moves down over the end of the one before.
+        uint8_t next = HALO_PACK_SLOTS;
+        for (uint8_t i = 0; i < HALO_PACK_SLOTS; i++)
+        {
+            const HaloPackSlot& stored = PackStore.Slots[i];
+            if ((0 != stored.Length) && (stored.Offset >= from)
+                && ((HALO_PACK_SLOTS == next) || (stored.Offset < PackStore.Slots[next].Offset)))
+            {
+                next = i;
+            }
+        }
+        if (HALO_PACK_SLOTS == next)
+        {
+            break;
+        }
+
+        // the slot reads as empty while it moves, so a reset part way through loses it instead of leaving half a pack
+        HaloPackSlot& moving = PackStore.Slots[next];
+        uint16_t packLength = moving.Length;
+        moving.Length = 0;
+        for (uint16_t i = 0; i < packLength; i++)
+        {
+            PackStore.Data[moving.Offset - gap + i] = PackStore.Data[moving.Offset + i];
+        }
+        from = moving.Offset + packLength;
+        moving.Offset -= gap;
+        moving.Length = packLength;
+    }
+}
+
+uint16_t HaloPack::storeUsed()
+{
+    uint16_t used = 0;
+    for (uint8_t i = 0; i < HALO_PACK_SLOTS; i++)
+    {
+        const HaloPackSlot& stored = PackStore.Slots[i];
+        if ((0 != stored.Length) && (stored.Offset + stored.Length > used))
+        {
+            used = stored.Offset + stored.Length;
+        }
+    }
+    return used;
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+bool HaloPack::Unpack(const uint8_t* data, uint16_t dataLength, uint16_t& position, uint8_t& hold)
+{
+    HaloLayer& layer = HaloCompositor::Layer(HaloLayerId::Background);
+    uint8_t led = 0;
+
+    while (position < dataLength)
+    {
+        uint8_t record = fetch(data, dataLength, position);
+        uint8_t count = (record & HALO_PACK_COUNT_MASK) + 1;
+
+        switch (record & HALO_PACK_TYPE_MASK)
+        {
+        case HALO_PACK_SKIP:
+            led += count;
+            break;
+
+        case HALO_PACK_RUN:
+        {
+            uint8_t red = fetch(data, dataLength, position);
+            uint8_t green = fetch(data, dataLength, position);
+            uint8_t blue = fetch(data, dataLength, position);
+            for (; (count > 0) && (led < RGB_LED_COUNT); count--)
+            {
+                layer.SetPixel(led++, HaloRGB{ red, green, blue });
+            }
+            break;
+        }
+
+        case HALO_PACK_LITERAL:
+            for (; count > 0; count--)
+            {
+                uint8_t red = fetch(data, dataLength, position);
+                uint8_t green = fetch(data, dataLength, position);
+                uint8_t blue = fetch(data, dataLength, position);
+                if (led < RGB_LED_COUNT)
+                {
+                    layer.SetPixel(led++, HaloRGB{ red, green, blue });
+                }
+            }
+            break;
+
+        default:
+            // HALO_PACK_SHOW
+            hold = count;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool HaloPack::Load(const uint8_t* data, uint16_t dataLength)
+{
+    if ((nullptr == data) || (dataLength <= HALO_PACK_HEADER_SIZE) || (RGB_LED_COUNT != data[0]))
+    {
+        return false;
+    }
+
+    pack = data;
+    length = dataLength;
+    rewind();
+    return true;
+}
+
+bool HaloPack::StorePart(uint8_t slot, uint16_t offset, const uint8_t* data, uint8_t dataLength)
+{
+    if (slot >= HALO_PACK_SLOTS)
+    {
+        return false;
+    }
+    if (0 == offset)
+    {
+        storeWritten = 0;
+        storeSlot = slot;
+    }
+    if ((nullptr == data) || (0 == dataLength) || (dataLength > HALO_PACK_PART_MAX) || (slot != storeSlot)
+        || (offset != storeWritten))
+    {
+        return false;
+    }
+
+    // PERSISTENT variables live in program FRAM, which is write protected
+    SYSCFG0 = FRWPPW | DFWP;
+
+    if (0 == offset)
+    {
+        // the store is about to change under a playing pack
+        if ((pack >= PackStore.Data) && (pack < PackStore.Data + HALO_PACK_STORE_SIZE))
+        {
+            Stop();
+        }
+        // empty until the whole pack is in, so a reset part way through cannot leave half a pack.
+        // The new pack goes after the others.
+        removeStored(slot);
+        storeStart = storeUsed();
+    }
+    if (dataLength > HALO_PACK_STORE_SIZE - storeStart - offset)
+    {
+        SYSCFG0 = FRWPPW | PFWP | DFWP;
+        return false;
+    }
+    for (uint8_t i = 0; i < dataLength; i++)
+    {
+        PackStore.Data[storeStart + offset + i] = data[i];
+    }
+
+    SYSCFG0 = FRWPPW | PFWP | DFWP;
+
+    storeWritten += dataLength;
+    return true;
+}
+
+bool HaloPack::FinishStore(uint8_t slot)
+{
+    uint16_t written = storeWritten;
+    storeWritten = 0;
+    if ((slot != storeSlot) || (written <= HALO_PACK_HEADER_SIZE) || (RGB_LED_COUNT != PackStore.Data[storeStart]))
+    {
+        return false;
+    }
+
+    SYSCFG0 = FRWPPW | DFWP;
+    PackStore.Slots[slot].Offset = storeStart;
+    PackStore.Slots[slot].Length = written;
+    SYSCFG0 = FRWPPW | PFWP | DFWP;
+    return true;
+}
+
+bool HaloPack::LoadStored(uint8_t slot)
+{
+    if (slot >= HALO_PACK_SLOTS)
+    {
+        return false;
+    }
+    const HaloPackSlot& stored = PackStore.Slots[slot];
+    return Load(PackStore.Data + stored.Offset, stored.Length);
+}
+
+uint16_t HaloPack::StoreFree()
+{
+    return HALO_PACK_STORE_SIZE - storeUsed();
+}
+
+void HaloPack::Stop()
+{
+    pack = nullptr;
+    length = 0;
+}
+
+bool HaloPack::Playing()
+{
+    return (nullptr != pack);
+}
+
+bool HaloPack::RenderFrame(uint8_t frames)
+{
+    if (nullptr == pack)
+    {
+        return false;
+    }
+
+    uint16_t start = FRAME_TIMER_COUNT;
+    bool more = true;
+
+    while (0 != frames)
+    {
+        if (0 != holdFrames)
+        {
+            uint8_t played = (frames < holdFrames) ? frames : holdFrames;
+            holdFrames -= played;
+            frames -= played;
+        }
+        else if (!decodeFrame())
+        {
+            // played to the end, start over from the first frame
+            more = false;
+            rewind();
+            if (!decodeFrame())
+            {
+                // not a single frame in the pack
+                Stop();
+                break;
+            }
+        }
+    }
+
+    uint16_t ticks = FRAME_TIMER_COUNT - start;
+    if (ticks > DecodeTicksMax)
+    {
+        DecodeTicksMax = ticks;
+    }
+
+    return more;
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
@@ -0,0 +1,169 @@
+/**
+* @brief      Streaming decoder for compressed halo animations
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    A pack is a whole animation compiled on the PC by tools/halopack.cpp. Each frame is stored as the
+*               changes from the frame before it: skip the LEDs that stay the same, runs of LEDs set to one color,
+*               and literal colors. The decoder unpacks one frame at a time straight into the background layer
+*               of HaloCompositor, which still holds the previous frame, so it needs no frame buffer of its own.
+*
+*               Pack layout: one byte with the LED count, then records. A record byte holds the record type
+*               in the top two bits and a count - 1 (1 to 64) in the low six bits.
+*
+*               Packs are played from a const table, or from the pack store: a table of HALO_PACK_SLOTS packs
+*               sharing EEPROM_SIZE bytes of FRAM. The STORE_PACK command fills a slot over bluetooth in parts
+*               of up to HALO_PACK_PART_MAX bytes, and PLAY_PACK plays a slot. Each pack takes only the bytes
+*               it needs. Storing a slot again moves the packs after it down over its old bytes, so the free
+*               space is always in one piece at the end. halopack -m writes the STORE_PACK messages for a pack.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef HALO_PACK_H
+#define HALO_PACK_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// bytes before the first record
+#define HALO_PACK_HEADER_SIZE 1
+
+// record types, in the top two bits of the record byte
+#define HALO_PACK_TYPE_MASK 0xC0
+// count LEDs keep their color
+#define HALO_PACK_SKIP 0x00
+// red, green, blue follow: count LEDs are set to the color
+#define HALO_PACK_RUN 0x40
+// count red, green, blue triples follow, one per LED
+#define HALO_PACK_LITERAL 0x80
+// the frame is complete, the LEDs left keep their color. Show it for count frame ticks.
+#define HALO_PACK_SHOW 0xC0
+
+// record count, in the low six bits of the record byte, stored as count - 1
+#define HALO_PACK_COUNT_MASK 0x3F
+#define HALO_PACK_COUNT_MAX 64
+
+// most pack bytes in one STORE_PACK message
+#define HALO_PACK_PART_MAX 120
+
+// packs the FRAM pack store holds. STORE_PACK and PLAY_PACK take the slot index.
+#define HALO_PACK_SLOTS 8
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+class HaloPack
+{
+	HaloPack();
+	~HaloPack();
+
+	// the pack being played. nullptr when stopped
+	static const uint8_t* pack;
+	static uint16_t length;
+	// next record
+	static uint16_t offset;
+	// frame ticks left to show the current frame
+	static uint8_t holdFrames;
+
+	// bytes of the pack being written into the store so far
+	static uint16_t storeWritten;
+	// slot the pack being written goes to, and where its bytes start in the store
+	static uint8_t storeSlot;
+	static uint16_t storeStart;
+
+	// @return uint8_t: the byte at position, moving position on. Reads past the end return 0.
+	static uint8_t fetch(const uint8_t* data, uint16_t dataLength, uint16_t& position);
+	// Go back to the first frame
+	static void rewind();
+	// Unpack the next frame into the background layer.
+	// @return bool: false if the pack has no more frames.
+	static bool decodeFrame();
+	// Empty a slot of the store, and move the packs stored after it down over its bytes.
+	// The FRAM has to be writable.
+	static void removeStored(uint8_t slot);
+	// @return uint16_t: store bytes the stored packs take up
+	static uint16_t storeUsed();
+
+public:
+	// longest RenderFrame() since this was last cleared, in FRAME_TIMER ticks (1us)
+	static uint16_t DecodeTicksMax;
+
+	// Start playing a pack from its first frame.
+	// @param data: the pack. Must stay valid while it plays, so usually a const FRAM table.
+	// @param dataLength: pack length in bytes
+	// @return bool: false if the pack was made for a different number of LEDs.
+	static bool Load(const uint8_t* data, uint16_t dataLength);
+
+	// Write part of a pack into a slot of the FRAM pack store. It survives power cycles.
+	// A part at offset 0 starts a new pack and empties the slot, which reads as empty until FinishStore().
+	// That stops a pack playing from the store, since the packs after the slot move.
+	// @param slot: 0 - HALO_PACK_SLOTS - 1
+	// @param offset: where the part goes in the pack. Each part has to follow on from the one before.
+	// @param data: pack bytes
+	// @param dataLength: bytes in data, up to HALO_PACK_PART_MAX
+	// @return bool: false if the part is for another slot or does not follow on from the last one,
+	//               or does not fit the store.
+	static bool StorePart(uint8_t slot, uint16_t offset, const uint8_t* data, uint8_t dataLength);
+
+	// Close the pack being written, so LoadStored() plays it.
+	// @param slot: the slot the parts were written to
+	// @return bool: false if what was written is not a pack for this halo. The slot stays empty.
+	static bool FinishStore(uint8_t slot);
+
+	// Start playing a pack in the FRAM store from its first frame.
+	// @param slot: 0 - HALO_PACK_SLOTS - 1
+	// @return bool: false if the slot does not exist or is empty.
+	static bool LoadStored(uint8_t slot);
+
+	// @return uint16_t: store bytes free for a new pack, not counting the bytes of the slot it replaces
+	static uint16_t StoreFree();
+
+	// Stop the pack. The background layer keeps its last frame.
+	static void Stop();
+
+	// @return bool: true while a pack is loaded.
+	static bool Playing();
+
+	// Unpack the frame for the current time into the background layer.
+	// HaloCompositor::Render() puts it on the halo.
+	// @param frames: frame ticks since the last call. Frames that were missed are still unpacked, since every frame
+	//                builds on the one before, but only the last one is shown. 0 leaves the layer as it is.
+	// @return bool: false when the pack has played to the end and started over.
+	static bool RenderFrame(uint8_t frames);
+
+	// Unpack the records of one frame into the background layer, over what it already holds.
+	// Also used for frames that do not come from a pack, like the ones streamed over bluetooth.
+	// @param data: records
+	// @param dataLength: bytes in data
+	// @param position: first record to read. Moved past the show record that ends the frame.
+	// @param hold: receives the frame ticks of the show record
+	// @return bool: false if the data ran out before a show record.
+	static bool Unpack(const uint8_t* data, uint16_t dataLength, uint16_t& position, uint8_t& hold);
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !HALO_PACK_H
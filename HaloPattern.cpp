@@ -20,12 +20,29 @@
 #include "HaloPattern.h"
 #include "LaserTarget.h"
 #include "TLC5957.h"
+#include "HaloSPI.h"
+#include "HaloFlush.h"
+#include "HaloFramebuffer.h"
+#include "HaloGamma.h"
+#include "HaloCompositor.h"
 
 /************************************************************************/
 /*                         #define declarations                         */
 /************************************************************************/
 
-#define RGB_LED_COUNT 16
+// READFC needs 11 clocks of latch to copy the FC register to the common shift register
+#define LATCH_READFC 11
+
+// GPIO pins that clock the common shift register for read back
+#ifdef HALO_SPI_TRANSPORT
+#define SHIFT_OUT   HALO_SPI_OUT
+#define SHIFT_CLK   HALO_SPI_CLK
+#define SHIFT_SIN   HALO_SPI_SIMO
+#else
+#define SHIFT_OUT   HALO_DATA_OUT
+#define SHIFT_CLK   HALO_CLK_SIG
+#define SHIFT_SIN   HALO_DATA_LED
+#endif
 
 /************************************************************************/
 /*                         Forward declarations                         */
@@ -36,6 +53,67 @@ uint8_t Bezel_RGB = BEZEL_BLUE;
 /*                     Data structures declarations                     */
 /************************************************************************/
 
+static_assert(0 == HALO_POKER_PWM_BITS
+    || (HALO_POKER_PWM_BITS >= POKER_PWM_BITS_MIN && HALO_POKER_PWM_BITS <= POKER_PWM_BITS_MAX),
+    "HALO_POKER_PWM_BITS must be 0 or 9 - 16");
+
+// number of latched groups per frame: outputs in conventional mode, bit-planes in poker trans mode
+#define CHASE_STREAM_GROUPS ((0 == HALO_POKER_PWM_BITS) ? TLC5957_OUTPUT_COUNT : HALO_POKER_PWM_BITS)
+#define CHASE_STREAM_WORDS (CHASE_STREAM_GROUPS * HALO_CHIP_COUNT * RGB_CHANNEL_COUNT)
+
+// Largest chase table worth keeping in FRAM. Longer chains render the chase at run time instead.
+#define CHASE_TABLE_MAX_BYTES 8192
+#if (RGB_CHANNEL_COUNT * RGB_LED_COUNT * CHASE_STREAM_WORDS * 2) <= CHASE_TABLE_MAX_BYTES
+#define CHASE_TABLE
+#endif
+
+#ifdef CHASE_TABLE
+// Transfer words for every frame of the single LED chase patterns, generated at compile time.
+// One lit LED in one color is all a chase frame is, so there is nothing to render at run time.
+// The const table is placed in FRAM and replayed with HaloFramebuffer::Replay().
+struct ChaseStreams
+{
+    uint16_t Words[RGB_CHANNEL_COUNT][RGB_LED_COUNT][CHASE_STREAM_WORDS];
+
+    constexpr ChaseStreams() : Words()
+    {
+        for (uint8_t color = 0; color < RGB_CHANNEL_COUNT; color++)
+        {
+            for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+            {
+                // the frame, laid out like HaloFramebuffer::GS
+                uint16_t gs[HaloFramebuffer::WordCount] = {};
+                gs[HaloFramebuffer::LedOffset(led) + color] = 0xFFFF;
+
+                HaloFramebuffer::BuildStream(gs, HALO_POKER_PWM_BITS, Words[color][led]);
+            }
+        }
+    }
+};
+
+constexpr ChaseStreams ChaseTable;
+#endif
+
+// FC register settings for the halo.
+// We don't need anything fancy. The defaults will do, for the most part.
+constexpr FCRegisterBuilder HaloFC = FCRegisterBuilder()
+    // Tune color settings for our hardware. 
+    // NOTE: These numbers are magic as hell.
+    .With_CCB<102>()
+    .With_CCG<204>()
+    // hardware limit for Max current is based on Red's current requirement, so set Red limiter to max
+    .With_CCR<MASK_9_BIT_MAX>()
+    .With_XREFRESH(true)
+#ifdef HALO_DOUBLE_EDGE_SCLK
+    // GS data shifts at both SCLK edges once this is written
+    .With_SEL_SCK_EDGE(true)
+#endif
+    ;
+
+constexpr FCRegister HaloFCConventional = HaloFC.Build();
+// If using poker transmode, ESPWM has to be set to '1'.
+constexpr FCRegister HaloFCPoker = HaloFC.With_POKER_TRANS_MODE(true).With_ESPWM(true).Build();
+
 /************************************************************************/
 /*                         Classes declarations                         */
 /************************************************************************/
@@ -45,11 +123,11 @@ uint8_t Bezel_RGB = BEZEL_BLUE;
 /************************************************************************/
 
 /// <summary>
-///  send data most significant bit first
+///  bit-bang data on the P3 pins, most significant bit first
 /// </summary>
 /// <param name="data"></param>
 /// <param name="latchBytes">number of end bits to hold latch high for</param>
-void send16bits(uint16_t data, uint8_t latchBits=0)
+void bitBang16bits(uint16_t data, uint8_t latchBits=0)
 {
     for (int i = 16; i-- > 0;)
     {
@@ -84,188 +162,328 @@ void send16bits(uint16_t data, uint8_t latchBits=0)
     HALO_DATA_OUT &= ~HALO_LATCH_LED;
 }
 
-
-// Draws a frame for the pattern
-// @param currentFrame: The current animation frame. Zero indexed. (First frame is frame 0)
-// @return bool: true if the pattern has a next frame.
-bool RedCW(uint16_t currentFrame)
+/// <summary>
+///  bit-bang data on the P3 pins, most significant bit first, one bit on each SCLK edge.
+///  Only valid for GS data once SEL_SCK_EDGE is set. FC data can only shift at the rising edge of SCLK.
+///  Takes 2 port writes per bit (SIN, SCLK toggle) instead of 3.
+/// </summary>
+/// <param name="data"></param>
+/// <param name="latchBytes">number of end rising edges to hold latch high for</param>
+void doubleEdge16bits(uint16_t data, uint8_t latchBits=0)
 {
-    uint8_t latch_count = 0;
-    bool retval=true;
-    if (currentFrame >= RGB_LED_COUNT)
+    // bit i shifts in on the rising edge when i is odd, and on the falling edge when i is even.
+    // Latch commands are counted on the rising edges only.
+    for (uint8_t pair = 8; pair-- > 0;)
     {
-        currentFrame = 0;
-        retval=false;
+        if (pair < latchBits)
+        {
+            // set latch data
+            HALO_DATA_OUT |= HALO_LATCH_LED;
+        }
+
+        if (data & 0x8000)
+        {
+            HALO_DATA_OUT |= HALO_DATA_LED;
+        }
+        else
+        {
+            HALO_DATA_OUT &= ~HALO_DATA_LED;
+        }
+        //output clock high
+        HALO_DATA_OUT ^= HALO_CLK_SIG;
+
+        if (data & 0x4000)
+        {
+            HALO_DATA_OUT |= HALO_DATA_LED;
+        }
+        else
+        {
+            HALO_DATA_OUT &= ~HALO_DATA_LED;
+        }
+        //output clock low
+        HALO_DATA_OUT ^= HALO_CLK_SIG;
+
+        data <<= 2;
     }
-    // Turn off halo
-    P6OUT &= ~BIT0;
 
-    // for each RGB LED, output a 1 for the active frame red LED and 0 for all others
-    // LED data should be sent Blue, green, red.
-    // halo position loop
-    for (uint8_t k = RGB_LED_COUNT; k-- > 0;)
+    // latch data
+    HALO_DATA_OUT &= ~HALO_LATCH_LED;
+}
+
+/// <summary>
+///  send data most significant bit first
+/// </summary>
+/// <param name="data"></param>
+/// <param name="latchBytes">number of end bits to hold latch high for</param>
+void send16bits(uint16_t data, uint8_t latchBits)
+{
+#if defined(HALO_SPI_TRANSPORT)
+    HaloSPI::Send16(data, latchBits);
+#elif defined(HALO_DOUBLE_EDGE_SCLK)
+    doubleEdge16bits(data, latchBits);
+#else
+    bitBang16bits(data, latchBits);
+#endif
+}
+
+/// <summary>
+///  send FC data most significant bit first. FC data can only shift at the rising edge of SCLK
+/// </summary>
+/// <param name="data"></param>
+/// <param name="latchBytes">number of end bits to hold latch high for</param>
+static void sendFC16bits(uint16_t data, uint8_t latchBits=0)
+{
+    // a background GS frame owns the pins until it completes
+    HaloFlush::Wait();
+#if defined(HALO_SPI_TRANSPORT)
+    HaloSPI::Send16(data, latchBits);
+#else
+    bitBang16bits(data, latchBits);
+#endif
+}
+
+
+/// <summary>
+///  clock 16 bits out of the TLC5957 common shift register on SOUT, most significant bit first.
+///  SIN is held low, so the shift register is left full of zeros.
+/// </summary>
+static uint16_t shiftIn16bits()
+{
+    uint16_t data = 0;
+
+    HaloFlush::Wait();
+#ifdef HALO_SPI_TRANSPORT
+    // hand SIN/SCLK back to GPIO
+    HaloSPI::WaitIdle();
+    HALO_SPI_SEL0 &= ~(HALO_SPI_CLK | HALO_SPI_SIMO);
+#endif
+    SHIFT_OUT &= ~SHIFT_SIN;
+
+#ifdef HALO_DOUBLE_EDGE_SCLK
+    // the common shift register moves on both SCLK edges, so SOUT has a new bit after each one
+    for (uint8_t pair = 8; pair-- > 0;)
     {
-        // RGB loop
-        //The sending sequence is from MSB to LSB, from Blue color to Green color, and finally, Red color.
-        for (uint8_t j = 3; j-- > 0;)
+        data <<= 1;
+        if (HALO_SOUT_IN & HALO_SOUT)
         {
-            // last color of the RGB cluster?
-            if (0 == j)
-            {
-                if (0 != k)
-                {
-                    // WRTGS need 1 clock of latch to write data to GS register
-                    latch_count = 1;
-                }
-                else if (0 == k)
-                {
-                    // LATGS need 3 clock of latch to write data to GS register
-                    latch_count = 3;
-                }
-            }
-            else
-            {
-                latch_count = 0;
-            }
-            
+            data |= 1;
+        }
+        SHIFT_OUT ^= SHIFT_CLK;
 
-            if (k == currentFrame && 0 == j)
-            {
-                send16bits(0xFFFF, latch_count);
-            }
-            else
-            {
-                send16bits(0x0000, latch_count);
-            }
+        data <<= 1;
+        if (HALO_SOUT_IN & HALO_SOUT)
+        {
+            data |= 1;
         }
+        SHIFT_OUT ^= SHIFT_CLK;
     }
+#else
+    for (uint8_t i = 16; i-- > 0;)
+    {
+        // SOUT changes TD0 after the rising edge, so sample just before it
+        data <<= 1;
+        if (HALO_SOUT_IN & HALO_SOUT)
+        {
+            data |= 1;
+        }
 
-    // turn on halo
-    P6OUT |= BIT0;
-    return retval;
+        //output clock high
+        SHIFT_OUT |= SHIFT_CLK;
+        //output clock low
+        SHIFT_OUT &= ~SHIFT_CLK;
+    }
+#endif
+
+#ifdef HALO_SPI_TRANSPORT
+    // give the pins back to the eUSCI
+    HALO_SPI_SEL0 |= HALO_SPI_CLK | HALO_SPI_SIMO;
+#endif
+
+    return data;
 }
 
-// Draws a frame for the pattern
+// Draws a frame of a single LED chasing clockwise around the halo into the background layer
 // @param currentFrame: The current animation frame. Zero indexed. (First frame is frame 0)
+// @param color: the color of the lit LED
 // @return bool: true if the pattern has a next frame.
-bool BlueCW(uint16_t currentFrame)
+static bool chaseCW(uint16_t currentFrame, HaloColor color)
 {
-    uint8_t latch_count = 0;
     bool retval = true;
     if (currentFrame >= RGB_LED_COUNT)
     {
         currentFrame = 0;
         retval = false;
     }
-    // Turn off halo
-    P6OUT &= ~BIT0;
 
-    // for each RGB LED, output a 1 for the active frame red LED and 0 for all others
-    // LED data should be sent Blue, green, red.
-    // halo position loop
-    for (uint8_t k = RGB_LED_COUNT; k-- > 0;)
+    // output a 1 for the active frame LED and 0 for all others
+    HaloRGB lit = { 0, 0, 0 };
+    switch (color)
     {
-        // RGB loop
-        //The sending sequence is from MSB to LSB, from Blue color to Green color, and finally, Red color.
-        for (uint8_t j = 3; j-- > 0;)
-        {
-            // last color of the RGB cluster?
-            if (0 == j)
-            {
-                if (0 != k)
-                {
-                    // WRTGS need 1 clock of latch to write data to GS register
-                    latch_count = 1;
-                }
-                else if (0 == k)
-                {
-                    // LATGS need 3 clock of latch to write data to GS register
-                    latch_count = 3;
-                }
-            }
-            else
-            {
-                latch_count = 0;
-            }
+    case HaloColor::Red: lit.Red = 0xFF; break;
+    case HaloColor::Green: lit.Green = 0xFF; break;
+    default: lit.Blue = 0xFF; break;
+    }
 
+    HaloLayer& background = HaloCompositor::Layer(HaloLayerId::Background);
+    background.Clear();
+    background.SetPixel(currentFrame, lit);
 
-            if (k == currentFrame && 2 == j)
-            {
-                send16bits(0xFFFF, latch_count);
-            }
-            else
-            {
-                send16bits(0x0000, latch_count);
-            }
-        }
+#ifdef CHASE_TABLE
+    if ((HaloFrame.GetPokerBits() == HALO_POKER_PWM_BITS) && (HALO_BRIGHTNESS_MAX == HaloGamma::GetBrightness())
+        && HaloCompositor::OverlaysEmpty())
+    {
+        // Nothing covers the background, and the precompiled frame matches the current GS trans mode and brightness.
+        // Send it straight to the halo, the compositor has nothing left to do this frame.
+        HaloFrame.Replay(ChaseTable.Words[(uint8_t)color][currentFrame]);
+        HaloCompositor::Presented();
     }
+#endif
 
-    // turn on halo
-    P6OUT |= BIT0;
     return retval;
 }
+
+// Draws a frame for the pattern
+// @param currentFrame: The current animation frame. Zero indexed. (First frame is frame 0)
+// @return bool: true if the pattern has a next frame.
+bool RedCW(uint16_t currentFrame)
+{
+    return chaseCW(currentFrame, HaloColor::Red);
+}
+
+// Draws a frame for the pattern
+// @param currentFrame: The current animation frame. Zero indexed. (First frame is frame 0)
+// @return bool: true if the pattern has a next frame.
+bool BlueCW(uint16_t currentFrame)
+{
+    return chaseCW(currentFrame, HaloColor::Blue);
+}
+
 // Draws a frame for the pattern
 // @param currentFrame: The current animation frame. Zero indexed. (First frame is frame 0)
 // @return bool: true if the pattern has a next frame.
 bool GreenCW(uint16_t currentFrame)
 {
-    uint8_t latch_count = 0;
-    bool retval = true;
-    if (currentFrame >= RGB_LED_COUNT)
+    return chaseCW(currentFrame, HaloColor::Green);
+}
+
+// Draws a frame for the pattern: the color wheel once around the halo, turning clockwise
+// @param currentFrame: The current animation frame. Zero indexed. (First frame is frame 0)
+// @return bool: true if the pattern has a next frame.
+bool RainbowCW(uint16_t currentFrame)
+{
+    // one hue step per frame, so a full turn of the wheel is 256 frames
+    uint8_t startHue = (uint8_t)(0 - currentFrame);
+    HaloColorWheel::FillRainbow(HaloCompositor::Layer(HaloLayerId::Background), startHue, 256 / RGB_LED_COUNT,
+        255, 255);
+    return (currentFrame < 255);
+}
+
+// Draws a frame for the pattern: the heat scale once around the halo, turning clockwise
+// @param currentFrame: The current animation frame. Zero indexed. (First frame is frame 0)
+// @return bool: true if the pattern has a next frame.
+bool HeatCW(uint16_t currentFrame)
+{
+    uint8_t temperatures[RGB_LED_COUNT];
+    uint8_t hottest = (uint8_t)(currentFrame % RGB_LED_COUNT);
+    for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
     {
-        currentFrame = 0;
-        retval = false;
+        // cooling off behind the hottest LED
+        uint8_t behind = (uint8_t)(hottest + RGB_LED_COUNT - led) % RGB_LED_COUNT;
+        temperatures[led] = 255 - behind * (256 / RGB_LED_COUNT);
     }
-    // Turn off halo
-    P6OUT &= ~BIT0;
+    HaloColorWheel::FillHeat(HaloCompositor::Layer(HaloLayerId::Background), temperatures);
+    return (currentFrame < RGB_LED_COUNT - 1);
+}
+
+bool InitLEDController()
+{
+#ifdef HALO_SPI_TRANSPORT
+    HaloSPI::Init();
+#endif
+    HaloFlush::Init();
+
+    // SOUT is an input
+    HALO_SOUT_DIR &= ~HALO_SOUT;
+
+    SetPokerTransMode(HALO_POKER_PWM_BITS);
+
+    return VerifyFCRegister();
+}
+
+bool VerifyFCRegister()
+{
+    const FCRegister& expected = (0 != HaloFrame.GetPokerBits()) ? HaloFCPoker : HaloFCConventional;
 
-    // for each RGB LED, output a 1 for the active frame red LED and 0 for all others
-    // LED data should be sent Blue, green, red.
-    // halo position loop
-    for (uint8_t k = RGB_LED_COUNT; k-- > 0;)
+    // READFC copies the FC register to the common shift register at the falling edge of LAT.
+    // Like the FC write, it is decoded from rising edges only.
+    sendFC16bits(0x0000, LATCH_READFC);
+
+    // every chip in the chain holds the same FC data
+    bool match = true;
+    for (uint8_t chip = HALO_CHIP_COUNT; chip-- > 0;)
     {
-        // RGB loop
-        //The sending sequence is from MSB to LSB, from Blue color to Green color, and finally, Red color.
-        for (uint8_t j = 3; j-- > 0;)
+        match &= (shiftIn16bits() == expected.Register_high);
+        match &= (shiftIn16bits() == expected.Register_mid);
+        match &= (shiftIn16bits() == expected.Register_low);
+    }
+
+    return match;
+}
+
+void ReadLEDOpenDetect(uint16_t openLEDs[HALO_CHIP_COUNT][RGB_CHANNEL_COUNT])
+{
+    // The LOD result was loaded into the common shift register by the last LATGS.
+    // SOUT of the last chip in the chain comes out first, and each chip in the same channel order
+    // the GS data went in: last output first, Blue, Green, Red.
+    for (uint8_t chip = HALO_CHIP_COUNT; chip-- > 0;)
+    {
+        for (uint8_t j = RGB_CHANNEL_COUNT; j-- > 0;)
         {
-            // last color of the RGB cluster?
-            if (0 == j)
+            openLEDs[chip][j] = 0;
+        }
+
+        uint8_t output = TLC5957_OUTPUT_COUNT - 1;
+        uint8_t color = RGB_CHANNEL_COUNT - 1;
+        for (uint8_t w = RGB_CHANNEL_COUNT; w-- > 0;)
+        {
+            uint16_t lod = shiftIn16bits();
+            for (uint8_t b = 16; b-- > 0;)
             {
-                if (0 != k)
+                if (lod & 0x8000)
                 {
-                    // WRTGS need 1 clock of latch to write data to GS register
-                    latch_count = 1;
+                    openLEDs[chip][color] |= (1 << output);
                 }
-                else if (0 == k)
+                lod <<= 1;
+
+                if (0 == color)
                 {
-                    // LATGS need 3 clock of latch to write data to GS register
-                    latch_count = 3;
+                    color = RGB_CHANNEL_COUNT - 1;
+                    output--;
+                }
+                else
+                {
+                    color--;
                 }
-            }
-            else
-            {
-                latch_count = 0;
-            }
-
-
-            if (k == currentFrame && 1 == j)
-            {
-                send16bits(0xFFFF, latch_count);
-            }
-            else
-            {
-                send16bits(0x0000, latch_count);
             }
         }
     }
-
-    // turn on halo
-    P6OUT |= BIT0;
-    return retval;
 }
 
-void InitLEDController()
+void SetPokerTransMode(uint8_t pwmBits)
 {
+    // let the frame in flight finish in the mode it was built for
+    HaloFlush::Wait();
+
+    HaloFrame.SetPokerBits(pwmBits);
+    bool poker = (0 != HaloFrame.GetPokerBits());
+    HaloGamma::SetPwmBits(HaloFrame.GetPokerBits());
+
+#ifdef HALO_SPI_TRANSPORT
+    // Unlock FC register
+    // 15 SCLK rising edge must be input while LAT is high.
+    // SIN data doesnt matter. Set it high just cuz;
+    HaloSPI::SendBits(0xFFFF, 15, 15);
+#else
     // SIN data doesnt matter. Set it high just cuz;
     HALO_DATA_OUT |= HALO_DATA_LED;
 
@@ -280,27 +498,26 @@ void InitLEDController()
         HALO_DATA_OUT &= ~HALO_CLK_SIG;
     }
     HALO_DATA_OUT &= ~HALO_LATCH_LED;
+#endif
 
 
     // The TI chip requires atleast 80ns before we can write the data.
-    // So we will take the time to create the FC Register buffers here.
-    FCRegister fc_register;
-    // We don't need anything fancy. The defaults will do, for the most part.
-    fc_register.SetBits_default();
-    // Tune color settings for our hardware. 
-    // NOTE: These numbers are magic as hell.
-    fc_register.SetBit_CCB(102);
-    fc_register.SetBit_CCG(204);
-    // hardware limit for Max current is based on Red's current requirement, so set Red limiter to max
-    fc_register.SetBit_CCR(0xFFFF);
-    fc_register.SetBit_XREFRESH(true);
+    // The FC words are built at compile time now, so wait it out. (2 cycles at 16MHz = 125ns)
+    __delay_cycles(2);
+    const FCRegister& fc_register = poker ? HaloFCPoker : HaloFCConventional;
 
-    send16bits(fc_register.Register_high);
-    send16bits(fc_register.Register_mid);
-    // 5 SCLK rising edge must be input while LAT is high.
-    // The 48 - bit of common shift register is copied to FC register at the falling edge of LAT
-    send16bits(fc_register.Register_low, 5);
+    // the same 48 bits for every chip in the chain, WRTFC once the last chip's copy has reached it
+    for (uint8_t chip = HALO_CHIP_COUNT; chip-- > 0;)
+    {
+        sendFC16bits(fc_register.Register_high);
+        sendFC16bits(fc_register.Register_mid);
+        // 5 SCLK rising edge must be input while LAT is high.
+        // The 48 - bit of common shift register is copied to FC register at the falling edge of LAT
+        sendFC16bits(fc_register.Register_low, (0 == chip) ? 5 : 0);
+    }
 
+    // GS latches are in an unknown state, so the first frame must always go out
+    HaloFrame.Invalidate();
 }
 
 
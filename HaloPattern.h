@@ -20,6 +20,8 @@
 
 #include <stdint.h>
 
+#include "HaloFramebuffer.h"
+
 /************************************************************************/
 /*                         #define declarations                         */
 /************************************************************************/
@@ -40,6 +42,11 @@
 /*                         Routine declarations                         */
 /************************************************************************/
 
+// send data most significant bit first
+// @param data: the GS/FC word
+// @param latchBits: number of end bits to hold latch high for
+void send16bits(uint16_t data, uint8_t latchBits = 0);
+
 // Draws a frame for the pattern
 // @return bool: true if the pattern has a next frame.
 bool RedCW(uint16_t currentFrame);
@@ -54,7 +61,33 @@ bool BlueCW(uint16_t currentFrame);
 // @return bool: true if the pattern has a next frame.
 bool GreenCW(uint16_t currentFrame);
 
-void InitLEDController();
+// Draws a frame for the pattern: the color wheel once around the halo, turning clockwise
+// @param currentFrame: The current animation frame. Zero indexed. (First frame is frame 0)
+// @return bool: true if the pattern has a next frame.
+bool RainbowCW(uint16_t currentFrame);
+
+// Draws a frame for the pattern: the heat scale once around the halo, turning clockwise
+// @param currentFrame: The current animation frame. Zero indexed. (First frame is frame 0)
+// @return bool: true if the pattern has a next frame.
+bool HeatCW(uint16_t currentFrame);
+
+// Configure the TLC5957 and write its FC register.
+// @return bool: true if the FC register read back with the intended value.
+bool InitLEDController();
+
+// Read the FC register back over SOUT (READFC) and compare it with the value last written.
+// @return bool: true if the FC register holds the intended value.
+bool VerifyFCRegister();
+
+// Read the LED open detection result over SOUT.
+// LOD only checks outputs that were on, so call this right after a frame has been latched (LATGS).
+// @param openLEDs: one bitmap per color for each chip in the chain, indexed [chip][HaloColor].
+//                  Bit n is set when output n of that chip is open.
+void ReadLEDOpenDetect(uint16_t openLEDs[HALO_CHIP_COUNT][RGB_CHANNEL_COUNT]);
+
+// Switch the TLC5957 between conventional and poker GS trans mode and rewrite its FC register.
+// @param pwmBits: PWM depth for poker trans mode, 9 to 16. 0 selects the conventional 16-bit GS transfer.
+void SetPokerTransMode(uint8_t pwmBits);
 
 #endif // !HALO_PATTERN_H
 
@@ -0,0 +1,270 @@
+/**
+* @brief      Hardware SPI transport for the TLC5957 halo driver
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Shifts halo GS/FC data out through eUSCI_B1 in 3-pin SPI master mode.
+*               The TLC5957 decodes its commands from the number of SCLK rising edges seen while LAT is high
+*               (WRTGS = 1, LATGS = 3, WRTFC = 5, FCWRTEN = 15), which the eUSCI cannot time on its own.
+*               Words that carry a latch command therefore send their high byte through the eUSCI,
+*               then hand SIN/SCLK back to GPIO and bit-bang the remaining bits with LAT on HALO_LATCH_LED.
+*               Whole frames can also be streamed in the background from the TX interrupt. The interrupt only feeds
+*               the eUSCI: it hands the latched tail of each group to Service(), which HaloFlush runs from the
+*               TB0 CCR2 interrupt a few ticks later, so the TX interrupt never waits for the eUSCI to drain.
+*
+* @link       Datasheets:
+*             TI User Guide (MSP430FR2355): https://www.ti.com/lit/ug/slau445i/slau445i.pdf
+*             TI TLC5957 LED Driver : https://www.ti.com/lit/ds/symlink/tlc5957.pdf
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "LaserTarget.h"
+#include "HaloSPI.h"
+#include "HaloFlush.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// WRTGS need 1 clock of latch to write data to GS register
+#define LATCH_WRTGS 1
+// LATGS need 3 clock of latch to write data to GS register
+#define LATCH_LATGS 3
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+const uint16_t* volatile HaloSPI::streamWord = nullptr;
+volatile uint8_t HaloSPI::streamGroups = 0;
+volatile uint8_t HaloSPI::streamPart = 0;
+uint8_t HaloSPI::streamGroupPart = 0;
+volatile bool HaloSPI::streamLowByte = false;
+volatile bool HaloSPI::streamTail = false;
+uint8_t HaloSPI::streamTailByte = 0;
+void (*volatile HaloSPI::streamComplete)(void) = nullptr;
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+void HaloSPI::Init()
+{
+    // Hold the eUSCI in reset while it is configured
+    UCB1CTLW0 = UCSWRST;
+
+    // SPI master, 3-pin, synchronous, MSB first.
+    // UCCKPH: data is changed on the falling edge and captured by the TLC5957 on the rising edge.
+    // Clock idles low (UCCKPL = 0) so handing the pin back to GPIO does not create an extra edge.
+    UCB1CTLW0 |= UCMST | UCSYNC | UCMSB | UCCKPH | UCMODE_0 | UCSSEL__SMCLK;
+
+    // SCLK = SMCLK / 1
+    UCB1BRW = 1;
+
+    // SCLK idles low while the pins are in GPIO mode
+    HALO_SPI_OUT &= ~(HALO_SPI_CLK | HALO_SPI_SIMO);
+    P4DIR |= HALO_SPI_CLK | HALO_SPI_SIMO;
+
+    // select eUSCI_B1 primary function for SIMO/CLK
+    HALO_SPI_SEL1 &= ~(HALO_SPI_CLK | HALO_SPI_SIMO);
+    HALO_SPI_SEL0 |= HALO_SPI_CLK | HALO_SPI_SIMO;
+
+    // LAT is always a GPIO
+    HALO_DATA_OUT &= ~HALO_LATCH_LED;
+
+    // eUSCI_B reset released for operation.
+    UCB1CTLW0 &= ~UCSWRST;
+}
+
+void HaloSPI::Send16(uint16_t data, uint8_t latchBits)
+{
+    if (latchBits > 8)
+    {
+        // the whole word overlaps the latch window
+        WaitIdle();
+        SendBits(data, 16, latchBits);
+        return;
+    }
+
+    // high byte never carries a latch, let the hardware shift it
+    while (!(UCB1IFG & UCTXIFG));
+    UCB1TXBUF = data >> 8;
+
+    if (0 == latchBits)
+    {
+        while (!(UCB1IFG & UCTXIFG));
+        UCB1TXBUF = data & 0xFF;
+        return;
+    }
+
+    // LAT has to rise before the last latchBits rising edges,
+    // so the low byte is clocked by hand once the high byte has left the shift register
+    WaitIdle();
+    SendBits(data, 8, latchBits);
+}
+
+void HaloSPI::SendBits(uint16_t data, uint8_t bitCount, uint8_t latchBits)
+{
+    // hand SIN/SCLK back to GPIO
+    HALO_SPI_SEL0 &= ~(HALO_SPI_CLK | HALO_SPI_SIMO);
+
+    for (uint8_t i = bitCount; i-- > 0;)
+    {
+        if (i < latchBits)
+        {
+            // set latch data
+            HALO_DATA_OUT |= HALO_LATCH_LED;
+        }
+
+        if (data & (1 << i))
+        {
+            HALO_SPI_OUT |= HALO_SPI_SIMO;
+        }
+        else
+        {
+            HALO_SPI_OUT &= ~HALO_SPI_SIMO;
+        }
+
+        //output clock high
+        HALO_SPI_OUT |= HALO_SPI_CLK;
+        //output clock low
+        HALO_SPI_OUT &= ~HALO_SPI_CLK;
+    }
+
+    // latch data
+    HALO_DATA_OUT &= ~HALO_LATCH_LED;
+
+    // give the pins back to the eUSCI
+    HALO_SPI_SEL0 |= HALO_SPI_CLK | HALO_SPI_SIMO;
+}
+
+void HaloSPI::WaitIdle()
+{
+    while (UCB1STATW & UCBUSY);
+}
+
+void HaloSPI::StartStream(const uint16_t* words, uint8_t groupWords, uint8_t groups, void (*onComplete)(void))
+{
+    streamWord = words;
+    streamGroupPart = groupWords - 1;
+    streamPart = streamGroupPart;
+    streamLowByte = false;
+    streamTail = false;
+    streamComplete = onComplete;
+    streamGroups = groups;
+
+    // TXIFG is already set while TXBUF is empty, so the first byte goes out straight away
+    UCB1IE |= UCTXIE;
+}
+
+void HaloSPI::Service()
+{
+    if (!streamTail)
+    {
+        return;
+    }
+
+    // the ISR has stopped, so the stream state is ours until UCTXIE is set again
+    uint8_t groups = streamGroups - 1;
+    WaitIdle();
+    SendBits(streamTailByte, 8, (0 == groups) ? LATCH_LATGS : LATCH_WRTGS);
+    streamPart = streamGroupPart;
+    streamTail = false;
+
+    if (0 == groups)
+    {
+        if (nullptr != streamComplete)
+        {
+            streamComplete();
+        }
+        streamGroups = 0;
+        return;
+    }
+    streamGroups = groups;
+    UCB1IE |= UCTXIE;
+}
+
+bool HaloSPI::StreamBusy()
+{
+    return (0 != streamGroups);
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
+#ifdef HALO_ASYNC_FLUSH
+// eUSCI_B1 interrupt handler
+// Feeds the background stream one byte per TX buffer empty interrupt
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector=USCI_B1_VECTOR
+__interrupt void USCI_B1_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__((interrupt(USCI_B1_VECTOR))) USCI_B1_ISR(void)
+#else
+#error Compiler not supported!
+#endif
+{
+    switch (__even_in_range(UCB1IV, 4))
+    {
+    case  0: break;                          // No interrupt
+    case  2: break;                          // rx buffer full
+    case  4:                                 // Tx buffer empty
+        if (!HaloSPI::streamLowByte)
+        {
+            // high byte never carries a latch
+            UCB1TXBUF = *HaloSPI::streamWord >> 8;
+            HaloSPI::streamLowByte = true;
+        }
+        else
+        {
+            uint16_t word = *HaloSPI::streamWord;
+            HaloSPI::streamWord++;
+            HaloSPI::streamLowByte = false;
+
+            if (0 != HaloSPI::streamPart)
+            {
+                UCB1TXBUF = word & 0xFF;
+                HaloSPI::streamPart--;
+            }
+            else
+            {
+                // last word of the group, the low byte is clocked by hand under LAT.
+                // That is left to Service() from the CCR2 interrupt, once the eUSCI has shifted the high byte out.
+                // It re-enables this interrupt for the next group.
+                UCB1IE &= ~UCTXIE;
+                HaloSPI::streamTailByte = word & 0xFF;
+                HaloSPI::streamTail = true;
+                HaloFlush::Schedule(HALO_FLUSH_TAIL_GAP);
+            }
+        }
+        break;
+    default: break;
+    }
+}
+#endif
@@ -0,0 +1,113 @@
+/**
+* @brief      Hardware SPI transport for the TLC5957 halo driver
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Shifts halo GS/FC data out through eUSCI_B1 in 3-pin SPI master mode.
+*               The TLC5957 decodes its commands from the number of SCLK rising edges seen while LAT is high
+*               (WRTGS = 1, LATGS = 3, WRTFC = 5, FCWRTEN = 15), which the eUSCI cannot time on its own.
+*               Words that carry a latch command therefore send their high byte through the eUSCI,
+*               then hand SIN/SCLK back to GPIO and bit-bang the remaining bits with LAT on HALO_LATCH_LED.
+*               Whole frames can also be streamed in the background from the TX interrupt. The interrupt only feeds
+*               the eUSCI: it hands the latched tail of each group to Service(), which HaloFlush runs from the
+*               TB0 CCR2 interrupt a few ticks later, so the TX interrupt never waits for the eUSCI to drain.
+*
+* @link       Datasheets:
+*             TI User Guide (MSP430FR2355): https://www.ti.com/lit/ug/slau445i/slau445i.pdf
+*             TI TLC5957 LED Driver : https://www.ti.com/lit/ds/symlink/tlc5957.pdf
+**/
+
+#pragma once
+#ifndef HALO_SPI_H
+#define HALO_SPI_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <msp430.h>
+#include <stdint.h>
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+__interrupt void USCI_B1_ISR(void);
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+class HaloSPI
+{
+	friend __interrupt void USCI_B1_ISR(void);
+
+	// background stream: next word to send
+	static const uint16_t* volatile streamWord;
+	// background stream: latched groups left to send
+	volatile static uint8_t streamGroups;
+	// background stream: unlatched words left in the current group
+	volatile static uint8_t streamPart;
+	// background stream: unlatched words at the start of each group
+	static uint8_t streamGroupPart;
+	// background stream: true when the high byte of streamWord has been sent
+	volatile static bool streamLowByte;
+	// background stream: true while the stream waits for Service() to send the latched tail of a group
+	volatile static bool streamTail;
+	// background stream: low byte of the last word of the group, sent by Service()
+	static uint8_t streamTailByte;
+	// background stream: called once the last word has been latched
+	static void (*volatile streamComplete)(void);
+
+public:
+
+	// Configure eUSCI_B1 as SPI master (MSB first, data captured on the rising SCLK edge)
+	// and route SIN/SCLK to the peripheral.
+	static void Init();
+
+	// Send 16 bits, most significant bit first.
+	// @param data: the word to shift out
+	// @param latchBits: number of end bits to hold LAT high for (0 for none)
+	static void Send16(uint16_t data, uint8_t latchBits);
+
+	// Bit-bang the lowest bitCount bits of data on the SPI pins, most significant bit first,
+	// holding LAT high for the last latchBits clocks.
+	// Used for the latched tail of a word and for commands that are not a multiple of 8 clocks (FCWRTEN).
+	static void SendBits(uint16_t data, uint8_t bitCount, uint8_t latchBits);
+
+	// Block until the eUSCI has finished shifting out everything written to it.
+	static void WaitIdle();
+
+	// Send a stream of words in the background, one byte per eUSCI_B1 TX interrupt.
+	// The last word of each group is latched with WRTGS (LATGS for the last group),
+	// which is the layout of both a conventional and a poker mode GS frame.
+	// The stream only gets past each latch when Service() runs. Start frames with HaloFlush::Start(), which
+	// runs it from the TB0 CCR2 interrupt.
+	// @param words: the stream. Must stay untouched until the stream completes.
+	// @param groupWords: words per group, 3 for each chip in the chain
+	// @param groups: number of groups
+	// @param onComplete: called from Service() after the last latch. May be nullptr.
+	static void StartStream(const uint16_t* words, uint8_t groupWords, uint8_t groups, void (*onComplete)(void));
+
+	// Bit-bang the latched tail of a group once the ISR has handed it over, then let the stream carry on.
+	// Call from HaloFlush::Tick(), with interrupts off. Does nothing when no tail is waiting.
+	static void Service();
+
+	// @return bool: true while a background stream is running
+	static bool StreamBusy();
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !HALO_SPI_H
@@ -0,0 +1,234 @@
+/**
+* @brief      Live halo frames streamed over bluetooth
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    The phone sends one STREAM_FRAME command per frame tick: a sequence number, the frame length,
+*               and the frame as HaloPack records (only the LEDs that changed, ending with a show record).
+*               Frames wait in a small jitter buffer and are released one per frame tick, in sequence order,
+*               so uneven bluetooth delivery does not show on the halo.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "HaloStream.h"
+#include "HaloPack.h"
+#include "HaloCompositor.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+static_assert(HALO_STREAM_FRAME_BYTES < HALO_STREAM_KEYFRAME, "the frame length has to leave the keyframe bit free");
+static_assert(HALO_STREAM_PREFILL <= HALO_STREAM_DEPTH, "the jitter buffer cannot hold the prefill");
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+HaloStreamFrame HaloStream::frames[HALO_STREAM_DEPTH];
+uint8_t HaloStream::head = 0;
+uint8_t HaloStream::count = 0;
+bool HaloStream::active = false;
+bool HaloStream::playing = false;
+bool HaloStream::synced = false;
+uint8_t HaloStream::nextSequence = 0;
+uint8_t HaloStream::missedTicks = 0;
+uint16_t HaloStream::Underruns = 0;
+uint16_t HaloStream::Dropped = 0;
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+HaloStream::HaloStream()
+{
+}
+
+HaloStream::~HaloStream()
+{
+}
+
+bool HaloStream::releaseFrame()
+{
+    // throw away anything older than this tick
+    while ((0 != count) && ((int8_t)(frames[head].Sequence - nextSequence) < 0))
+    {
+        Dropped++;
+        head = (head + 1) % HALO_STREAM_DEPTH;
+        count--;
+    }
+
+    if ((0 == count) || (frames[head].Sequence != nextSequence))
+    {
+        // the halo holds the last frame, and misses whatever this one would have changed
+        Underruns++;
+        synced = false;
+        nextSequence++;
+        if (++missedTicks >= HALO_STREAM_TIMEOUT)
+        {
+            Stop();
+            return false;
+        }
+        return true;
+    }
+
+    applyFrame();
+    missedTicks = 0;
+    return true;
+}
+
+void HaloStream::applyFrame()
+{
+    HaloStreamFrame& frame = frames[head];
+    if (frame.Keyframe)
+    {
+        HaloCompositor::Layer(HaloLayerId::Background).Fill(HaloRGB{ 0, 0, 0 });
+        synced = true;
+    }
+    if (synced)
+    {
+        // streamed frames last one tick, whatever their show record says
+        uint16_t position = 0;
+        uint8_t hold;
+        synced = HaloPack::Unpack(frame.Records, frame.Length, position, hold);
+    }
+
+    head = (head + 1) % HALO_STREAM_DEPTH;
+    count--;
+    nextSequence++;
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+void HaloStream::Stop()
+{
+    active = false;
+    playing = false;
+    count = 0;
+}
+
+bool HaloStream::Active()
+{
+    return active;
+}
+
+bool HaloStream::Push(uint8_t sequence, uint8_t lengthFlags, const uint8_t* records)
+{
+    uint8_t length = lengthFlags & ~HALO_STREAM_KEYFRAME;
+    if ((nullptr == records) || (0 == length) || (length > HALO_STREAM_FRAME_BYTES))
+    {
+        Dropped++;
+        return false;
+    }
+
+    if (!active)
+    {
+        // the first frame sets the sequence the stream starts at
+        active = true;
+        playing = false;
+        synced = false;
+        head = 0;
+        count = 0;
+        nextSequence = sequence;
+        missedTicks = 0;
+    }
+    else if ((int8_t)(sequence - nextSequence) < 0)
+    {
+        if (0 != count)
+        {
+            // too late for its tick
+            Dropped++;
+            return false;
+        }
+
+        // The buffer ran dry and the phone has fallen behind the halo for good.
+        // Fill the buffer again, starting from this frame.
+        playing = false;
+        nextSequence = sequence;
+    }
+    else if (HALO_STREAM_DEPTH == count)
+    {
+        // The phone is running ahead of the halo. Skip the oldest frame to catch up.
+        // Its changes still go into the layer, so the frames after it build on the right LEDs.
+        applyFrame();
+        Dropped++;
+    }
+
+    HaloStreamFrame& frame = frames[(head + count) % HALO_STREAM_DEPTH];
+    frame.Sequence = sequence;
+    frame.Length = length;
+    frame.Keyframe = (0 != (lengthFlags & HALO_STREAM_KEYFRAME));
+    for (uint8_t i = 0; i < length; i++)
+    {
+        frame.Records[i] = records[i];
+    }
+    count++;
+    missedTicks = 0;
+    return true;
+}
+
+bool HaloStream::RenderFrame(uint8_t ticks)
+{
+    if (!active)
+    {
+        return false;
+    }
+
+    if (!playing)
+    {
+        if (count < HALO_STREAM_PREFILL)
+        {
+            // still filling the buffer, the sequence waits with it
+            if (ticks >= HALO_STREAM_TIMEOUT - missedTicks)
+            {
+                Stop();
+                return false;
+            }
+            missedTicks += ticks;
+            return true;
+        }
+        playing = true;
+        // the first frame shows at this tick
+        ticks = 1;
+    }
+
+    for (; ticks > 0; ticks--)
+    {
+        if (!releaseFrame())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
@@ -0,0 +1,127 @@
+/**
+* @brief      Live halo frames streamed over bluetooth
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    The phone sends one STREAM_FRAME command per frame tick: a sequence number, the frame length,
+*               and the frame as HaloPack records (only the LEDs that changed, ending with a show record).
+*               Frames wait in a small jitter buffer and are released one per frame tick, in sequence order,
+*               so uneven bluetooth delivery does not show on the halo.
+*
+*               Every frame builds on the one before it. A frame that arrives after its tick has gone is dropped,
+*               and a tick without a frame is counted as an underrun. Either way the halo has missed changes,
+*               so frames are ignored until the next keyframe, which the phone sends every so often and which
+*               describes the whole halo. When the phone runs ahead and the buffer is full, the oldest frame is
+*               skipped instead, but its changes still go into the layer, so the halo stays in step.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef HALO_STREAM_H
+#define HALO_STREAM_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// frames the jitter buffer holds
+#define HALO_STREAM_DEPTH 4
+// frames buffered before the first one is shown
+#define HALO_STREAM_PREFILL 2
+// longest frame, in bytes. At 9600 baud a frame tick has room for about 60 bytes.
+#define HALO_STREAM_FRAME_BYTES 64
+// set in the length byte of a keyframe, which starts from an all black halo
+#define HALO_STREAM_KEYFRAME 0x80
+// frame ticks without any frame before streaming stops and the halo goes back to the idle animation
+#define HALO_STREAM_TIMEOUT 32
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// A streamed frame waiting for its tick
+struct HaloStreamFrame
+{
+	uint8_t Sequence;
+	// record bytes in Records
+	uint8_t Length;
+	bool Keyframe;
+	uint8_t Records[HALO_STREAM_FRAME_BYTES];
+};
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+class HaloStream
+{
+	HaloStream();
+	~HaloStream();
+
+	static HaloStreamFrame frames[HALO_STREAM_DEPTH];
+	// oldest buffered frame, and the number of buffered frames
+	static uint8_t head;
+	static uint8_t count;
+
+	// true from the first frame received until Stop() or the timeout
+	static bool active;
+	// true once the buffer has been filled to HALO_STREAM_PREFILL and frames are being shown
+	static bool playing;
+	// true while the background layer holds every change sent so far, so the next frame can build on it
+	static bool synced;
+	// sequence number of the frame due at the next tick
+	static uint8_t nextSequence;
+	// frame ticks in a row without a frame
+	static uint8_t missedTicks;
+
+	// Unpack the oldest buffered frame into the background layer and remove it from the buffer
+	static void applyFrame();
+	// Play the frame due at this tick, or count an underrun.
+	// @return bool: false if streaming timed out.
+	static bool releaseFrame();
+
+public:
+	// ticks without a frame to show, since this was last cleared
+	static uint16_t Underruns;
+	// frames never shown because they came after their tick or the buffer was full, since this was last cleared
+	static uint16_t Dropped;
+
+	// Stop streaming. The background layer keeps its last frame.
+	static void Stop();
+
+	// @return bool: true while frames are being streamed
+	static bool Active();
+
+	// Add a received frame to the jitter buffer. The first frame starts streaming.
+	// @param sequence: frame number, one more for each frame tick, wrapping after 255
+	// @param lengthFlags: record bytes, with HALO_STREAM_KEYFRAME set for a keyframe
+	// @param records: HaloPack records, ending with a show record
+	// @return bool: false if the frame came too late and was dropped
+	static bool Push(uint8_t sequence, uint8_t lengthFlags, const uint8_t* records);
+
+	// Show the frames due since the last call in the background layer.
+	// HaloCompositor::Render() puts them on the halo.
+	// @param ticks: frame ticks since the last call, one frame is released per tick
+	// @return bool: false once streaming has stopped
+	static bool RenderFrame(uint8_t ticks);
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !HALO_STREAM_H
@@ -0,0 +1,410 @@
+/**
+* @brief      Keyframe bytecode interpreter for halo patterns
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Plays halo patterns stored as data instead of hand-written pattern functions.
+*               A pattern is a string of HaloOp opcodes and their operand bytes. RenderFrame() runs it into the
+*               background layer of HaloCompositor until the next frame is ready (Wait, FadeTo).
+*               Patterns can be run straight from a const FRAM table, or stored in the persistent
+*               pattern slots with the STORE_PATTERN command and played with PLAY_PATTERN.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "LaserTarget.h"
+#include "HaloVM.h"
+#include "HaloFramebuffer.h"
+#include "HaloCompositor.h"
+#include "HaloFrameRate.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+#ifdef HALO_HOST_RENDER
+#define COUNT_WORK(counter, count) (HaloVM::Work.counter += (count))
+#else
+#define COUNT_WORK(counter, count)
+#endif
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+const uint8_t* HaloVM::program = nullptr;
+uint8_t HaloVM::length = 0;
+uint8_t HaloVM::pc = 0;
+uint8_t HaloVM::waitFrames = 0;
+uint8_t HaloVM::fadeFrames = 0;
+uint8_t HaloVM::fadeElapsed = 0;
+uint8_t HaloVM::fadeTarget[RGB_CHANNEL_COUNT] = { 0 };
+uint16_t HaloVM::fadeLevel[RGB_LED_COUNT * RGB_CHANNEL_COUNT] = { 0 };
+int16_t HaloVM::fadeStep[RGB_LED_COUNT * RGB_CHANNEL_COUNT] = { 0 };
+uint8_t HaloVM::loopStart[PATTERN_LOOP_DEPTH] = { 0 };
+uint8_t HaloVM::loopCount[PATTERN_LOOP_DEPTH] = { 0 };
+uint8_t HaloVM::loopDepth = 0;
+uint8_t HaloVM::framesPerSecond = HALO_FPS_DEFAULT;
+#ifdef HALO_HOST_RENDER
+HaloVMWork HaloVM::Work;
+#endif
+
+// Pattern slots, kept in FRAM across power cycles. Byte 0 of each slot is the pattern length, 0 when empty.
+// Slot 0 ships with a blue chase, the bytecode version of BlueCW().
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma PERSISTENT(PatternSlots)
+uint8_t PatternSlots[PATTERN_SLOT_COUNT][PATTERN_SLOT_SIZE] =
+#elif defined(__GNUC__)
+uint8_t __attribute__((persistent)) PatternSlots[PATTERN_SLOT_COUNT][PATTERN_SLOT_SIZE] =
+#else
+#error Compiler not supported!
+#endif
+{
+    {
+        13,
+        (uint8_t)HaloOp::Clear,
+        (uint8_t)HaloOp::SetPixel, 0, 0x00, 0x00, 0xFF,
+        (uint8_t)HaloOp::Loop, RGB_LED_COUNT,
+        (uint8_t)HaloOp::Wait, 1,
+        (uint8_t)HaloOp::Rotate, 1,
+        (uint8_t)HaloOp::Next
+    }
+};
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+HaloVM::HaloVM()
+{
+}
+
+HaloVM::~HaloVM()
+{
+}
+
+uint8_t HaloVM::fetch()
+{
+    if (pc >= length)
+    {
+        return (uint8_t)HaloOp::End;
+    }
+    return program[pc++];
+}
+
+void HaloVM::stepFade(uint8_t frames)
+{
+    fadeFrames -= frames;
+    fadeElapsed += frames;
+
+    HaloLayer& layer = HaloCompositor::Layer(HaloLayerId::Background);
+    const uint16_t* level = fadeLevel;
+    const int16_t* step = fadeStep;
+    for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+    {
+        uint8_t rgb[RGB_CHANNEL_COUNT];
+        for (uint8_t color = 0; color < RGB_CHANNEL_COUNT; color++)
+        {
+            // The level comes from how far into the fade we are, so skipped frames cost nothing.
+            // The steps were rounded toward zero, so the last frame lands on the target exactly.
+            if (0 == fadeFrames)
+            {
+                rgb[color] = fadeTarget[color];
+            }
+            else
+            {
+                rgb[color] = (uint16_t)(*level + (int32_t)*step * fadeElapsed) >> 8;
+            }
+            level++;
+            step++;
+        }
+        layer.SetPixel(led, HaloRGB{ rgb[0], rgb[1], rgb[2] });
+    }
+    COUNT_WORK(FadeLevels, RGB_LED_COUNT * RGB_CHANNEL_COUNT);
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+void HaloVM::Load(const uint8_t* code, uint8_t codeLength)
+{
+    program = code;
+    length = codeLength;
+    pc = 0;
+    waitFrames = 0;
+    fadeFrames = 0;
+    loopDepth = 0;
+    framesPerSecond = HALO_FPS_DEFAULT;
+}
+
+bool HaloVM::LoadSlot(uint8_t slot)
+{
+    if ((slot >= PATTERN_SLOT_COUNT) || (0 == PatternSlots[slot][0]))
+    {
+        return false;
+    }
+
+    Load(&PatternSlots[slot][1], PatternSlots[slot][0]);
+    return true;
+}
+
+bool HaloVM::StorePattern(uint8_t slot, const uint8_t* code, uint8_t codeLength)
+{
+    if ((slot >= PATTERN_SLOT_COUNT) || (nullptr == code) || (0 == codeLength) || (codeLength >= PATTERN_SLOT_SIZE))
+    {
+        return false;
+    }
+
+    // the slot is about to change under a playing pattern
+    if (program == &PatternSlots[slot][1])
+    {
+        Stop();
+    }
+
+    // PERSISTENT variables live in program FRAM, which is write protected
+    SYSCFG0 = FRWPPW | DFWP;
+
+    // mark the slot empty until the whole pattern is in, so a reset part way through cannot leave half a pattern
+    PatternSlots[slot][0] = 0;
+    for (uint8_t i = 0; i < codeLength; i++)
+    {
+        PatternSlots[slot][i + 1] = code[i];
+    }
+    PatternSlots[slot][0] = codeLength;
+
+    SYSCFG0 = FRWPPW | PFWP | DFWP;
+
+    return true;
+}
+
+void HaloVM::Stop()
+{
+    program = nullptr;
+    length = 0;
+}
+
+bool HaloVM::Playing()
+{
+    return (nullptr != program);
+}
+
+uint8_t HaloVM::FrameRate()
+{
+    return framesPerSecond;
+}
+
+bool HaloVM::RenderFrame(uint8_t frames)
+{
+#ifdef HALO_HOST_RENDER
+    Work = HaloVMWork();
+#endif
+    if (nullptr == program)
+    {
+        return false;
+    }
+
+    // Play the frames owed by the last Wait or FadeTo, running the pattern on whenever they are used up.
+    // A late call plays several frames at once and only the last one is drawn.
+    while (0 != frames)
+    {
+        uint8_t played;
+        if (0 != fadeFrames)
+        {
+            played = (frames < fadeFrames) ? frames : fadeFrames;
+            stepFade(played);
+        }
+        else if (0 != waitFrames)
+        {
+            played = (frames < waitFrames) ? frames : waitFrames;
+            waitFrames -= played;
+        }
+        else
+        {
+            // every Wait and FadeTo owes at least one frame, so this always ends
+            if (!run())
+            {
+                return false;
+            }
+            continue;
+        }
+        frames -= played;
+    }
+
+    return true;
+}
+
+bool HaloVM::run()
+{
+    HaloLayer& layer = HaloCompositor::Layer(HaloLayerId::Background);
+    for (uint8_t budget = PATTERN_STEP_LIMIT; budget-- > 0;)
+    {
+        COUNT_WORK(Ops, 1);
+        switch ((HaloOp)fetch())
+        {
+        case HaloOp::Clear:
+            layer.Clear();
+            break;
+
+        case HaloOp::SetPixel:
+        {
+            uint8_t led = fetch();
+            uint8_t red = fetch();
+            uint8_t green = fetch();
+            uint8_t blue = fetch();
+            if (led < RGB_LED_COUNT)
+            {
+                layer.SetPixel(led, HaloRGB{ red, green, blue });
+            }
+            break;
+        }
+
+        case HaloOp::Fill:
+        {
+            uint8_t red = fetch();
+            uint8_t green = fetch();
+            uint8_t blue = fetch();
+            layer.Fill(HaloRGB{ red, green, blue });
+            break;
+        }
+
+        case HaloOp::Rotate:
+            layer.Rotate(fetch());
+            break;
+
+        case HaloOp::FadeTo:
+        {
+            for (uint8_t color = 0; color < RGB_CHANNEL_COUNT; color++)
+            {
+                fadeTarget[color] = fetch();
+            }
+            fadeFrames = fetch();
+            if (0 == fadeFrames)
+            {
+                fadeFrames = 1;
+            }
+            fadeElapsed = 0;
+
+            // The fade runs on intensity levels, so it is even to the eye once it goes through the gamma table.
+            // Work out the per frame steps once, so a frame is one multiply per color.
+            // The only divide is the 0.16 reciprocal of the fade length; each step is a multiply on MPY32.
+            // A single frame fade never uses its steps, which keeps every step within an int16_t.
+            uint32_t reciprocal = 0x10000UL / fadeFrames;
+            uint16_t* level = fadeLevel;
+            int16_t* step = fadeStep;
+            for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+            {
+                HaloRGB from;
+                layer.GetPixel(led, from);
+                const uint8_t start[RGB_CHANNEL_COUNT] = { from.Red, from.Green, from.Blue };
+
+                for (uint8_t color = 0; color < RGB_CHANNEL_COUNT; color++)
+                {
+                    *level = (uint16_t)start[color] << 8;
+                    // on the magnitude, so the step rounds toward zero either way
+                    uint16_t target = (uint16_t)fadeTarget[color] << 8;
+                    if (target >= *level)
+                    {
+                        *step++ = (int16_t)(((uint32_t)(target - *level) * reciprocal) >> 16);
+                    }
+                    else
+                    {
+                        *step++ = -(int16_t)(((uint32_t)(*level - target) * reciprocal) >> 16);
+                    }
+                    level++;
+                }
+            }
+            return true;
+        }
+
+        case HaloOp::Wait:
+            waitFrames = fetch();
+            if (0 == waitFrames)
+            {
+                // still shows the frame
+                waitFrames = 1;
+            }
+            return true;
+
+        case HaloOp::Loop:
+            if (loopDepth >= PATTERN_LOOP_DEPTH)
+            {
+                // nested too deep
+                Stop();
+                return false;
+            }
+            loopCount[loopDepth] = fetch();
+            loopStart[loopDepth] = pc;
+            loopDepth++;
+            break;
+
+        case HaloOp::Next:
+        {
+            if (0 == loopDepth)
+            {
+                // Next without a Loop
+                Stop();
+                return false;
+            }
+
+            uint8_t top = loopDepth - 1;
+            if (0 == loopCount[top])
+            {
+                // forever
+                pc = loopStart[top];
+            }
+            else if (0 != --loopCount[top])
+            {
+                pc = loopStart[top];
+            }
+            else
+            {
+                loopDepth--;
+            }
+            break;
+        }
+
+        case HaloOp::FrameRate:
+            // the governor clamps it
+            framesPerSecond = fetch();
+            break;
+
+        case HaloOp::End:
+        default:
+            Stop();
+            return false;
+        }
+    }
+
+    // the pattern never waits, so it would never show a frame
+    Stop();
+    return false;
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
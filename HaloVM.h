@@ -0,0 +1,176 @@
+/**
+* @brief      Keyframe bytecode interpreter for halo patterns
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Plays halo patterns stored as data instead of hand-written pattern functions.
+*               A pattern is a string of HaloOp opcodes and their operand bytes. RenderFrame() runs it into the
+*               background layer of HaloCompositor until the next frame is ready (Wait, FadeTo).
+*               Patterns can be run straight from a const FRAM table, or stored in the persistent
+*               pattern slots with the STORE_PATTERN command and played with PLAY_PATTERN.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef HALO_VM_H
+#define HALO_VM_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <msp430.h>
+#include <stdint.h>
+
+#include "HaloFramebuffer.h"
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// number of patterns kept in FRAM
+#define PATTERN_SLOT_COUNT 4
+// bytes per pattern slot. The first byte holds the pattern length.
+#define PATTERN_SLOT_SIZE 128
+// deepest Loop nesting
+#define PATTERN_LOOP_DEPTH 4
+// opcodes run per frame before a pattern that never waits is stopped
+#define PATTERN_STEP_LIMIT 64
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// Pattern opcodes. Operands follow the opcode, one byte each.
+// Colors are 8-bit intensity levels, turned into GS values by the compositor.
+enum class HaloOp : uint8_t
+{
+	// Stop the pattern. Also what an empty slot or running off the end reads as.
+	End,
+	// All LEDs off
+	Clear,
+	// led, red, green, blue: set one LED
+	SetPixel,
+	// red, green, blue: set every LED
+	Fill,
+	// steps: move every LED towards the higher positions, wrapping around
+	Rotate,
+	// red, green, blue, frames: fade every LED to the color over a number of frames
+	FadeTo,
+	// frames: show the frame and hold it for a number of frames
+	Wait,
+	// count: start of a loop body, run count times (0 loops forever)
+	Loop,
+	// end of the innermost loop body
+	Next,
+	// fps: frame ticks per second from here on, HALO_FPS_MIN to HALO_FPS_MAX. Wait and FadeTo count these ticks.
+	FrameRate
+};
+
+#ifdef HALO_HOST_RENDER
+// What the last RenderFrame() did, for the cost model in tools/halorender
+struct HaloVMWork
+{
+	// opcodes run
+	uint16_t Ops;
+	// FadeTo levels worked out
+	uint16_t FadeLevels;
+};
+#endif
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+class HaloVM
+{
+	HaloVM();
+	~HaloVM();
+
+	// the pattern being played. nullptr when stopped
+	static const uint8_t* program;
+	static uint8_t length;
+	// next opcode
+	static uint8_t pc;
+
+	// frames left of the current Wait
+	static uint8_t waitFrames;
+	// frames left of the current FadeTo
+	static uint8_t fadeFrames;
+	// frames of the current FadeTo already played
+	static uint8_t fadeElapsed;
+	// FadeTo color, as intensity levels
+	static uint8_t fadeTarget[RGB_CHANNEL_COUNT];
+	// intensity level of each color of each LED when the FadeTo started, 8.8 fixed point,
+	// indexed [led * RGB_CHANNEL_COUNT + color]
+	static uint16_t fadeLevel[RGB_LED_COUNT * RGB_CHANNEL_COUNT];
+	// FadeTo change per frame of each fadeLevel, 8.8 fixed point
+	static int16_t fadeStep[RGB_LED_COUNT * RGB_CHANNEL_COUNT];
+
+	// Loop bodies being run: pc of the first opcode and iterations left
+	static uint8_t loopStart[PATTERN_LOOP_DEPTH];
+	static uint8_t loopCount[PATTERN_LOOP_DEPTH];
+	static uint8_t loopDepth;
+
+	// frame ticks per second the pattern asked for
+	static uint8_t framesPerSecond;
+
+	// @return uint8_t: the next pattern byte. Reads past the end return HaloOp::End.
+	static uint8_t fetch();
+	// Advance the running FadeTo and draw where it has got to.
+	// @param frames: frames to advance, up to fadeFrames
+	static void stepFade(uint8_t frames);
+	// Run opcodes until the next Wait or FadeTo.
+	// @return bool: false if the pattern ended.
+	static bool run();
+
+public:
+#ifdef HALO_HOST_RENDER
+	static HaloVMWork Work;
+#endif
+
+	// Start playing a pattern from the beginning.
+	// @param code: the pattern. Must stay valid while it plays, so usually a const FRAM table.
+	// @param codeLength: pattern length in bytes
+	static void Load(const uint8_t* code, uint8_t codeLength);
+
+	// Start playing a pattern slot from the beginning.
+	// @return bool: false if the slot does not exist or is empty.
+	static bool LoadSlot(uint8_t slot);
+
+	// Save a pattern into a FRAM slot. It survives power cycles.
+	// @param code: the pattern
+	// @param codeLength: pattern length in bytes, up to PATTERN_SLOT_SIZE - 1
+	// @return bool: false if the slot does not exist or the pattern does not fit.
+	static bool StorePattern(uint8_t slot, const uint8_t* code, uint8_t codeLength);
+
+	// Stop the pattern. The background layer keeps its last frame.
+	static void Stop();
+
+	// @return bool: true while a pattern is loaded and has not ended.
+	static bool Playing();
+
+	// @return uint8_t: frame ticks per second the pattern runs at. HALO_FPS_DEFAULT until it sets its own.
+	static uint8_t FrameRate();
+
+	// Run the pattern until the frame for the current time is ready in the background layer.
+	// HaloCompositor::Render() puts it on the halo.
+	// @param frames: frame ticks since the last call. When frames were missed the pattern skips ahead,
+	//                so Wait and FadeTo keep their length in time. 0 leaves the layer as it is.
+	// @return bool: true if the pattern has a next frame.
+	static bool RenderFrame(uint8_t frames);
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !HALO_VM_H
@@ -0,0 +1,140 @@
+/**
+* @brief      Adaptive hit detector for the light sensor
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Follows the ambient light with an exponential moving average, and the sensor noise with a running
+*               mean absolute deviation from it. A sample is a hit when it is more than k times the noise above
+*               the baseline.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "HitDetector.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+#define NOISE_MIN_FIXED ((int32_t)HIT_NOISE_MIN << HIT_FRACTION_BITS)
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+void HitDetector::updateThreshold()
+{
+    threshold = ((noise > NOISE_MIN_FIXED) ? noise : NOISE_MIN_FIXED) * k;
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+HitDetector::HitDetector(uint8_t thresholdK) : baseline(0), noise(0), threshold(0), k(thresholdK), hitRun(0)
+{
+    Reset(0);
+}
+
+void HitDetector::Reset(uint16_t level)
+{
+    baseline = (int32_t)level << HIT_FRACTION_BITS;
+    noise = NOISE_MIN_FIXED;
+    hitRun = 0;
+    updateThreshold();
+}
+
+bool HitDetector::Update(uint16_t sample)
+{
+    int32_t deviation = ((int32_t)sample << HIT_FRACTION_BITS) - baseline;
+    if (deviation > threshold)
+    {
+        if (++hitRun >= HIT_SETTLE_SAMPLES)
+        {
+            // too long for a laser shot: the room got brighter
+            Reset(sample);
+            return false;
+        }
+        return true;
+    }
+    hitRun = 0;
+
+    baseline += deviation >> HIT_BASELINE_SHIFT;
+
+    int32_t magnitude = (deviation < 0) ? -deviation : deviation;
+    int32_t change = (magnitude - noise) >> HIT_NOISE_SHIFT;
+    if (0 != change)
+    {
+        noise += change;
+        updateThreshold();
+    }
+    return false;
+}
+
+void HitDetector::Rebase(uint16_t level)
+{
+    baseline = (int32_t)level << HIT_FRACTION_BITS;
+    hitRun = 0;
+}
+
+bool HitDetector::Update(const uint16_t* samples, uint16_t count)
+{
+    bool hit = false;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        // every sample still goes through, so the averages see all of them
+        if (Update(samples[i]))
+        {
+            hit = true;
+        }
+    }
+    return hit;
+}
+
+uint16_t HitDetector::Baseline() const
+{
+    return (uint16_t)(baseline >> HIT_FRACTION_BITS);
+}
+
+uint16_t HitDetector::Noise() const
+{
+    return (uint16_t)(noise >> HIT_FRACTION_BITS);
+}
+
+uint16_t HitDetector::Threshold() const
+{
+    return (uint16_t)(threshold >> HIT_FRACTION_BITS);
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
@@ -0,0 +1,112 @@
+/**
+* @brief      Adaptive hit detector for the light sensor
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Follows the ambient light with an exponential moving average, and the sensor noise with a running
+*               mean absolute deviation from it. A sample is a hit when it is more than k times the noise above
+*               the baseline, so the threshold tightens in a steady room and opens up under flickering light.
+*
+*               Everything is fixed point with HIT_FRACTION_BITS fraction bits, and both averages are shifts
+*               instead of divisions: avg += (x - avg) >> shift. The MSP430 has no divider. The one multiply,
+*               k times the noise, runs whenever the noise average moves, which is nearly every quiet sample;
+*               it is a single MPY32 operation.
+*               main_real.cpp measures the cost per sample on the target, see DetectTicksPerSampleMax.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef HIT_DETECTOR_H
+#define HIT_DETECTOR_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// fraction bits of the fixed point baseline and noise
+#define HIT_FRACTION_BITS 8
+// baseline average over about 2^n samples
+#define HIT_BASELINE_SHIFT 4
+// noise average over about 2^n samples
+#define HIT_NOISE_SHIFT 5
+// default k: a hit is this many times the noise floor above the baseline
+#define HIT_THRESHOLD_K 6
+// smallest noise floor, in ADC counts, so a perfectly quiet sensor does not fire on 1 LSB
+#define HIT_NOISE_MIN 4
+// samples in a row above the threshold before the level is taken as the new ambient light, like a lamp going on
+#define HIT_SETTLE_SAMPLES 64
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+class HitDetector
+{
+	// ambient level and mean absolute deviation, fixed point
+	int32_t baseline;
+	int32_t noise;
+	// hit threshold above the baseline, fixed point: k * max(noise, HIT_NOISE_MIN)
+	int32_t threshold;
+	uint8_t k;
+	// samples in a row above the threshold
+	uint8_t hitRun;
+
+	// Work out threshold from noise
+	void updateThreshold();
+
+public:
+	// @param thresholdK: a hit is this many times the noise floor above the baseline
+	HitDetector(uint8_t thresholdK = HIT_THRESHOLD_K);
+
+	// Start over from an ambient level, with the noise at HIT_NOISE_MIN.
+	// @param level: ADC result of the ambient light
+	void Reset(uint16_t level);
+
+	// Take one sample.
+	// Only samples below the threshold move the baseline and the noise, so a hit does not raise its own bar.
+	// @param sample: ADC result
+	// @return bool: true if the sample is a hit
+	bool Update(uint16_t sample);
+
+	// Move the baseline to an ambient level seen between captures, like the ADC window re-centring.
+	// The noise floor stays, it only comes from samples in a row.
+	// @param level: ADC result of the ambient light
+	void Rebase(uint16_t level);
+
+	// Take a batch of samples, oldest first.
+	// @return bool: true if any of them is a hit
+	bool Update(const uint16_t* samples, uint16_t count);
+
+	// @return uint16_t: ambient level, in ADC counts
+	uint16_t Baseline() const;
+
+	// @return uint16_t: noise floor (mean absolute deviation), in ADC counts
+	uint16_t Noise() const;
+
+	// @return uint16_t: how far above the baseline a hit is, in ADC counts
+	uint16_t Threshold() const;
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !HIT_DETECTOR_H
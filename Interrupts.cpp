@@ -13,6 +13,8 @@
 #include "LaserTarget.h"
 #include "Interrupts.h"
 #include "LightSensor.h"
+#include "TimeBase.h"
+#include "HaloFlush.h"
 
 /************************************************************************/
 /*                            Using section                             */
@@ -38,6 +40,11 @@
 /*                        Variables declarations                        */
 /************************************************************************/
 volatile uint32_t Interrupts::FrameInterruptCount = 0;
+volatile uint32_t Interrupts::FrameTicks = 0;
+volatile uint16_t Interrupts::FrameStep = 0xFFFF;
+volatile uint8_t Interrupts::FrameSteps = 1;
+volatile uint8_t Interrupts::FrameStepsLeft = 1;
+volatile bool Interrupts::FrameBoost = false;
 volatile bool Interrupts::LED_State = 0;
 volatile int Interrupts::calibratedADC = 0;
 
@@ -54,12 +61,22 @@ volatile int Interrupts::calibratedADC = 0;
 /*                      Implementation (PUBLIC)                         */
 /************************************************************************/
 
+uint32_t Interrupts::GetFrameTicks()
+{
+    uint16_t state = __get_interrupt_state();
+    __disable_interrupt();
+    uint32_t ticks = FrameTicks;
+    __set_interrupt_state(state);
+    return ticks;
+}
+
 /************************************************************************/
 /*                      Implementation (INTERRUPTS)                     */
 /************************************************************************/
 
 // Timer 0 Interrupt Vector handler
-// used for 
+// Used for the Pattern Frame Rate, programmed by HaloFrameRate
+// When the last step of a frame "ticks", the next frame of the light pattern will be drawn
 // INTERRUPT FLAG: TB0CCR0 CCIFG0
 #if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
 #pragma vector=TIMER0_B0_VECTOR
@@ -70,12 +87,23 @@ void __attribute__((interrupt(TIMER0_B0_VECTOR))) TIMER0_B0_ISR(void)
 #error Compiler not supported!
 #endif
 {
-
+    // the timer runs on in continuous mode, the next compare is one step on from this one
+    TB0CCR0 += Interrupts::FrameStep;
+    if (0 == --Interrupts::FrameStepsLeft)
+    {
+        Interrupts::FrameStepsLeft = Interrupts::FrameSteps;
+        Interrupts::LED_State = true;
+        Interrupts::FrameTicks++;
+    }
+    else if (Interrupts::FrameBoost)
+    {
+        // redraw without moving the animation on
+        Interrupts::LED_State = true;
+    }
 }
 
 // Timer0 Interrupt Vector (TB0IV) handler
-// Used for the Pattern Frame Rate
-// When this "ticks", the next frame of the light pattern will be drawn
+// CCR2 sends the halo frame in flight a part at a time. The overflow counts time for the idle status report
 // INTERRUPT FLAG: TB0CCR1 CCIFG1, TB0CCR2 CCIFG2, TB0IFG(TB0IV)
 #if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
 #pragma vector=TIMER0_B1_VECTOR
@@ -99,8 +127,7 @@ void __attribute__((interrupt(TIMER0_B1_VECTOR))) TIMER0_B1_ISR(void)
         // CCR2
         // DEBUG_3 ^= DEBUG_3_B;
         // DEBUG_3 ^= DEBUG_3_B;
-
-
+        HaloFlush::Tick();
         break;
     case  6: break;                          // reserved
     case  8: break;                          // reserved
@@ -109,8 +136,8 @@ void __attribute__((interrupt(TIMER0_B1_VECTOR))) TIMER0_B1_ISR(void)
     case 14:
         //DEBUG_OUT ^= DEBUG_7;
         //DEBUG_OUT ^= DEBUG_7;
-        Interrupts::LED_State = true;                  // overflow
-        Interrupts::FrameInterruptCount++;
+        Interrupts::FrameInterruptCount++;             // overflow
+        TimeBase::Overflow();
         break;
     default: break;
     }
@@ -291,13 +318,17 @@ void __attribute__((interrupt(ADC_VECTOR))) ADC_ISR(void)
     case ADCIV_ADCTOVIFG:
         break;
     case ADCIV_ADCHIIFG:
+        // brighter than the ambient window
+        LightSensor::SampleAboveWindow();
         break;
     case ADCIV_ADCLOIFG:
+        // darker than the ambient window
+        LightSensor::SampleBelowWindow();
         break;
     case ADCIV_ADCINIFG:
         break;
     case ADCIV_ADCIFG:
-        LightSensor::ADC_value = ADCMEM0;
+        LightSensor::SampleReady();
         // Sleep Timer Exits LPM3
         //__bic_SR_register_on_exit(LPM3_bits);
         
@@ -37,12 +37,26 @@ class Interrupts
 {
 public:
 
-	// Frame Rate Interrupt counter
+	// Frame timer overflow counter, about every 65.5ms
 	volatile static uint32_t FrameInterruptCount;
+	// frame ticks since boot, at the rate set with HaloFrameRate. Never reset, so animations can take their time from it
+	volatile static uint32_t FrameTicks;
+	// TB0CCR0 steps that make up one frame tick, and their length in FRAME_TIMER ticks. Set by HaloFrameRate.
+	volatile static uint16_t FrameStep;
+	volatile static uint8_t FrameSteps;
+	// steps left of the frame tick in progress
+	volatile static uint8_t FrameStepsLeft;
+	// wake the main loop at every step, not just at frame ticks
+	volatile static bool FrameBoost;
 	// do we need to transition to the next led animation frame
 	volatile static bool LED_State;
 	// default ADC value
 	volatile static int calibratedADC;
+
+	// Read FrameTicks in one piece. It takes two reads on the MSP430, which the TB0CCR0 interrupt (TIMER0_B0_ISR)
+	// that counts it could split.
+	// @return uint32_t: frame ticks since boot
+	static uint32_t GetFrameTicks();
 };
 
 /************************************************************************/
@@ -41,9 +41,11 @@
 //    FRAME TIMER
 //-------------------------
 #define FRAME_TIMER         TB0CTL
-// SMCLK/2, continuous mode, clear TBR
+// SMCLK/2, continuous mode, clear TBR. The overflow paces the idle report, frame ticks come from CCR0 (HaloFrameRate).
 #define FRAME_TIMER_ON      TBSSEL__SMCLK+ID_1+MC_2+TBCLR+TBIE 
 #define FRAME_TIMER_OFF     TBSSEL__SMCLK+ID_1+MC_2+TBCLR
+// FRAME_TIMER count. 1us per tick at SMCLK = 2MHz
+#define FRAME_TIMER_COUNT   TB0R
 // 30KHz is a reasonable minimum to keep switching out of the audible frequency
 #define PWM_30_KHZ          40                                      
 /* a value of 40 here produces a 3KHz pwm frequeny,
@@ -64,6 +66,52 @@ which is about as much as my test circuit will suffer due to slow switching tran
 #define HALO_OUTPUT_EN   BIT1            //P6.0?
 #define HALO_LATCH_LED   BIT7            //P3.7
 
+// Shift the halo GS data out through eUSCI_B1 in SPI master mode instead of bit-banging P3.
+// SIN moves to UCB1SIMO and SCLK to UCB1CLK. LAT stays on HALO_LATCH_LED as a plain GPIO.
+// HARDWARE CHANGE: TLC5957 SIN has to be wired to P4.6 and SCLK to P4.5 instead of P3.5 and P3.6.
+// A board wired for the bit-banged transport shows nothing with this on, so it is off by default.
+// tools/halorender built with -DHALO_SPI_TRANSPORT checks the SPI waveform against the bit-banged one (-t).
+//#define HALO_SPI_TRANSPORT
+#define HALO_SPI_OUT     P4OUT
+#define HALO_SPI_SEL0    P4SEL0
+#define HALO_SPI_SEL1    P4SEL1
+#define HALO_SPI_CLK     BIT5            //P4.5 UCB1CLK
+#define HALO_SPI_SIMO    BIT6            //P4.6 UCB1SIMO
+
+// Send halo frames in the background, so Loop() does not wait on LED I/O (HaloFlush).
+// The bit-banged transports send a few words from each TB0 CCR2 interrupt. With HALO_SPI_TRANSPORT the eUSCI_B1
+// TX interrupt feeds the bytes and CCR2 clocks the latched tails. Comment out to send every frame in the foreground.
+#define HALO_ASYNC_FLUSH
+
+// TLC5957 SOUT, sampled as a GPIO to read back the FC register and the LED open detection result.
+// P4.7 is also UCB1SOMI, so the eUSCI could take over the read back later.
+#define HALO_SOUT_IN     P4IN
+#define HALO_SOUT_DIR    P4DIR
+#define HALO_SOUT        BIT7            //P4.7
+
+// Shift GS data on both SCLK edges (TLC5957 SEL_SCK_EDGE) when bit-banging the P3 pins.
+// Halves the SCLK toggles per frame: 2 port writes per bit instead of 3.
+// FC data is still sent on the rising edge only.
+// Not available with HALO_SPI_TRANSPORT, the eUSCI always clocks one bit per SCLK period.
+//#define HALO_DOUBLE_EDGE_SCLK
+#if defined(HALO_SPI_TRANSPORT) && defined(HALO_DOUBLE_EDGE_SCLK)
+#error HALO_DOUBLE_EDGE_SCLK requires the bit-banged halo transport
+#endif
+
+// PWM depth used for poker trans mode, 9 to 16 bits.
+// Only the top HALO_POKER_PWM_BITS of each GS word are sent, so 9 bits cuts a frame from 768 to 432 bits.
+// 0 selects the conventional 16-bit GS transfer.
+// Changes the GS format of every pattern, so it stays off until it has been checked on the halo hardware.
+//#define HALO_POKER_PWM_BITS 9
+#ifndef HALO_POKER_PWM_BITS
+#define HALO_POKER_PWM_BITS 0
+#endif
+
+// Number of daisy-chained TLC5957 drivers on the halo (SOUT of each chip into SIN of the next).
+#define HALO_CHIP_COUNT 1
+// RGB LEDs wired to each TLC5957, on OUT0 upwards. Up to 16.
+#define HALO_LEDS_PER_CHIP 16
+
 #define BEZEL_OUT       P2OUT
 #define BEZEL_RED       BIT1            //P2.1
 #define BEZEL_GREEN     BIT2            //P2.2
@@ -188,7 +236,8 @@ which is about as much as my test circuit will suffer due to slow switching tran
 /************************************************************************/
 /*                     Data structures declarations                     */
 /************************************************************************/
-enum LEDCommands { STORE_PATTERN = 1, PLAY_PATTERN, PLAY_IDLE, RETRIEVE_EEPROM };
+enum LEDCommands { STORE_PATTERN = 1, PLAY_PATTERN, PLAY_IDLE, RETRIEVE_EEPROM, STREAM_FRAME, PLAY_EFFECT, STORE_PACK,
+	PLAY_PACK };
 
 /************************************************************************/
 /*                         Classes declarations                         */
@@ -202,8 +251,10 @@ void Setup(void);
 void Loop(void);
 
 void RenderHaloFrame(void);
+void reportHaloStatus(void);
+void processCommands(void);
+void restartAnimation(void);
 void debounce(void);
-void doIdle(void);
 uint8_t readkeys(void);
 
 void DigitalBezel(void);
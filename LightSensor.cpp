@@ -41,11 +41,36 @@
 /*                        Variables declarations                        */
 /************************************************************************/
 volatile unsigned int LightSensor::ADC_value;
+volatile uint16_t LightSensor::Baseline = 0;
+SampleRing<uint16_t, LIGHT_RING_SIZE> LightSensor::Samples;
+HitDetector LightSensor::Detector;
+ShooterDecoder LightSensor::Decoder;
+volatile uint16_t LightSensor::windowAbove = LIGHT_WINDOW_ABOVE;
+bool LightSensor::detectorPrimed = false;
+volatile uint32_t LightSensor::captureTime = 0;
+volatile uint16_t LightSensor::captureIndex = 0;
+uint16_t LightSensor::frameIndex = 0;
+volatile uint8_t LightSensor::captureLeft = 0;
+volatile bool LightSensor::captureHeld = false;
+volatile uint8_t LightSensor::StampLatencyMax = 0;
+volatile bool LightSensor::baselineRequested = false;
 
 /************************************************************************/
 /*                      Implementation (PRIVATE)                        */
 /************************************************************************/
 
+uint32_t LightSensor::sampleTime(uint16_t index)
+{
+    // No new capture starts while a frame is being received, so the capture stays put while it is read
+    uint16_t after = (uint16_t)(index - captureIndex);
+    if (after >= 0x8000)
+    {
+        // the frame started before this capture did
+        after = 0;
+    }
+    return captureTime + (((uint32_t)after * LIGHT_SAMPLE_PERIOD * LIGHT_ACLK_US_X512) >> 9);
+}
+
 /************************************************************************/
 /*                      Implementation (PROTECTED)                      */
 /************************************************************************/
@@ -86,23 +111,22 @@ void LightSensor::InitADC()
     // Generate sample/hold signal to trigger ADC conversion
 
     // Timer_B clock source select
-    TB1CCTL0 |= CCIE;
     TB1CTL = TBSSEL__ACLK;
     // Mode control. = Up mode: Timer counts up to TBxCL0
     TB1CTL |= MC_1;
     // Timer_B clear. Setting this bit clears TBxR, the clock divider logic (the divider setting remains unchanged), and the count direction.
     TB1CTL |= TBCLR;
     // TBxCCRn holds the data for the comparison to the timer value in the Timer_B Register, TBxR
-    TB1CCR0 = 650;
-    TB1CCR1 = 325;
-    // Output mode: Toggle/reset
-    TB1CCTL0 |= OUTMOD_2;
+    TB1CCR0 = LIGHT_SAMPLE_PERIOD - 1;
+    TB1CCR1 = LIGHT_SAMPLE_PERIOD / 2;
+    // Output mode: Reset/set, TB1.1 rises once a period and starts the conversion
+    TB1CCTL1 = OUTMOD_7;
 
     // Input divider expansion.
     // Divide by 0;
     TB1EX0 = TBIDEX_0;
 
-    TB1CTL |= TBIE;
+    // No timer interrupts: the ADC only needs TB1.1, and at this rate they would cost more than the detector.
 
 
 #ifdef ADCPCTL4
@@ -112,7 +136,8 @@ void LightSensor::InitADC()
 #endif
 
     // Set Sample-Hold time to 16 ADCCLK cycles
-    ADCCTL0 = ADCON | ADCSHT_2 | ADCMSC_1;
+    // ADCMSC_0: one conversion per TB1.1 rising edge. ADCMSC_1 would free-run after the first trigger.
+    ADCCTL0 = ADCON | ADCSHT_2 | ADCMSC_0;
 
         // USE MODOSC 5MHZ Digital Oscillator as clock source
     // Set the Sample-and-Hold Source
@@ -155,3 +180,172 @@ void LightSensor::StartADCConv()
     ADCCTL1 |= ADCCONSEQ_2;
     ADCCTL0 |= ADCENC | ADCSC;
 }
+
+void LightSensor::StartWindow()
+{
+    // No in-window interrupt, and no overflow interrupts either:
+    // quiet samples are never read, so ADCMEM0 overflows on purpose.
+    ADCIE = 0x00;
+    ADCIFG = 0x00;
+    Samples.Flush();
+    // the baseline sample comes through the ring first and starts the detector
+    detectorPrimed = false;
+    captureHeld = false;
+    RequestBaseline();
+    // InitADC() leaves conversions off. From here TB1.1 starts one every LIGHT_SAMPLE_PERIOD.
+    ADCCTL0 |= ADCENC;
+}
+
+void LightSensor::RequestBaseline()
+{
+    uint16_t state = __get_interrupt_state();
+    __disable_interrupt();
+    baselineRequested = true;
+    // ADCIFG0 is still set from the last unread sample, which may be old
+    ADCIFG &= ~ADCIFG0;
+    ADCIE |= ADCIE0;
+    __set_interrupt_state(state);
+}
+
+bool LightSensor::DetectHit(const uint16_t* samples, uint16_t count, HitEvent& event)
+{
+    if (0 == count)
+    {
+        return false;
+    }
+    if (!detectorPrimed)
+    {
+        Detector.Reset(samples[0] & LIGHT_ADC_MAX);
+        Decoder.Reset();
+        detectorPrimed = true;
+    }
+
+    // ring index of samples[0]
+    uint16_t index = (uint16_t)(Samples.Tail() - count);
+    bool shot = false;
+    bool lit = false;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (0 != (samples[i] & LIGHT_SAMPLE_AMBIENT))
+        {
+            // Not part of a capture, so not for the decoder: the light between captures, which the detector
+            // would otherwise only catch up with once the next capture is under way
+            Detector.Rebase(samples[i] & LIGHT_ADC_MAX);
+            lit = false;
+            continue;
+        }
+
+        bool receiving = Decoder.Receiving();
+        // every sample still goes through both, so the averages and the bit timing see all of them
+        lit = Detector.Update(samples[i]);
+        if (Decoder.Update(lit, event))
+        {
+            event.Time = sampleTime(frameIndex);
+            shot = true;
+        }
+        else if (!receiving && Decoder.Receiving())
+        {
+            frameIndex = index + i;
+        }
+    }
+    // picked up by the next SetWindow(), so the comparator wakes up for what the detector would call a hit
+    windowAbove = Detector.Threshold();
+    // a laser still on the sensor, or a frame coming in, keeps the capture going past LIGHT_CAPTURE_SAMPLES
+    captureHeld = lit || Decoder.Receiving();
+    return shot;
+}
+
+uint16_t LightSensor::TimeErrorUs()
+{
+    // up to a sample period before the trigger, and StampLatencyMax whole ACLK cycles plus part of one after it
+    uint32_t cycles = (uint32_t)LIGHT_SAMPLE_PERIOD + StampLatencyMax + 1;
+    // rounded up, and 1us for the resolution of the stamp
+    return (uint16_t)(((cycles * LIGHT_ACLK_US_X512 + 511) >> 9) + 1);
+}
+
+void LightSensor::SetWindow(uint16_t baseline)
+{
+    Baseline = baseline;
+    uint16_t above = windowAbove;
+    uint16_t high = (baseline > LIGHT_ADC_MAX - above) ? LIGHT_ADC_MAX : baseline + above;
+    uint16_t low = (baseline < LIGHT_WINDOW_BELOW) ? 0 : baseline - LIGHT_WINDOW_BELOW;
+
+    // The thresholds are only written with ADCENC clear. Conversions are started by TB1.1,
+    // so setting ADCENC again is all it takes to carry on.
+    ADCCTL0 &= ~ADCENC;
+    ADCHI = high;
+    ADCLO = low;
+    ADCIFG &= ~(ADCHIIFG | ADCLOIFG);
+    ADCCTL0 |= ADCENC;
+}
+
+void LightSensor::SampleReady()
+{
+    ADC_value = ADCMEM0;
+    if (baselineRequested)
+    {
+        baselineRequested = false;
+        // the new ambient level, for the detector too. A full ring drops the sample and counts it.
+        Samples.Push(ADC_value | LIGHT_SAMPLE_AMBIENT);
+        SetWindow(ADC_value);
+        // capture over: back to interrupts from the window only, with hits armed
+        ADCIE = ADCHIIE | ADCLOIE;
+        return;
+    }
+    Samples.Push(ADC_value);
+
+    // The comparator still flags every sample. One above the window starts the count again, so light the main loop
+    // has not got to yet keeps the capture going too.
+    bool above = 0 != (ADCIFG & ADCHIIFG);
+    ADCIFG &= ~(ADCHIIFG | ADCLOIFG);
+    if (above)
+    {
+        captureLeft = LIGHT_CAPTURE_SAMPLES;
+    }
+    else if (0 != captureLeft)
+    {
+        captureLeft--;
+    }
+    if ((0 == captureLeft) && !captureHeld)
+    {
+        // nothing the detection stage calls a hit, so a noise excursion: back to the window where it was
+        ADCIE = ADCHIIE | ADCLOIE;
+    }
+}
+
+void LightSensor::SampleAboveWindow()
+{
+    // stamp first, everything after this adds to the error
+    uint32_t stamp = TimeBase::NowFromISR();
+
+    // TB1 runs from ACLK, so read it until two reads agree.
+    // TB1.1 triggers the conversion when TB1R reaches LIGHT_SAMPLE_PERIOD - 1.
+    uint16_t count;
+    do
+    {
+        count = TB1R;
+    } while (count != TB1R);
+    uint8_t latency = (uint8_t)((LIGHT_SAMPLE_PERIOD - 1 == count) ? 0 : count + 1);
+    if (latency > StampLatencyMax)
+    {
+        StampLatencyMax = latency;
+    }
+
+    ADC_value = ADCMEM0;
+    captureTime = stamp;
+    captureIndex = Samples.Head();
+    Samples.Push(ADC_value);
+    // Capture every sample for the detection stage to look at, until the next baseline or, if the detection stage
+    // does not hold it, for LIGHT_CAPTURE_SAMPLES. The window stays out of it meanwhile, so a long pulse is one capture.
+    captureLeft = LIGHT_CAPTURE_SAMPLES;
+    ADCIFG &= ~(ADCIFG0 | ADCHIIFG | ADCLOIFG);
+    ADCIE = ADCIE0;
+}
+
+void LightSensor::SampleBelowWindow()
+{
+    // the ambient light dropped, follow it down at once
+    ADC_value = ADCMEM0;
+    Samples.Push(ADC_value | LIGHT_SAMPLE_AMBIENT);
+    SetWindow(ADC_value);
+}
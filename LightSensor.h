@@ -6,6 +6,31 @@
 * @details    Uses ADC along with a phototransistor and voltage divider circuit to implement a light sensor circuit.
 *               The voltage across the divider is measured by the internal ADC, and ultimately performs "hit" detection.
 *
+*               Hit detection runs on the ADC window comparator. ADCHI and ADCLO sit around the ambient baseline,
+*               and the ADC only interrupts when a sample leaves the window: above it may be a hit, below it means
+*               the room got darker and the window follows. Samples inside the window cost no CPU at all.
+*               A sample above the window starts a capture: from then on every sample goes into the Samples ring,
+*               which the main loop drains in batches through DetectHit(). RequestBaseline() ends the capture and
+*               re-centres the window on the next sample, which also follows slow ambient drift.
+*               The detector only sees the captures, so its baseline would go stale in between. The samples the
+*               window takes as ambient, the re-centre sample and one below the window, go into the ring as well,
+*               marked with LIGHT_SAMPLE_AMBIENT, and DetectHit() moves the detector baseline to them.
+*               A capture also ends by itself LIGHT_CAPTURE_SAMPLES after the last sample above the window, unless the
+*               detection stage holds it for a hit or a frame coming in. So a noise excursion over the window costs
+*               about 27ms of full rate interrupts rather than the time to the next re-centre. The window goes back
+*               to where it was.
+*
+*               TB1 triggers a conversion every LIGHT_SAMPLE_PERIOD ACLK cycles, fast enough for Decoder to read
+*               the shooter ID Manchester code of a shot at SHOOTER_HALF_BIT_SAMPLES samples per half bit.
+*               Outside a capture that rate costs no CPU, the comparator looks at every sample by itself.
+*
+*               Shots are timed on TimeBase. SampleAboveWindow() stamps the sample that starts a capture, and a
+*               shot later in the capture is dated from that stamp by its place in the ring, one LIGHT_SAMPLE_PERIOD
+*               a sample. A shot time is never early; TimeErrorUs() is how late it can be: the laser came on at
+*               most one sample period before the conversion that saw it, plus the measured time from the
+*               conversion trigger to the stamp. Samples dropped from a full ring make later shots in the same
+*               capture early by a sample period each, see Samples.Overruns.
+*
 * @link       Datasheets:
 *             KDT00030 Phototransistor: https://www.mouser.com/datasheet/2/308/1/KDT00030_D-2314605.pdf
 *
@@ -21,10 +46,37 @@
 #include <msp430.h>
 #include <stdint.h>
 
+#include "SampleRing.h"
+#include "HitDetector.h"
+#include "ShooterDecoder.h"
+#include "TimeBase.h"
+
 /************************************************************************/
 /*                         #define declarations                         */
 /************************************************************************/
 
+// largest 12-bit ADC result
+#define LIGHT_ADC_MAX 4095
+// set on a ring sample the window took as ambient light, between captures. The ADC result is in the low 12 bits.
+#define LIGHT_SAMPLE_AMBIENT 0x8000
+// ADC counts the window reaches above and below the baseline.
+// Above follows the hit threshold of the detector, this is where it starts: HIT_THRESHOLD_K * HIT_NOISE_MIN.
+#define LIGHT_WINDOW_ABOVE 24
+#define LIGHT_WINDOW_BELOW 24
+// frame timer overflows (about 65.5ms each) between window re-centres
+#define LIGHT_RECENTRE_FRAMES 16
+// ACLK cycles between conversions. ACLK is REFO, 32768Hz, set up by main(): 4096 samples per second, a 512 bit/s shot code
+#define LIGHT_SAMPLE_PERIOD 8
+// one ACLK cycle is this many 1/512 us
+#define LIGHT_ACLK_US_X512 15625UL
+// samples the ring holds between main loop passes, about 15.6ms at 4096 samples per second. A power of two.
+#define LIGHT_RING_SIZE 64
+// samples the main loop takes from the ring at a time
+#define LIGHT_BATCH_SIZE 8
+// samples after the last one above the window before a capture ends, unless the detection stage holds it: the
+// longest shooter frame, and the LIGHT_RING_SIZE samples the main loop can be behind the ISR. About 27ms.
+#define LIGHT_CAPTURE_SAMPLES (SHOOTER_FRAME_BITS * 2 * SHOOTER_HALF_BIT_SAMPLES + LIGHT_RING_SIZE)
+
 /************************************************************************/
 /*                         Forward declarations                         */
 /************************************************************************/
@@ -39,9 +91,39 @@
 
 class LightSensor
 {
+	// the next conversion becomes the baseline
+	volatile static bool baselineRequested;
+	// ADC counts the window reaches above the baseline
+	volatile static uint16_t windowAbove;
+	// true once the detector has been started from an ambient sample
+	static bool detectorPrimed;
+	// TimeBase time and ring index of the sample that started the capture. Written by the ISR only.
+	volatile static uint32_t captureTime;
+	volatile static uint16_t captureIndex;
+	// ring index of the first sample of the frame Decoder is receiving
+	static uint16_t frameIndex;
+	// samples left before the capture may end, counted from the last one above the window. Written by the ISR only.
+	volatile static uint8_t captureLeft;
+	// the detection stage saw a hit or is receiving a frame at the end of its last batch, so the capture goes on
+	volatile static bool captureHeld;
+
+	// @return uint32_t: TimeBase time of the sample at a ring index of the current capture
+	static uint32_t sampleTime(uint16_t index);
+
 public:
 
 	volatile static unsigned int ADC_value;
+	// ambient level the window is centred on
+	volatile static uint16_t Baseline;
+	// samples read by ADC_ISR, oldest first. Filled by the ISR only, drained by the main loop only.
+	// Ambient samples between captures carry LIGHT_SAMPLE_AMBIENT.
+	static SampleRing<uint16_t, LIGHT_RING_SIZE> Samples;
+	// the detection stage, run by the main loop
+	static HitDetector Detector;
+	// reads the shooter ID from the samples the detector calls a hit
+	static ShooterDecoder Decoder;
+	// most ACLK cycles seen from a conversion trigger to its capture stamp
+	volatile static uint8_t StampLatencyMax;
 
 	// Initialize the uC's GPIO to use the voltage sensor pin as input.
 	static void InitGPIO();
@@ -51,6 +133,41 @@ public:
 
 	static void StartADCConv();
 
+	// Switch the ADC interrupts from every conversion to the window comparator, centred on the next sample,
+	// and enable conversions. Call after InitADC().
+	static void StartWindow();
+
+	// Centre the window on the next sample, end the capture and re-arm hit detection.
+	// Call when the sensor sees only ambient light, not while a hit may still be lit.
+	static void RequestBaseline();
+
+	// The detection stage: run a batch of samples from the ring through Detector, and its hits through Decoder.
+	// The window above the baseline follows the detector's threshold. An ambient sample only moves the
+	// detector's baseline.
+	// A shot is reported once its whole code is in, SHOOTER_FRAME_BITS bits after the first bright sample,
+	// and carries the time of that sample.
+	// @param samples: the batch just taken with Samples.Pop(), oldest first. The ring indexes date them.
+	// @param count: samples in the batch
+	// @param event: receives the shot
+	// @return bool: true if a shot completed in this batch
+	static bool DetectHit(const uint16_t* samples, uint16_t count, HitEvent& event);
+
+	// @return uint16_t: how late a shot time can be, in us
+	static uint16_t TimeErrorUs();
+
+	// Program ADCHI and ADCLO around an ambient level
+	// @param baseline: ADC result to centre the window on
+	static void SetWindow(uint16_t baseline);
+
+	// ADC_ISR handlers
+	// ADCIFG0: a conversion finished. Only enabled during a capture or while a baseline is wanted.
+	// Ends a capture LIGHT_CAPTURE_SAMPLES after its last sample above the window, if the detection stage does not hold it.
+	static void SampleReady();
+	// ADCHIIFG: a sample above the window, starts a capture and stamps it
+	static void SampleAboveWindow();
+	// ADCLOIFG: a sample below the window, queued as ambient
+	static void SampleBelowWindow();
+
 };
 
 /************************************************************************/
@@ -0,0 +1,161 @@
+/**
+* @brief      Lock-free sample ring between one interrupt and the main loop
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    A single producer, single consumer ring buffer. The producer (an ISR) only writes the head,
+*               the consumer (the main loop) only writes the tail, so neither side ever has to disable interrupts.
+*               The indexes run freely and wrap at 65536; Size is a power of two, so the slot is index & (Size - 1)
+*               and head - tail is the fill level even across the wrap.
+*               When the ring is full the new sample is dropped and counted, the samples already queued stay in order.
+*
+*               On the MSP430 volatile is all the ordering it needs: one core, and the compiler keeps volatile
+*               accesses in program order. A host that runs the two sides on threads defines SAMPLE_RING_RELEASE()
+*               and SAMPLE_RING_ACQUIRE() as fences before including this, see tools/ringstress.cpp.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+#ifndef SAMPLE_RING_RELEASE
+// before an index store that hands slots to the other side
+#define SAMPLE_RING_RELEASE()
+#endif
+#ifndef SAMPLE_RING_ACQUIRE
+// after an index load, before the slots it hands over are touched
+#define SAMPLE_RING_ACQUIRE()
+#endif
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+template <typename T, uint16_t Size>
+class SampleRing
+{
+	static_assert((Size > 1) && (0 == (Size & (Size - 1))), "the ring size has to be a power of two");
+	static_assert(Size <= 0x8000, "the free running indexes need twice the ring size");
+
+	static constexpr uint16_t mask = Size - 1;
+
+	// volatile, so the sample is stored before the head that publishes it
+	volatile T samples[Size];
+	// next slot to write. Written by the producer only.
+	volatile uint16_t head;
+	// next slot to read. Written by the consumer only.
+	volatile uint16_t tail;
+	// Overruns already reported by NewOverruns(). Consumer only.
+	uint16_t overrunsSeen;
+
+public:
+	// samples dropped because the ring was full, since boot. Written by the producer only.
+	volatile uint16_t Overruns;
+
+	SampleRing() : head(0), tail(0), overrunsSeen(0), Overruns(0)
+	{
+	}
+
+	// Producer: queue a sample.
+	// @return bool: false if the ring was full and the sample was dropped
+	bool Push(T sample)
+	{
+		uint16_t next = head;
+		uint16_t used = (uint16_t)(next - tail);
+		SAMPLE_RING_ACQUIRE();
+		if (used >= Size)
+		{
+			Overruns++;
+			return false;
+		}
+		samples[next & mask] = sample;
+		SAMPLE_RING_RELEASE();
+		head = next + 1;
+		return true;
+	}
+
+	// Consumer: take up to max samples, oldest first.
+	// @param out: receives the samples
+	// @param max: room in out
+	// @return uint16_t: samples taken
+	uint16_t Pop(T* out, uint16_t max)
+	{
+		uint16_t first = tail;
+		uint16_t count = (uint16_t)(head - first);
+		SAMPLE_RING_ACQUIRE();
+		if (count > max)
+		{
+			count = max;
+		}
+		for (uint16_t i = 0; i < count; i++)
+		{
+			out[i] = samples[(uint16_t)(first + i) & mask];
+		}
+		// hand the slots back only once they have been copied
+		SAMPLE_RING_RELEASE();
+		tail = first + count;
+		return count;
+	}
+
+	// Consumer: @return uint16_t: samples waiting
+	uint16_t Count() const
+	{
+		return (uint16_t)(head - tail);
+	}
+
+	// Producer: @return uint16_t: free running index the next Push() stores its sample at
+	uint16_t Head() const
+	{
+		return head;
+	}
+
+	// Consumer: @return uint16_t: free running index of the next sample Pop() takes
+	uint16_t Tail() const
+	{
+		return tail;
+	}
+
+	// Consumer: throw away every sample waiting
+	void Flush()
+	{
+		tail = head;
+	}
+
+	// Consumer: @return uint16_t: samples dropped since the last call
+	uint16_t NewOverruns()
+	{
+		uint16_t overruns = Overruns;
+		uint16_t dropped = (uint16_t)(overruns - overrunsSeen);
+		overrunsSeen = overruns;
+		return dropped;
+	}
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !SAMPLE_RING_H
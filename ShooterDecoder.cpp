@@ -0,0 +1,183 @@
+/**
+* @brief      Shooter ID decoder for coded laser shots
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Every laser shot carries a short Manchester code: a start bit, the shooter ID and an even parity bit.
+*               The decoder takes one on/off decision per ADC sample and reports the shooter with a confidence.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "ShooterDecoder.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+#define SAMPLES_PER_BIT (2 * SHOOTER_HALF_BIT_SAMPLES)
+#define ID_MASK ((1 << SHOOTER_ID_BITS) - 1)
+
+static_assert(SHOOTER_FRAME_BITS <= 8, "the frame bits are kept in a byte");
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+void ShooterDecoder::finish(HitEvent& event)
+{
+    uint8_t start = bits >> (SHOOTER_FRAME_BITS - 1);
+    uint8_t id = (bits >> 1) & ID_MASK;
+    uint8_t parity = bits & 1;
+
+    // even parity over the ID and the parity bit
+    uint8_t ones = parity;
+    for (uint8_t value = id; 0 != value; value >>= 1)
+    {
+        ones ^= value & 1;
+    }
+
+    if ((1 == start) && (0 == ones) && (0 != minMargin))
+    {
+        event.Shooter = id;
+        // margin 1 - SHOOTER_HALF_BIT_SAMPLES scaled to 0 - 255
+        uint16_t confidence = ((uint16_t)minMargin << (8 - SHOOTER_HALF_BIT_SHIFT)) - 1;
+        event.Confidence = (uint8_t)confidence;
+    }
+    else
+    {
+        event.Shooter = SHOOTER_UNKNOWN;
+        event.Confidence = 0;
+    }
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+ShooterDecoder::ShooterDecoder()
+{
+    Reset();
+}
+
+void ShooterDecoder::Reset()
+{
+    receiving = false;
+    sample = 0;
+    firstLit = 0;
+    secondLit = 0;
+    bitCount = 0;
+    bits = 0;
+    minMargin = SHOOTER_HALF_BIT_SAMPLES;
+    gap = 0;
+}
+
+bool ShooterDecoder::Update(bool lit, HitEvent& event)
+{
+    if (!receiving)
+    {
+        if (!lit)
+        {
+            if (0 != gap)
+            {
+                gap--;
+            }
+            return false;
+        }
+        if (0 != gap)
+        {
+            // still lit from the last frame, or a steady light: wait for it to go dark first
+            gap = SHOOTER_GAP_SAMPLES;
+            return false;
+        }
+        receiving = true;
+        sample = 0;
+        firstLit = 0;
+        secondLit = 0;
+        bitCount = 0;
+        bits = 0;
+        minMargin = SHOOTER_HALF_BIT_SAMPLES;
+    }
+
+    if (lit)
+    {
+        if (sample < SHOOTER_HALF_BIT_SAMPLES)
+        {
+            firstLit++;
+        }
+        else
+        {
+            secondLit++;
+        }
+    }
+    if (++sample < SAMPLES_PER_BIT)
+    {
+        return false;
+    }
+
+    uint8_t margin;
+    bits <<= 1;
+    if (firstLit > secondLit)
+    {
+        bits |= 1;
+        margin = firstLit - secondLit;
+    }
+    else
+    {
+        margin = secondLit - firstLit;
+    }
+    if (margin < minMargin)
+    {
+        minMargin = margin;
+    }
+    sample = 0;
+    firstLit = 0;
+    secondLit = 0;
+
+    if (++bitCount < SHOOTER_FRAME_BITS)
+    {
+        return false;
+    }
+    receiving = false;
+    gap = SHOOTER_GAP_SAMPLES;
+    finish(event);
+    return true;
+}
+
+bool ShooterDecoder::Receiving() const
+{
+    return receiving;
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
@@ -0,0 +1,116 @@
+/**
+* @brief      Shooter ID decoder for coded laser shots
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Every laser shot carries a short Manchester code, so several shooters can share a lane.
+*               A shot frame is a start bit (always 1), SHOOTER_ID_BITS of shooter ID, MSB first, and an even parity
+*               bit. A 1 is light for the first half of the bit and dark for the second, a 0 the other way round,
+*               so every bit has a transition in the middle and a steady lamp never reads as a code.
+*
+*               The decoder takes one on/off decision per ADC sample (from HitDetector) and starts a frame at
+*               the first lit sample. Each half bit is SHOOTER_HALF_BIT_SAMPLES samples; the lit samples of the two
+*               halves are compared, and the difference is the bit's margin. The weakest bit sets the confidence,
+*               so a shot with jitter or noise on one edge still decodes, but says it was less sure.
+*               A frame that fails the start bit or parity is still a hit, from SHOOTER_UNKNOWN at confidence 0:
+*               uncoded lasers keep working.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef SHOOTER_DECODER_H
+#define SHOOTER_DECODER_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// shooter ID bits in a frame, up to 16 shooters
+#define SHOOTER_ID_BITS 4
+// start bit, ID, parity
+#define SHOOTER_FRAME_BITS (1 + SHOOTER_ID_BITS + 1)
+// ADC samples per half bit. A power of two, so the confidence needs no division.
+#define SHOOTER_HALF_BIT_SAMPLES 4
+#define SHOOTER_HALF_BIT_SHIFT 2
+// dark samples in a row after a frame before the next frame can start
+#define SHOOTER_GAP_SAMPLES (2 * SHOOTER_HALF_BIT_SAMPLES)
+// shooter of a hit whose code did not decode
+#define SHOOTER_UNKNOWN 0xFF
+
+static_assert((1 << SHOOTER_HALF_BIT_SHIFT) == SHOOTER_HALF_BIT_SAMPLES, "the half bit shift does not match");
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// A decoded shot
+struct HitEvent
+{
+	// shooter ID, SHOOTER_UNKNOWN if the code did not decode
+	uint8_t Shooter;
+	// 255 when every half bit was clean, 0 for an unknown shooter
+	uint8_t Confidence;
+	// TimeBase time of the first bright sample, in us. Filled by LightSensor::DetectHit().
+	uint32_t Time;
+};
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+class ShooterDecoder
+{
+	// true while a frame is being received
+	bool receiving;
+	// samples into the current bit
+	uint8_t sample;
+	// lit samples in the first and second half of the current bit
+	uint8_t firstLit;
+	uint8_t secondLit;
+	// bits received so far, first bit highest
+	uint8_t bitCount;
+	uint8_t bits;
+	// smallest half bit difference of the frame so far
+	uint8_t minMargin;
+	// dark samples still needed before the next frame
+	uint8_t gap;
+
+	// Decode the received bits.
+	// @param event: receives the shot
+	void finish(HitEvent& event);
+
+public:
+	ShooterDecoder();
+
+	// Forget any frame in progress
+	void Reset();
+
+	// Take the next sample.
+	// @param lit: true if the sample is a hit by HitDetector
+	// @param event: receives the shot when a frame completes
+	// @return bool: true when a frame completed and event was filled
+	bool Update(bool lit, HitEvent& event);
+
+	// @return bool: true while a frame is being received
+	bool Receiving() const;
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !SHOOTER_DECODER_H
@@ -27,31 +27,35 @@
 /*                         #define declarations                         */
 /************************************************************************/
 
-// for trimming only the lower 9 bits of a uint16_t
-#define MASK_9_BIT_MAX 0x1FF
-
-#define MASK_LODVTH 0x03
-#define MASK_SEL_TD0 0x0C
-#define MASK_SEL_GDLY 0x10
-#define MASK_XREFRESH 0x20
-#define MASK_SEL_GCK_EDGE 0x40
-#define MASK_SEL_PCHG 0x80
-#define MASK_ESPWM 0x100
-#define MASK_LGSE3 0x200
-#define MASK_SEL_SCK_EDGE 0x400
-#define MASK_LGSE1 0x3800
-#define MASK_CCB_LOW 0xC000
-#define MASK_CCB_MID 0x7F
-#define MASK_CCG_MID 0xFF80 
-#define MASK_CCR_HIGH 0x1FF
-#define MASK_BC_HIGH 0xE00
-#define MASK_POKER_TRANS_MODE 0x1000
-#define MASK_LGSE2 0xE000
-
 /************************************************************************/
 /*                         Forward declarations                         */
 /************************************************************************/
 
+// The builder defaults must match the FC register default in the user guide: 0x0900_8040_0015
+static_assert(FCRegisterBuilder().Build().Register_high == 0x0900
+    && FCRegisterBuilder().Build().Register_mid == 0x8040
+    && FCRegisterBuilder().Build().Register_low == 0x0015,
+    "FCRegisterBuilder defaults do not match the TLC5957 FC register default");
+
+// Setting every field away from its default and back again must land on the default.
+// Catches masks that clear the wrong field.
+constexpr FCRegister FCRoundTrip = FCRegisterBuilder()
+    .With_LODVTH(LODVTH::VLOD3).With_SEL_TD0(SEL_TD0::TD0_12NS).With_SEL_GDLY(false)
+    .With_XREFRESH(true).With_SEL_GCK_EDGE(true).With_SEL_PCHG(true).With_ESPWM(true)
+    .With_LGSE3(true).With_SEL_SCK_EDGE(true).With_LGSE1(LGSE::Strong)
+    .With_CCB<0x1FF>().With_CCG<0x1FF>().With_CCR<0x1FF>().With_BC<BC::Gain_154_5>()
+    .With_POKER_TRANS_MODE(true).With_LGSE2(LGSE::Strong)
+    .With_LODVTH(LODVTH::VLOD1).With_SEL_TD0(SEL_TD0::TD0_21NS).With_SEL_GDLY(true)
+    .With_XREFRESH(false).With_SEL_GCK_EDGE(false).With_SEL_PCHG(false).With_ESPWM(false)
+    .With_LGSE3(false).With_SEL_SCK_EDGE(false).With_LGSE1(LGSE::None)
+    .With_CCB<0x100>().With_CCG<0x100>().With_CCR<0x100>().With_BC<BC::Gain_100_0>()
+    .With_POKER_TRANS_MODE(false).With_LGSE2(LGSE::None)
+    .Build();
+static_assert(FCRoundTrip.Register_high == 0x0900
+    && FCRoundTrip.Register_mid == 0x8040
+    && FCRoundTrip.Register_low == 0x0015,
+    "FCRegisterBuilder masks are wrong");
+
 /************************************************************************/
 /*                     Data structures declarations                     */
 /************************************************************************/
@@ -181,7 +185,7 @@ void FCRegister::SetBit_SEL_GCK_EDGE(bool value)
 	}
 	else
 	{
-		Register_low &= ~MASK_SEL_SCK_EDGE;
+		Register_low &= ~MASK_SEL_GCK_EDGE;
 	}
 }
 
@@ -28,6 +28,29 @@
 /*                         #define declarations                         */
 /************************************************************************/
 
+// for trimming only the lower 9 bits of a uint16_t
+#define MASK_9_BIT_MAX 0x1FF
+
+// FC register bit masks, per 16-bit register word
+
+#define MASK_LODVTH 0x03
+#define MASK_SEL_TD0 0x0C
+#define MASK_SEL_GDLY 0x10
+#define MASK_XREFRESH 0x20
+#define MASK_SEL_GCK_EDGE 0x40
+#define MASK_SEL_PCHG 0x80
+#define MASK_ESPWM 0x100
+#define MASK_LGSE3 0x200
+#define MASK_SEL_SCK_EDGE 0x400
+#define MASK_LGSE1 0x3800
+#define MASK_CCB_LOW 0xC000
+#define MASK_CCB_MID 0x7F
+#define MASK_CCG_MID 0xFF80 
+#define MASK_CCR_HIGH 0x1FF
+#define MASK_BC_HIGH 0xE00
+#define MASK_POKER_TRANS_MODE 0x1000
+#define MASK_LGSE2 0xE000
+
 /************************************************************************/
 /*                         Forward declarations                         */
 /************************************************************************/
@@ -311,6 +334,146 @@ public:
 
 };
 
+// Builds the 48-bit FC register at compile time.
+// Starts from the default values in the user guide. Each With_ call returns a modified copy, so calls chain:
+//   constexpr FCRegister fc = FCRegisterBuilder().With_CCB<102>().With_XREFRESH(true).Build();
+// Out of range CC/BC values are rejected by static_assert instead of being silently masked.
+class FCRegisterBuilder
+{
+	uint16_t high;
+	uint16_t mid;
+	uint16_t low;
+
+	constexpr FCRegisterBuilder(uint16_t high, uint16_t mid, uint16_t low)
+		: high(high), mid(mid), low(low)
+	{
+	}
+
+	constexpr FCRegisterBuilder withLow(uint16_t mask, uint16_t bits) const
+	{
+		return FCRegisterBuilder(high, mid, (uint16_t)((low & ~mask) | (bits & mask)));
+	}
+
+	constexpr FCRegisterBuilder withMid(uint16_t mask, uint16_t bits) const
+	{
+		return FCRegisterBuilder(high, (uint16_t)((mid & ~mask) | (bits & mask)), low);
+	}
+
+	constexpr FCRegisterBuilder withHigh(uint16_t mask, uint16_t bits) const
+	{
+		return FCRegisterBuilder((uint16_t)((high & ~mask) | (bits & mask)), mid, low);
+	}
+
+	static constexpr uint16_t lgseBits(LGSE value, uint16_t weak, uint16_t medium, uint16_t strong)
+	{
+		return (LGSE::Weak == value) ? weak
+			: (LGSE::Medium == value) ? medium
+			: (LGSE::Strong == value) ? strong
+			: 0x00;
+	}
+
+public:
+	// LODVTH 01b, SEL_TD0 01b, SEL_GDLY 1b, CCB/CCG/CCR 1 0000 0000b, BC 100b, everything else 0
+	constexpr FCRegisterBuilder()
+		: high(0x0900), mid(0x8040), low(0x0015)
+	{
+	}
+
+	constexpr FCRegisterBuilder With_LODVTH(LODVTH value) const
+	{
+		return withLow(MASK_LODVTH, (uint16_t)value);
+	}
+
+	constexpr FCRegisterBuilder With_SEL_TD0(SEL_TD0 value) const
+	{
+		return withLow(MASK_SEL_TD0, (uint16_t)value << 2);
+	}
+
+	constexpr FCRegisterBuilder With_SEL_GDLY(bool value) const
+	{
+		return withLow(MASK_SEL_GDLY, value ? MASK_SEL_GDLY : 0);
+	}
+
+	constexpr FCRegisterBuilder With_XREFRESH(bool value) const
+	{
+		return withLow(MASK_XREFRESH, value ? MASK_XREFRESH : 0);
+	}
+
+	constexpr FCRegisterBuilder With_SEL_GCK_EDGE(bool value) const
+	{
+		return withLow(MASK_SEL_GCK_EDGE, value ? MASK_SEL_GCK_EDGE : 0);
+	}
+
+	constexpr FCRegisterBuilder With_SEL_PCHG(bool value) const
+	{
+		return withLow(MASK_SEL_PCHG, value ? MASK_SEL_PCHG : 0);
+	}
+
+	constexpr FCRegisterBuilder With_ESPWM(bool value) const
+	{
+		return withLow(MASK_ESPWM, value ? MASK_ESPWM : 0);
+	}
+
+	constexpr FCRegisterBuilder With_LGSE3(bool value) const
+	{
+		return withLow(MASK_LGSE3, value ? MASK_LGSE3 : 0);
+	}
+
+	constexpr FCRegisterBuilder With_SEL_SCK_EDGE(bool value) const
+	{
+		return withLow(MASK_SEL_SCK_EDGE, value ? MASK_SEL_SCK_EDGE : 0);
+	}
+
+	constexpr FCRegisterBuilder With_LGSE1(LGSE value) const
+	{
+		return withLow(MASK_LGSE1, lgseBits(value, 0x0800, 0x2000, 0x3800));
+	}
+
+	template<uint16_t value>
+	constexpr FCRegisterBuilder With_CCB() const
+	{
+		static_assert(value <= MASK_9_BIT_MAX, "CCB is 9 bits (000h - 1FFh)");
+		// lowest 2 bits go to bits 14 and 15 of the low word, the top 7 bits to bits 0-6 of the middle word
+		return withLow(MASK_CCB_LOW, (uint16_t)((value & 0x03) << 14)).withMid(MASK_CCB_MID, value >> 2);
+	}
+
+	template<uint16_t value>
+	constexpr FCRegisterBuilder With_CCG() const
+	{
+		static_assert(value <= MASK_9_BIT_MAX, "CCG is 9 bits (000h - 1FFh)");
+		return withMid(MASK_CCG_MID, (uint16_t)(value << 7));
+	}
+
+	template<uint16_t value>
+	constexpr FCRegisterBuilder With_CCR() const
+	{
+		static_assert(value <= MASK_9_BIT_MAX, "CCR is 9 bits (000h - 1FFh)");
+		return withHigh(MASK_CCR_HIGH, value);
+	}
+
+	template<BC value>
+	constexpr FCRegisterBuilder With_BC() const
+	{
+		static_assert((uint16_t)value <= 0x07, "BC is 3 bits (0h - 7h)");
+		return withHigh(MASK_BC_HIGH, (uint16_t)value << 9);
+	}
+
+	constexpr FCRegisterBuilder With_POKER_TRANS_MODE(bool value) const
+	{
+		return withHigh(MASK_POKER_TRANS_MODE, value ? MASK_POKER_TRANS_MODE : 0);
+	}
+
+	constexpr FCRegisterBuilder With_LGSE2(LGSE value) const
+	{
+		return withHigh(MASK_LGSE2, lgseBits(value, 0x2000, 0xA000, 0xE000));
+	}
+
+	constexpr FCRegister Build() const
+	{
+		return FCRegister{ high, mid, low };
+	}
+};
+
 /************************************************************************/
 /*                         Routine declarations                         */
 /************************************************************************/
@@ -0,0 +1,101 @@
+/**
+* @brief      Free running 32-bit microsecond time base
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Extends FRAME_TIMER to 32 bits with a count of its overflows.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "LaserTarget.h"
+#include "TimeBase.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+volatile uint16_t TimeBase::overflows = 0;
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+TimeBase::TimeBase()
+{
+}
+
+TimeBase::~TimeBase()
+{
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+void TimeBase::Start()
+{
+    uint16_t state = __get_interrupt_state();
+    __disable_interrupt();
+    overflows = 0;
+    __set_interrupt_state(state);
+}
+
+uint32_t TimeBase::Now()
+{
+    uint16_t state = __get_interrupt_state();
+    __disable_interrupt();
+    uint32_t now = NowFromISR();
+    __set_interrupt_state(state);
+    return now;
+}
+
+uint32_t TimeBase::NowFromISR()
+{
+    uint16_t high = overflows;
+    uint16_t low = FRAME_TIMER_COUNT;
+    // The flag is read after the count. If it is set and the count is in the lower half, the count has wrapped
+    // and the interrupt has not counted it yet. A count in the upper half was read before the wrap.
+    if ((0 != (FRAME_TIMER & TBIFG)) && (low < 0x8000))
+    {
+        high++;
+    }
+    return ((uint32_t)high << 16) | low;
+}
+
+void TimeBase::Overflow()
+{
+    overflows++;
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
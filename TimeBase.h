@@ -0,0 +1,78 @@
+/**
+* @brief      Free running 32-bit microsecond time base
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Extends FRAME_TIMER (TB0, 1us per tick, continuous mode) to 32 bits: the TB0 overflow interrupt counts
+*               the high word, FRAME_TIMER_COUNT is the low word. It wraps after about 71.6 minutes, so compare
+*               times by subtracting them as uint32_t.
+*
+*               Reading the two halves is only safe with interrupts off, and even then the timer may have
+*               overflowed without the interrupt having run yet. Now() and NowFromISR() see that from TBIFG: if
+*               the flag is pending and the low word has already wrapped, the high word is one behind.
+*
+*               The 1us tick is SMCLK/2. main.cpp and main_real.cpp both lock SMCLK to 2MHz with the FLL
+*               (MCLK 16MHz, SMCLK = MCLK/8); a firmware that clocks SMCLK differently has to change the
+*               FRAME_TIMER divider to match.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef TIME_BASE_H
+#define TIME_BASE_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+class TimeBase
+{
+	TimeBase();
+	~TimeBase();
+
+	// FRAME_TIMER overflows since Start(), the high word of the time
+	volatile static uint16_t overflows;
+
+public:
+
+	// Start counting from 0. Call right after FRAME_TIMER = FRAME_TIMER_ON, which clears the timer.
+	static void Start();
+
+	// @return uint32_t: microseconds since Start(). Any context.
+	static uint32_t Now();
+
+	// Now() for interrupt service routines, where interrupts are off already
+	// @return uint32_t: microseconds since Start()
+	static uint32_t NowFromISR();
+
+	// FRAME_TIMER overflow handler, call from the TB0 overflow case of TIMER0_B1_ISR
+	static void Overflow();
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !TIME_BASE_H
@@ -20,6 +20,7 @@
 #include <msp430.h>
 #include "LaserTarget.h"
 #include "HaloPattern.h"
+#include "HaloCompositor.h"
 
 /************************************************************************/
 /*                            Using section                             */
@@ -41,6 +42,9 @@
 /*                         Routine declarations                         */
 /************************************************************************/
 
+// Jump the chase to its idle position
+void doIdle(void);
+
 /************************************************************************/
 /*                        Variables declarations                        */
 /************************************************************************/
@@ -108,6 +112,9 @@ inline void Setup(void)
 
     // CLOCK CONFIG
 
+    // FRAM needs one wait state for MCLK above 8 MHz
+    FRCTL0 = FRCTLPW | NWAITS_1;
+
     // disable FLL
     __bis_SR_register(SCG0);
 
@@ -121,9 +128,9 @@ inline void Setup(void)
     // Also see the FLLN multiplier bits
     CSCTL2 = FLLD_0 + 487;
 
-    // SELA_2 --->> Set ACLK = VLO (internal 10-kHz clock source); 
+    // SELA_1 --->> Set ACLK = REFO (internal 32768-Hz clock source). LightSensor times its samples on ACLK.
     // SELMS_0 --->> Selects DCOCLKDIV as the MCLK and SMCLK source 
-    CSCTL4 = SELA_2 + SELMS_0;
+    CSCTL4 = SELA_1 + SELMS_0;
 
     // SMCLK directly derives from MCLK. SMCLK frequency is the combination of DIVM and DIVS out of selected clock source.
     // DIVS --->> SMCLK source divider.
@@ -139,9 +146,9 @@ inline void Setup(void)
     // FLL locked
     while (CSCTL7 & (FLLUNLOCK0 | FLLUNLOCK1));
     // NOTE: at this point, on the msp430FR2355, The clock values will be:
-    // NOTE: VLOCLK: Internal very-low-power low-frequency oscillator with 10-kHz typical frequency
+    // NOTE: REFOCLK: Internal trimmed low-frequency reference oscillator, 32768 Hz
     // NOTE: DCO  -- 16 MHz
-    // NOTE: ACLK -- ~10 KHz (~0.01 MHz)
+    // NOTE: ACLK -- 32768 Hz
     // NOTE: SMCLK-- 2 MHz
     // NOTE: MCLK -- 16 MHz
     // NOTE: VLO will be shut off if unused.
@@ -480,6 +487,9 @@ void RenderHaloFrame(void)
         FrameRenderCount++;
     }
 
+    // put the frame on the halo
+    HaloCompositor::Render();
+
     LED_State = false;
     __no_operation();
 }
@@ -20,9 +20,16 @@
 #include <msp430.h>
 #include "LaserTarget.h"
 #include "HaloPattern.h"
+#include "HaloVM.h"
+#include "HaloPack.h"
+#include "HaloStream.h"
+#include "HaloEffect.h"
+#include "HaloFrameRate.h"
+#include "HaloCompositor.h"
 #include "LightSensor.h"
 #include "Bluetooth.h"
 #include "Interrupts.h"
+#include "TimeBase.h"
 
 /************************************************************************/
 /*                            Using section                             */
@@ -50,7 +57,6 @@
 
 int runningAvg = 500;
 
-bool hitmarker = false;
 //-------------------------
 //    debounce stuff
 //-------------------------
@@ -75,8 +81,26 @@ volatile uint8_t debounceTimerCount = 0;
 //the number of times the LED timer has overflowed
 volatile int LED_OverflowCnt = 0;
 
-// how many frames have been rendered
+// animation frame on the halo, counted in frame ticks since the animation started
 uint16_t FrameRenderCount = 0;
+// Interrupts::FrameTicks when the current animation started
+uint32_t animationStart = 0;
+// Interrupts::FrameTicks the animation was last rendered at
+uint32_t animationTick = 0;
+// frames rendered and frame ticks that went by without a render, since the last halo status report
+uint16_t framesRendered = 0;
+uint16_t framesDropped = 0;
+
+// did the halo FC register read back with the intended value at boot
+bool haloFCVerified = false;
+
+// FRAME_TIMER count at the start of the last Loop() pass
+uint16_t loopLastPass = 0;
+// longest Loop() pass since the last halo status report, in FRAME_TIMER ticks (1us)
+uint16_t loopStallMax = 0;
+// longest frame render since the last halo status report, in FRAME_TIMER ticks (1us), without the status report.
+// Bluetooth I/O is left out, so this is the halo's share of loopStallMax.
+uint16_t haloStallMax = 0;
 
 
 //-------------------------
@@ -106,6 +130,9 @@ inline void Setup(void)
 
     // CLOCK CONFIG
 
+    // FRAM needs one wait state for MCLK above 8 MHz
+    FRCTL0 = FRCTLPW | NWAITS_1;
+
     // disable FLL
     __bis_SR_register(SCG0);                           
    
@@ -119,9 +146,9 @@ inline void Setup(void)
     // Also see the FLLN multiplier bits
     CSCTL2 = FLLD_0 + 487;
 
-    // SELA_2 --->> Set ACLK = VLO (internal 10-kHz clock source); 
+    // SELA_1 --->> Set ACLK = REFO (internal 32768-Hz clock source). LightSensor times its samples on ACLK.
     // SELMS_0 --->> Selects DCOCLKDIV as the MCLK and SMCLK source 
-    CSCTL4 = SELA_2 + SELMS_0;
+    CSCTL4 = SELA_1 + SELMS_0;
 
     // SMCLK directly derives from MCLK. SMCLK frequency is the combination of DIVM and DIVS out of selected clock source.
     // DIVS --->> SMCLK source divider.
@@ -137,10 +164,10 @@ inline void Setup(void)
     // FLL locked
     while (CSCTL7 & (FLLUNLOCK0 | FLLUNLOCK1));
     // NOTE: at this point, on the msp430FR2355, The clock values will be:
-    // NOTE: VLOCLK: Internal very-low-power low-frequency oscillator with 10-kHz typical frequency
+    // NOTE: REFOCLK: Internal trimmed low-frequency reference oscillator, 32768 Hz
     // NOTE: DCO  -- 16 MHz
-    // NOTE: ACLK -- ~10 KHz (~0.01 MHz)
-    // NOTE: SMCLK-- 2 MHz
+    // NOTE: ACLK -- 32768 Hz
+    // NOTE: SMCLK-- 2 MHz, so FRAME_TIMER (SMCLK/2) counts 1us
     // NOTE: MCLK -- 16 MHz
     // NOTE: VLO will be shut off if unused.
 
@@ -199,8 +226,10 @@ inline void Setup(void)
 
 
 
-    // halo frame rate timer
+    // halo frame rate timer: a free running 1us clock, frame ticks come from its CCR0
     FRAME_TIMER = FRAME_TIMER_ON;
+    TimeBase::Start();
+    HaloFrameRate::Start(HALO_FPS_DEFAULT);
 
     //// debounce timer
     //// NOTE: debounce timer to be started by edge trigger and stopped by debounce function
@@ -219,8 +248,7 @@ inline void Setup(void)
 
     TB0CCR1 = PWM_TRIGGER;
     TB0CCTL1 = CCIE;
-    TB0CCR2 = PWM_TRIGGER + 1;
-    TB0CCTL2 = CCIE;
+    // CCR2 belongs to HaloFlush, which sends the halo frames in the background
 
 
     Bluetooth::Init();
@@ -238,13 +266,14 @@ inline void Setup(void)
     debounced_state = 0;
     FrameRenderCount = 0;
     Interrupts::FrameInterruptCount = 0;
+    restartAnimation();
 
     // setup eeprom
     crc_msg = 0;
 
 
     //debounce();
-    InitLEDController();
+    haloFCVerified = InitLEDController();
     //LightSensor::InitGPIO();
     //LightSensor::InitADC();
 
@@ -257,6 +286,14 @@ inline void Setup(void)
 
 inline void Loop(void)
 {
+    // track the longest pass, which is the worst case latency for everything Loop() services
+    uint16_t now = FRAME_TIMER_COUNT;
+    uint16_t pass = now - loopLastPass;
+    loopLastPass = now;
+    if (pass > loopStallMax)
+    {
+        loopStallMax = pass;
+    }
 
     if (doDebounce)
     {
@@ -264,12 +301,16 @@ inline void Loop(void)
         __no_operation();
         doDebounce = false;
     }
-    if (Interrupts::LED_State || hitmarker)
+    if (Bluetooth::HasData())
+    {
+        processCommands();
+    }
+
+    // a frame still going out in the background holds the next one back until the following pass
+    if (Interrupts::LED_State && !HaloFrame.Busy())
     {
         //DEBUG_4 ^= DEBUG_4_B;
         //DEBUG_4 ^= DEBUG_4_B;
-        Bluetooth::print("Rendering frame #");
-        Bluetooth::print(FrameRenderCount);
         RenderHaloFrame();
         Interrupts::LED_State = false;
 
@@ -308,28 +349,151 @@ int main(void)
 
 void RenderHaloFrame(void)
 {
+    uint16_t renderStart = FRAME_TIMER_COUNT;
+    bool idle = false;
     if (Interrupts::FrameInterruptCount > IDLE_TIME_COUNT)
     {
         Interrupts::FrameInterruptCount = 0;
-        doIdle();
+        idle = true;
     }
 
-    // Render the next animation frame.
-    // If the animation returns false, the last frame has been rendered
-    if (!BlueCW(FrameRenderCount))
+    // Animations run on the frame timer, not on the number of frames rendered.
+    // When Loop() is late the animation skips ahead to where it should be, instead of slowing down.
+    uint32_t now = Interrupts::GetFrameTicks();
+    uint32_t elapsed = now - animationTick;
+    animationTick = now;
+    if (0 != elapsed)
     {
-        FrameRenderCount = 0;
-        hitmarker = false;
+        framesRendered++;
+        framesDropped += elapsed - 1;
+    }
+
+    // Render the animation frame for this tick: frames streamed from the phone come first,
+    // then the loaded pattern, pack or effect if one is playing.
+    // If the animation returns false, the last frame has been rendered and it starts over.
+    // A boosted wakeup between frame ticks renders with frames = 0, which only redraws.
+    uint32_t frame = now - animationStart;
+    FrameRenderCount = (frame < 0xFFFF) ? frame : 0xFFFF;
+    uint8_t frames = (elapsed < 0xFF) ? elapsed : 0xFF;
+    uint8_t fps = HALO_FPS_DEFAULT;
+    bool nextFrame;
+    if (HaloStream::Active())
+    {
+        // the phone paces the stream at the default rate
+        nextFrame = HaloStream::RenderFrame(frames);
+    }
+    else if (HaloVM::Playing())
+    {
+        nextFrame = HaloVM::RenderFrame(frames);
+        fps = HaloVM::FrameRate();
+    }
+    else if (HaloPack::Playing())
+    {
+        nextFrame = HaloPack::RenderFrame(frames);
+    }
+    else if (HaloEffect::Playing())
+    {
+        nextFrame = HaloEffect::RenderFrame(frames);
+        fps = HaloEffect::FrameRate();
     }
     else
     {
-        FrameRenderCount++;
+        nextFrame = BlueCW(FrameRenderCount);
+    }
+    if (!nextFrame)
+    {
+        animationStart = now;
+    }
+
+    // blend the layers and put the frame on the halo
+    HaloCompositor::Render();
+
+    // Tick only as often as what is playing needs. A fading hit flash gets redrawn faster.
+    HaloFrameRate::Set(fps);
+    HaloFrameRate::Boost(!HaloCompositor::Layer(HaloLayerId::HitFlash).Empty());
+
+    uint16_t renderTicks = FRAME_TIMER_COUNT - renderStart;
+    if (renderTicks > haloStallMax)
+    {
+        haloStallMax = renderTicks;
+    }
+
+    if (idle)
+    {
+        // the read back waits for the frame to be latched, so the LED open detection result is fresh
+        reportHaloStatus();
     }
 
     Interrupts::LED_State = false;
     __no_operation();
 }
 
+void reportHaloStatus(void)
+{
+    uint16_t openLEDs[HALO_CHIP_COUNT][RGB_CHANNEL_COUNT];
+    ReadLEDOpenDetect(openLEDs);
+
+    if (!haloFCVerified)
+    {
+        Bluetooth::println("Halo FC verify failed");
+    }
+
+    for (uint8_t chip = 0; chip < HALO_CHIP_COUNT; chip++)
+    {
+        uint16_t* open = openLEDs[chip];
+        if (open[(uint8_t)HaloColor::Red] | open[(uint8_t)HaloColor::Green] | open[(uint8_t)HaloColor::Blue])
+        {
+            Bluetooth::print("Halo chip ");
+            Bluetooth::print(chip);
+            Bluetooth::print(" LED open R:");
+            Bluetooth::print(open[(uint8_t)HaloColor::Red]);
+            Bluetooth::print(" G:");
+            Bluetooth::print(open[(uint8_t)HaloColor::Green]);
+            Bluetooth::print(" B:");
+            Bluetooth::println(open[(uint8_t)HaloColor::Blue]);
+        }
+    }
+
+    Bluetooth::print("Loop stall max us:");
+    Bluetooth::println(loopStallMax);
+    Bluetooth::print("Halo stall max us:");
+    Bluetooth::println(haloStallMax);
+    Bluetooth::print("Halo compose max us:");
+    Bluetooth::println(HaloCompositor::RenderTicksMax);
+    Bluetooth::print("Halo pack decode max us:");
+    Bluetooth::println(HaloPack::DecodeTicksMax);
+    Bluetooth::print("Halo effect max us:");
+    Bluetooth::print(HaloEffect::RenderTicksMax);
+    Bluetooth::print(" over budget:");
+    Bluetooth::println(HaloEffect::OverBudget);
+    Bluetooth::print("Halo stream underruns:");
+    Bluetooth::print(HaloStream::Underruns);
+    Bluetooth::print(" dropped:");
+    Bluetooth::println(HaloStream::Dropped);
+    Bluetooth::print("Bluetooth RX dropped:");
+    Bluetooth::println(Bluetooth::RxDropped);
+    Bluetooth::print("Halo fps:");
+    Bluetooth::println(HaloFrameRate::Get());
+    Bluetooth::print("Halo frames rendered:");
+    Bluetooth::print(framesRendered);
+    Bluetooth::print(" dropped:");
+    Bluetooth::println(framesDropped);
+
+    // start a new measurement window, leaving out the time spent printing
+    loopStallMax = 0;
+    haloStallMax = 0;
+    HaloCompositor::RenderTicksMax = 0;
+    HaloPack::DecodeTicksMax = 0;
+    HaloEffect::RenderTicksMax = 0;
+    HaloEffect::OverBudget = 0;
+    HaloStream::Underruns = 0;
+    HaloStream::Dropped = 0;
+    Bluetooth::RxDropped = 0;
+    framesRendered = 0;
+    framesDropped = 0;
+    loopLastPass = FRAME_TIMER_COUNT;
+}
+
 int16_t findHaloPattern(void)
 {
     return 0;
@@ -380,11 +544,11 @@ uint8_t readkeys(void)
 }
 
 
-void doIdle(void)
+void restartAnimation(void)
 {
-    FrameRenderCount &= 8;
-    FrameRenderCount ^=8;
-    __no_operation();
+    animationStart = Interrupts::GetFrameTicks();
+    // the first frame is owed straight away
+    animationTick = animationStart - 1;
 }
 
 
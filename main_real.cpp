@@ -20,7 +20,10 @@
 #include <msp430.h>
 #include "LaserTarget.h"
 #include "HaloPattern.h"
+#include "HaloCompositor.h"
 #include "LightSensor.h"
+#include "TimeBase.h"
+#include "HaloFlush.h"
 
 /************************************************************************/
 /*                            Using section                             */
@@ -42,14 +45,16 @@
 /*                         Routine declarations                         */
 /************************************************************************/
 
+// Read FrameTicks in one piece. It takes two reads on the MSP430, which the overflow interrupt could split.
+// @return uint32_t: frame ticks since boot
+uint32_t getFrameTicks(void);
+
 /************************************************************************/
 /*                        Variables declarations                        */
 /************************************************************************/
 
 int calibratedADC = 500;
-int runningAvg = 500;
 
-bool hitmarker = false;
 //-------------------------
 //    debounce stuff
 //-------------------------
@@ -77,9 +82,31 @@ volatile int LED_OverflowCnt = 0;
 volatile bool LED_State = 0;
 // Frame Rate Interrupt counter
 volatile uint32_t FrameInterruptCount = 0;
-
-// how many frames have been rendered
+// frame ticks since boot, one per frame timer overflow. Never reset, so the animation can take its time from it
+volatile uint32_t FrameTicks = 0;
+// frame timer overflows since the light sensor window was last re-centred
+volatile uint8_t RecentreCount = 0;
+// light sensor samples dropped because the main loop fell behind the ADC
+uint32_t SampleOverruns = 0;
+// most time the hit detector has taken per sample, in FRAME_TIMER ticks (1us, 16 MCLK cycles at 16MHz)
+uint16_t DetectTicksPerSampleMax = 0;
+// the last shot, and how many shots have been decoded since boot
+HitEvent LastHit = { SHOOTER_UNKNOWN, 0, 0 };
+uint16_t HitEventCount = 0;
+// how late a shot time can be, in us. Follows the stamp latency LightSensor measures.
+uint16_t HitTimeErrorUs = 0;
+// most time from a shot to the main loop seeing it, in us: the frame, the ring and the loop
+uint32_t HitNoticeUsMax = 0;
+
+// animation frame on the halo, counted in frame ticks since the animation started
 uint16_t FrameRenderCount = 0;
+// FrameTicks when the current animation started
+uint32_t animationStart = 0;
+// FrameTicks the animation was last rendered at
+uint32_t animationTick = 0;
+// frames rendered and frame ticks that went by without a render, since boot
+uint32_t framesRendered = 0;
+uint32_t framesDropped = 0;
 
 
 //-------------------------
@@ -114,26 +141,45 @@ inline void Setup(void)
 
     // CLOCK CONFIG
 
+    // FRAM needs one wait state for MCLK above 8 MHz
+    FRCTL0 = FRCTLPW | NWAITS_1;
+
+    // disable FLL
+    __bis_SR_register(SCG0);
+
     // Configure DCO
     // DCORSEL_7 = 24 MHz(Only avaliable in 24MHz clock system)
+    // DCORSEL_5 = 16 MHz
     // DCOFTRIMEN_0 = Disable frequency trim. DCOFTRIM value is bypassed and the DCO applies default settings from manufacture
-    CSCTL1 = DCORSEL_7 + DCOFTRIMEN_0;
+    CSCTL1 = DCORSEL_5 + DCOFTRIMEN_0;
 
-    // SELA_2 --->> Set ACLK = VLO (internal 10-kHz clock source); 
-    // SELMS_0 --->> Selects DCOCLKDIV as the MCLK and SMCLK source 
-    CSCTL4 = SELA_2 + SELMS_0;
+    // FLL loop divider. These bits divide fDCOCLK in the FLL feedback loop. This results in an additional multiplier for the multiplier bits.
+    // Also see the FLLN multiplier bits
+    CSCTL2 = FLLD_0 + 487;
 
+    // SELA_1 --->> Set ACLK = REFO (internal 32768-Hz clock source). LightSensor times its samples on ACLK.
+    // SELMS_0 --->> Selects DCOCLKDIV as the MCLK and SMCLK source 
+    CSCTL4 = SELA_1 + SELMS_0;
 
+    // SMCLK directly derives from MCLK. SMCLK frequency is the combination of DIVM and DIVS out of selected clock source.
+    // DIVS --->> SMCLK source divider.
+    // DIVM --->> MCLK source divider
     // set dividers SMCLK/8; MCLK/1
     CSCTL5 = DIVS_3 + DIVM_0 + VLOAUTOOFF_1;
+
     // set dividers ACLK/1;
     CSCTL6 = DIVA_0;
+    __delay_cycles(3);
+    // enable FLL
+    __bic_SR_register(SCG0);
+    // FLL locked
+    while (CSCTL7 & (FLLUNLOCK0 | FLLUNLOCK1));
     // NOTE: at this point, on the msp430FR2355, The clock values will be:
-    // NOTE: VLOCLK: Internal very-low-power low-frequency oscillator with 10-kHz typical frequency
-    // NOTE: DCO  -- 24 MHz
-    // NOTE: ACLK -- ~10 KHz (~0.01 MHz)
-    // NOTE: SMCLK-- 3 MHz
-    // NOTE: MCLK -- 24 MHz
+    // NOTE: REFOCLK: Internal trimmed low-frequency reference oscillator, 32768 Hz
+    // NOTE: DCO  -- 16 MHz
+    // NOTE: ACLK -- 32768 Hz
+    // NOTE: SMCLK-- 2 MHz, so FRAME_TIMER (SMCLK/2) counts 1us
+    // NOTE: MCLK -- 16 MHz
     // NOTE: VLO will be shut off if unused.
 
     // Select GPIO for pin functions
@@ -194,6 +240,7 @@ inline void Setup(void)
 
     // halo frame rate timer
     FRAME_TIMER = FRAME_TIMER_ON;
+    TimeBase::Start();
 
     //// debounce timer
     //// NOTE: debounce timer to be started by edge trigger and stopped by debounce function
@@ -212,8 +259,7 @@ inline void Setup(void)
 
     TB0CCR1 = PWM_TRIGGER;
     TB0CCTL1 = CCIE;
-    TB0CCR2 = PWM_TRIGGER + 1;
-    TB0CCTL2 = CCIE;
+    // CCR2 belongs to HaloFlush, which sends the halo frames in the background
 
     DEBUG_3 &= ~DEBUG_2_A;
     DEBUG_2 &= ~DEBUG_2_B;
@@ -248,6 +294,7 @@ inline void Setup(void)
     InitLEDController();
     LightSensor::InitGPIO();
     LightSensor::InitADC();
+    LightSensor::StartWindow();
 
     __enable_interrupt();
     //__bis_SR_register(GIE);       // Enter LPM3, enable interrupts
@@ -265,7 +312,7 @@ inline void Loop(void)
         __no_operation();
         doDebounce = false;
     }
-    if (LED_State && hitmarker)
+    if (LED_State)
     {
         //DEBUG_4 ^= DEBUG_4_B;
         //DEBUG_4 ^= DEBUG_4_B;
@@ -275,11 +322,43 @@ inline void Loop(void)
         __no_operation();
     }
 
-    runningAvg = ((runningAvg * 9) + LightSensor::ADC_value) / 10;
-    int diff = (runningAvg - calibratedADC) / 4;
-    if (diff > 5)
+    // The ADC window comparator starts a capture when a sample is brighter than the ambient light,
+    // so the ring stays empty in between. Drain it a batch at a time through the detection stage.
+    uint16_t batch[LIGHT_BATCH_SIZE];
+    uint16_t count;
+    HitEvent event;
+    while (0 != (count = LightSensor::Samples.Pop(batch, LIGHT_BATCH_SIZE)))
     {
-        hitmarker = true;
+        uint16_t start = FRAME_TIMER_COUNT;
+        if (LightSensor::DetectHit(batch, count, event))
+        {
+            LastHit = event;
+            HitEventCount++;
+            // hit feedback goes on top of the chase, starting with the next frame
+            HaloCompositor::Flash(HaloRGB{ 0xFF, 0x00, 0x00 });
+            uint32_t notice = TimeBase::Now() - event.Time;
+            if (notice > HitNoticeUsMax)
+            {
+                HitNoticeUsMax = notice;
+            }
+            HitTimeErrorUs = LightSensor::TimeErrorUs();
+        }
+        // no hardware divide, only the MPY32 multiply: a batch pays for a divide only when it sets a new worst
+        uint16_t ticks = FRAME_TIMER_COUNT - start;
+        if (ticks > (uint32_t)DetectTicksPerSampleMax * count)
+        {
+            DetectTicksPerSampleMax = ticks / count;
+        }
+    }
+    SampleOverruns += LightSensor::Samples.NewOverruns();
+
+    // Follow slow ambient drift, but not while the hit flash fades: the laser may still be on the sensor.
+    // This also re-arms hit detection after a hit. A re-centre ends the capture, so never in the middle of a shot code.
+    if ((RecentreCount >= LIGHT_RECENTRE_FRAMES) && HaloCompositor::Layer(HaloLayerId::HitFlash).Empty()
+        && !LightSensor::Decoder.Receiving())
+    {
+        RecentreCount = 0;
+        LightSensor::RequestBaseline();
     }
 
 
@@ -337,11 +416,8 @@ void __attribute__((interrupt(TIMER0_B1_VECTOR))) TIMER0_B1_ISR(void)
         //DEBUG_3 ^= DEBUG_3_A;
         break;
     case  4:
-        // CCR2
-        // DEBUG_3 ^= DEBUG_3_B;
-        // DEBUG_3 ^= DEBUG_3_B;
-
-
+        // CCR2: the next part of the halo frame in flight
+        HaloFlush::Tick();
         break;
     case  6: break;                          // reserved
     case  8: break;                          // reserved
@@ -352,6 +428,12 @@ void __attribute__((interrupt(TIMER0_B1_VECTOR))) TIMER0_B1_ISR(void)
         //DEBUG_OUT ^= DEBUG_7;
         LED_State = true;                  // overflow
         FrameInterruptCount++;
+        FrameTicks++;
+        TimeBase::Overflow();
+        if (RecentreCount < LIGHT_RECENTRE_FRAMES)
+        {
+            RecentreCount++;
+        }
         break;
     default: break;
     }
@@ -529,13 +611,17 @@ void __attribute__((interrupt(ADC_VECTOR))) ADC_ISR(void)
     case ADCIV_ADCTOVIFG:
         break;
     case ADCIV_ADCHIIFG:
+        // brighter than the ambient window
+        LightSensor::SampleAboveWindow();
         break;
     case ADCIV_ADCLOIFG:
+        // darker than the ambient window
+        LightSensor::SampleBelowWindow();
         break;
     case ADCIV_ADCINIFG:
         break;
     case ADCIV_ADCIFG:
-        LightSensor::ADC_value = ADCMEM0;
+        LightSensor::SampleReady();
         // Sleep Timer Exits LPM3
         //__bic_SR_register_on_exit(LPM3_bits);
         break;
@@ -567,24 +653,29 @@ int main(void)
 
 void RenderHaloFrame(void)
 {
-    if (FrameInterruptCount > IDLE_TIME_COUNT)
+    // The chase runs on the frame timer, not on the number of frames rendered.
+    // When Loop() is late the chase skips ahead to where it should be, instead of slowing down.
+    uint32_t now = getFrameTicks();
+    uint32_t elapsed = now - animationTick;
+    animationTick = now;
+    if (0 != elapsed)
     {
-        FrameInterruptCount = 0;
-        doIdle();
+        framesRendered++;
+        framesDropped += elapsed - 1;
     }
 
-    // Render the next animation frame.
-    // If the animation returns false, the last frame has been rendered
+    // Render the animation frame for this tick.
+    // If the animation returns false, the last frame has been rendered and it starts over.
+    uint32_t frame = now - animationStart;
+    FrameRenderCount = (frame < 0xFFFF) ? frame : 0xFFFF;
     if (!BlueCW(FrameRenderCount))
     {
-        FrameRenderCount = 0;
-        hitmarker = false;
-    }
-    else
-    {
-        FrameRenderCount++;
+        animationStart = now;
     }
 
+    // blend the layers and put the frame on the halo
+    HaloCompositor::Render();
+
     LED_State = false;
     __no_operation();
 }
@@ -639,11 +730,13 @@ uint8_t readkeys(void)
 }
 
 
-void doIdle(void)
+uint32_t getFrameTicks(void)
 {
-    FrameRenderCount &= 8;
-    FrameRenderCount ^=8;
-    __no_operation();
+    uint16_t state = __get_interrupt_state();
+    __disable_interrupt();
+    uint32_t ticks = FrameTicks;
+    __set_interrupt_state(state);
+    return ticks;
 }
 
 
@@ -0,0 +1,538 @@
+/**
+* @brief      Host side compiler for compressed halo animations
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Compiles an animation written as CSV keyframes into a pack for HaloPack on the target.
+*               Each frame is stored as the changes from the frame before it (skips, runs of one color,
+*               literal colors), so a pack usually takes a small part of the uncompressed size. The pack store
+*               holds up to HALO_PACK_SLOTS packs in its EEPROM_SIZE bytes, as many as fit together; the budget
+*               line below says how much of it this pack takes.
+*
+*               Build on the PC:   g++ -std=c++14 -O2 -o halopack tools/halopack.cpp
+*               Run:               halopack [-l leds] [-c name | -m [-s slot]] animation.csv output
+*
+*               Input: one keyframe per line, "ticks,rrggbb,rrggbb,..." with one hex color per LED.
+*               ticks is how many frame ticks the keyframe is shown for. Lines starting with # are comments.
+*               Output: the raw pack, or with -c a C array to paste into the firmware, or with -m the STORE_PACK
+*               messages that write it into a slot of the pack store over bluetooth, slot 0 unless -s says
+*               otherwise. Send them one at a time, waiting for "Pack part stored" after each, then PLAY_PACK
+*               with the slot.
+*
+*               The pack is decoded again and checked against the input before it is written. The decoder
+*               cycles per frame are an estimate from a per record cost model; on the target, reportHaloStatus
+*               prints the measured time as "Halo pack decode max us".
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "../HaloPack.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// LaserTarget.h RGB_LED_COUNT for a single TLC5957
+#define DEFAULT_LED_COUNT 16
+// LaserTarget.h EEPROM_SIZE
+#define PACK_BUDGET 8192
+// LaserTarget.h LEDCommands STORE_PACK
+#define COMMAND_STORE_PACK 7
+
+// Decoder cost model, MCLK cycles. Rough figures for HaloPack::decodeFrame() built with optimization on.
+// fixed cost of a frame: call, first frame check, loop setup
+#define CYCLES_PER_FRAME 30
+// reading and dispatching one record
+#define CYCLES_PER_RECORD 25
+// fetching one color byte
+#define CYCLES_PER_BYTE 12
+// HaloLayer::SetPixel() for one LED
+#define CYCLES_PER_LED 40
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+struct Color
+{
+    uint8_t Red;
+    uint8_t Green;
+    uint8_t Blue;
+
+    bool operator==(const Color& other) const
+    {
+        return (Red == other.Red) && (Green == other.Green) && (Blue == other.Blue);
+    }
+    bool operator!=(const Color& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+struct Keyframe
+{
+    // frame ticks the keyframe is shown for
+    unsigned Ticks;
+    std::vector<Color> Leds;
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+static bool parseColor(const char* text, Color& color)
+{
+    char* end;
+    unsigned long value = strtoul(text, &end, 16);
+    if ((end - text != 6) || (value > 0xFFFFFF))
+    {
+        return false;
+    }
+    color.Red = (uint8_t)(value >> 16);
+    color.Green = (uint8_t)(value >> 8);
+    color.Blue = (uint8_t)value;
+    return true;
+}
+
+// @return bool: false if the file cannot be read or a line is malformed. The reason is printed.
+static bool readKeyframes(const char* path, unsigned ledCount, std::vector<Keyframe>& keyframes)
+{
+    FILE* file = fopen(path, "r");
+    if (nullptr == file)
+    {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+
+    char line[4096];
+    unsigned lineNumber = 0;
+    bool ok = true;
+    while (ok && (nullptr != fgets(line, sizeof(line), file)))
+    {
+        lineNumber++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (('\0' == line[0]) || ('#' == line[0]))
+        {
+            continue;
+        }
+
+        Keyframe keyframe;
+        char* field = strtok(line, ",");
+        char* end = nullptr;
+        keyframe.Ticks = (nullptr != field) ? (unsigned)strtoul(field, &end, 10) : 0;
+        if ((nullptr == field) || (end == field) || (0 == keyframe.Ticks))
+        {
+            fprintf(stderr, "%s:%u: the line has to start with a tick count of 1 or more\n", path, lineNumber);
+            ok = false;
+            break;
+        }
+
+        while (nullptr != (field = strtok(nullptr, ",")))
+        {
+            while (' ' == *field)
+            {
+                field++;
+            }
+            Color color;
+            if (!parseColor(field, color))
+            {
+                fprintf(stderr, "%s:%u: \"%s\" is not a rrggbb color\n", path, lineNumber, field);
+                ok = false;
+                break;
+            }
+            keyframe.Leds.push_back(color);
+        }
+
+        if (ok && (keyframe.Leds.size() != ledCount))
+        {
+            fprintf(stderr, "%s:%u: %u colors, expected %u\n", path, lineNumber, (unsigned)keyframe.Leds.size(), ledCount);
+            ok = false;
+        }
+        if (ok)
+        {
+            keyframes.push_back(keyframe);
+        }
+    }
+
+    fclose(file);
+    if (ok && keyframes.empty())
+    {
+        fprintf(stderr, "%s: no keyframes\n", path);
+        ok = false;
+    }
+    return ok;
+}
+
+static void putRecord(std::vector<uint8_t>& pack, uint8_t type, unsigned count)
+{
+    pack.push_back(type | (uint8_t)(count - 1));
+}
+
+static void putColor(std::vector<uint8_t>& pack, const Color& color)
+{
+    pack.push_back(color.Red);
+    pack.push_back(color.Green);
+    pack.push_back(color.Blue);
+}
+
+// Append one frame as the changes from the previous one, ending with a show record.
+static void encodeFrame(const std::vector<Color>& previous, const Keyframe& keyframe, std::vector<uint8_t>& pack)
+{
+    const std::vector<Color>& leds = keyframe.Leds;
+    const unsigned ledCount = (unsigned)leds.size();
+
+    unsigned led = 0;
+    while (led < ledCount)
+    {
+        if (leds[led] == previous[led])
+        {
+            unsigned same = led;
+            while ((same < ledCount) && (leds[same] == previous[same]))
+            {
+                same++;
+            }
+            if (same == ledCount)
+            {
+                // the show record leaves the rest as they are
+                break;
+            }
+            for (unsigned left = same - led; left > 0;)
+            {
+                unsigned count = (left < HALO_PACK_COUNT_MAX) ? left : HALO_PACK_COUNT_MAX;
+                putRecord(pack, HALO_PACK_SKIP, count);
+                left -= count;
+            }
+            led = same;
+            continue;
+        }
+
+        // a run may carry on over LEDs that already had the color
+        unsigned run = led + 1;
+        while ((run < ledCount) && (run - led < HALO_PACK_COUNT_MAX) && (leds[run] == leds[led]))
+        {
+            run++;
+        }
+        if (run - led >= 2)
+        {
+            putRecord(pack, HALO_PACK_RUN, run - led);
+            putColor(pack, leds[led]);
+            led = run;
+            continue;
+        }
+
+        // literal colors up to the next unchanged LED or the next run
+        unsigned last = led + 1;
+        while ((last < ledCount) && (last - led < HALO_PACK_COUNT_MAX) && (leds[last] != previous[last])
+            && !((last + 1 < ledCount) && (leds[last + 1] == leds[last])))
+        {
+            last++;
+        }
+        putRecord(pack, HALO_PACK_LITERAL, last - led);
+        for (; led < last; led++)
+        {
+            putColor(pack, leds[led]);
+        }
+    }
+
+    // long keyframes are shown over several show records, the extra ones are frames without changes
+    for (unsigned left = keyframe.Ticks; left > 0;)
+    {
+        unsigned count = (left < HALO_PACK_COUNT_MAX) ? left : HALO_PACK_COUNT_MAX;
+        putRecord(pack, HALO_PACK_SHOW, count);
+        left -= count;
+    }
+}
+
+// Decode the pack the way HaloPack does, checking it against the keyframes and costing every frame.
+// @return bool: false if the pack does not reproduce the keyframes.
+static bool verifyPack(const std::vector<uint8_t>& pack, const std::vector<Keyframe>& keyframes,
+    unsigned& cyclesTotal, unsigned& cyclesMax, unsigned& packFrames)
+{
+    const unsigned ledCount = pack[0];
+    std::vector<Color> leds(ledCount, Color{ 0, 0, 0 });
+    size_t offset = HALO_PACK_HEADER_SIZE;
+    size_t keyframe = 0;
+    unsigned shown = 0;
+
+    cyclesTotal = 0;
+    cyclesMax = 0;
+    packFrames = 0;
+
+    while (offset < pack.size())
+    {
+        unsigned cycles = CYCLES_PER_FRAME;
+        unsigned led = 0;
+        unsigned hold = 0;
+        while ((0 == hold) && (offset < pack.size()))
+        {
+            uint8_t record = pack[offset++];
+            unsigned count = (record & HALO_PACK_COUNT_MASK) + 1;
+            cycles += CYCLES_PER_RECORD;
+
+            switch (record & HALO_PACK_TYPE_MASK)
+            {
+            case HALO_PACK_SKIP:
+                led += count;
+                break;
+
+            case HALO_PACK_RUN:
+            {
+                Color color = { pack[offset], pack[offset + 1], pack[offset + 2] };
+                offset += 3;
+                cycles += 3 * CYCLES_PER_BYTE + count * CYCLES_PER_LED;
+                for (; count > 0; count--)
+                {
+                    leds[led++] = color;
+                }
+                break;
+            }
+
+            case HALO_PACK_LITERAL:
+                cycles += count * (3 * CYCLES_PER_BYTE + CYCLES_PER_LED);
+                for (; count > 0; count--)
+                {
+                    leds[led++] = Color{ pack[offset], pack[offset + 1], pack[offset + 2] };
+                    offset += 3;
+                }
+                break;
+
+            default:
+                hold = count;
+                break;
+            }
+        }
+
+        packFrames++;
+        cyclesTotal += cycles;
+        if (cycles > cyclesMax)
+        {
+            cyclesMax = cycles;
+        }
+
+        if ((keyframe >= keyframes.size()) || (leds != keyframes[keyframe].Leds))
+        {
+            fprintf(stderr, "pack frame %u does not match keyframe %u\n", packFrames, (unsigned)keyframe + 1);
+            return false;
+        }
+        shown += hold;
+        if (shown == keyframes[keyframe].Ticks)
+        {
+            keyframe++;
+            shown = 0;
+        }
+    }
+
+    if (keyframe != keyframes.size())
+    {
+        fprintf(stderr, "pack ends after %u of %u keyframes\n", (unsigned)keyframe, (unsigned)keyframes.size());
+        return false;
+    }
+    return true;
+}
+
+static bool writePack(const char* path, const char* arrayName, const std::vector<uint8_t>& pack)
+{
+    FILE* file = fopen(path, (nullptr != arrayName) ? "w" : "wb");
+    if (nullptr == file)
+    {
+        fprintf(stderr, "%s: cannot create\n", path);
+        return false;
+    }
+
+    if (nullptr != arrayName)
+    {
+        fprintf(file, "// HaloPack::Load(%s, sizeof(%s))\n", arrayName, arrayName);
+        fprintf(file, "const uint8_t %s[%u] = {", arrayName, (unsigned)pack.size());
+        for (size_t i = 0; i < pack.size(); i++)
+        {
+            fprintf(file, "%s%s0x%02X", (0 == i) ? "" : ",", (0 == i % 16) ? "\n    " : " ", pack[i]);
+        }
+        fprintf(file, "\n};\n");
+    }
+    else
+    {
+        fwrite(pack.data(), 1, pack.size(), file);
+    }
+
+    bool ok = (0 == ferror(file));
+    fclose(file);
+    if (!ok)
+    {
+        fprintf(stderr, "%s: write failed\n", path);
+    }
+    return ok;
+}
+
+// Split the pack into STORE_PACK messages: command, slot, offset, length and up to HALO_PACK_PART_MAX bytes,
+// then the empty part that finishes the pack.
+static void packMessages(const std::vector<uint8_t>& pack, uint8_t slot, std::vector<uint8_t>& messages)
+{
+    size_t offset = 0;
+    for (;;)
+    {
+        size_t part = pack.size() - offset;
+        part = (part < HALO_PACK_PART_MAX) ? part : HALO_PACK_PART_MAX;
+        messages.push_back(COMMAND_STORE_PACK);
+        messages.push_back(slot);
+        messages.push_back((uint8_t)(offset >> 8));
+        messages.push_back((uint8_t)offset);
+        messages.push_back((uint8_t)part);
+        messages.insert(messages.end(), pack.begin() + offset, pack.begin() + offset + part);
+        if (0 == part)
+        {
+            break;
+        }
+        offset += part;
+    }
+}
+
+static int usage()
+{
+    fprintf(stderr, "usage: halopack [-l leds] [-c name | -m [-s slot]] animation.csv output\n");
+    fprintf(stderr, "  -l leds   LEDs in the halo, default %u\n", DEFAULT_LED_COUNT);
+    fprintf(stderr, "  -c name   write a C array called name instead of the raw pack\n");
+    fprintf(stderr, "  -m        write the STORE_PACK messages that load the pack over bluetooth\n");
+    fprintf(stderr, "  -s slot   pack store slot for -m, 0 - %u, default 0\n", HALO_PACK_SLOTS - 1);
+    return 2;
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+int main(int argc, char** argv)
+{
+    unsigned ledCount = DEFAULT_LED_COUNT;
+    const char* arrayName = nullptr;
+    bool messages = false;
+    unsigned slot = 0;
+    bool slotGiven = false;
+    const char* paths[2] = { nullptr, nullptr };
+    unsigned pathCount = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((0 == strcmp(argv[i], "-l")) && (i + 1 < argc))
+        {
+            ledCount = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if ((0 == strcmp(argv[i], "-c")) && (i + 1 < argc))
+        {
+            arrayName = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], "-m"))
+        {
+            messages = true;
+        }
+        else if ((0 == strcmp(argv[i], "-s")) && (i + 1 < argc))
+        {
+            slot = (unsigned)strtoul(argv[++i], nullptr, 10);
+            slotGiven = true;
+        }
+        else if (('-' != argv[i][0]) && (pathCount < 2))
+        {
+            paths[pathCount++] = argv[i];
+        }
+        else
+        {
+            return usage();
+        }
+    }
+    if ((2 != pathCount) || (0 == ledCount) || (ledCount > 0xFF) || (messages && (nullptr != arrayName))
+        || (slot >= HALO_PACK_SLOTS) || (slotGiven && !messages))
+    {
+        return usage();
+    }
+
+    std::vector<Keyframe> keyframes;
+    if (!readKeyframes(paths[0], ledCount, keyframes))
+    {
+        return 1;
+    }
+
+    std::vector<uint8_t> pack;
+    pack.push_back((uint8_t)ledCount);
+    std::vector<Color> previous(ledCount, Color{ 0, 0, 0 });
+    unsigned ticks = 0;
+    for (const Keyframe& keyframe : keyframes)
+    {
+        encodeFrame(previous, keyframe, pack);
+        previous = keyframe.Leds;
+        ticks += keyframe.Ticks;
+    }
+
+    unsigned cyclesTotal;
+    unsigned cyclesMax;
+    unsigned packFrames;
+    if (!verifyPack(pack, keyframes, cyclesTotal, cyclesMax, packFrames))
+    {
+        return 1;
+    }
+    if (messages)
+    {
+        if (pack.size() > PACK_BUDGET)
+        {
+            // alone in the store. Whether it fits next to the packs already in the other slots
+            // is up to the target, which rejects the part that runs over.
+            fprintf(stderr, "%u bytes do not fit the %u byte pack store\n", (unsigned)pack.size(), PACK_BUDGET);
+            return 1;
+        }
+        std::vector<uint8_t> bytes;
+        packMessages(pack, (uint8_t)slot, bytes);
+        if (!writePack(paths[1], nullptr, bytes))
+        {
+            return 1;
+        }
+    }
+    else if (!writePack(paths[1], arrayName, pack))
+    {
+        return 1;
+    }
+
+    // uncompressed: every LED of every keyframe, and a tick count
+    size_t rawSize = keyframes.size() * (ledCount * 3 + 1);
+    printf("keyframes:          %u (%u frame ticks)\n", (unsigned)keyframes.size(), ticks);
+    printf("uncompressed:       %u bytes\n", (unsigned)rawSize);
+    printf("pack:               %u bytes\n", (unsigned)pack.size());
+    printf("compression ratio:  %.2f:1\n", (double)rawSize / pack.size());
+    printf("EEPROM budget:      %.1f%% of %u bytes\n", 100.0 * pack.size() / PACK_BUDGET, PACK_BUDGET);
+    printf("decode cycles/frame: %u average, %u worst (estimate)\n", cyclesTotal / packFrames, cyclesMax);
+    return 0;
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
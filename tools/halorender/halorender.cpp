@@ -0,0 +1,2028 @@
+/**
+* @brief      Host renderer for halo patterns
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Runs the real halo code on the PC and shows what the halo would display, without flashing hardware.
+*               The halo modules are built against tools/halorender/msp430.h, whose P3OUT, P4IN and P6OUT report
+*               every access here. The SIN/SCLK/LAT toggles go through a model of the TLC5957 chain (common shift
+*               register, WRTGS/LATGS/WRTFC/READFC/FCWRTEN latch commands, conventional and poker trans modes,
+*               GS data on one or both SCLK edges), and the GS values it latches are written as one image row per frame.
+*
+*               Build on the PC, from the repository root:
+*                   g++ -std=c++14 -O2 -Itools/halorender -I. -o halorender tools/halorender/halorender.cpp
+*                       HaloPattern.cpp HaloFramebuffer.cpp HaloGamma.cpp HaloColorWheel.cpp HaloCompositor.cpp
+*                       HaloVM.cpp HaloPack.cpp HaloEffect.cpp TimeBase.cpp HaloStream.cpp Bluetooth.cpp HaloFlush.cpp
+*                       Commands.cpp
+*               Add -DHALO_SPI_TRANSPORT and HaloSPI.cpp to build the eUSCI_B1 transport instead of the bit-banged one.
+*               Run:
+*                   halorender [-p pattern] [-n frames] [-s size] [-S seed] [-q] strip.ppm
+*                   halorender -b [-S seed]
+*                   halorender -t
+*                   halorender -l baud
+*
+*               Every frame reports the SCLK rising edges and port writes it took, and the port access cycles
+*               they cost the MSP430. The port writes are exact for the bit-banged transport, so a change in them
+*               is a change in halo render cost.
+*
+*               -b benchmarks the HaloEffect effects instead: each one runs for BENCH_FRAMES frame ticks, every frame
+*               is costed from the work HaloEffect counted for it, and the worst frame has to fit the effect's budget.
+*               It exits with 1 when one does not, so it can gate a build. Like the halopack cost model, the
+*               per-operation cycle counts are estimates, to be checked against "Halo effect max us" on the target.
+*               It then sends one frame to chains of 1 - 8 TLC5957s through the transport of the build, checks each
+*               chain latched it, and prints the transfer time and the frame rate that leaves no time for anything else.
+*               Last it plays the blue chase as BlueCW() and as the same pattern in HaloVM slot 0, checks they show the
+*               same frames, and compares their cost per frame: render cycles from the VM and compositor work counters,
+*               port cycles from the model. The color wheel fills are costed the same way, from the HsvToRgb() and
+*               HeatColor() kernels per LED and the compositor work of putting their layer on the halo.
+*               Then it plays the blue chase at HALO_FPS_MAX on a modelled MCLK the way Loop() does, once with the frames
+*               sent in the foreground and once from the CCR2 interrupt (HaloFlush), and prints the longest Loop() pass
+*               of each, which is what main.cpp reports as "Loop stall max us".
+*               It also prints the HaloGamma cost of a composed frame at every brightness.
+*
+*               -t runs the host tests against the TLC5957 model and exits with 1 if one fails. With HALO_SPI_TRANSPORT
+*               it checks that HaloSPI clocks exactly the SIN/LAT sequence bitBang16bits() does for every latch command.
+*               It also sends one frame with bitBang16bits() and with doubleEdge16bits() (SEL_SCK_EDGE) and reports
+*               the port writes of each, so the saving of HALO_DOUBLE_EDGE_SCLK is measured rather than assumed.
+*               The background flush test sends a frame with GIE set and delivers its interrupts one at a time.
+*               The read back tests clock the FC register (READFC) and the LED open detection result out of SOUT.
+*               The gamma test checks ToGS() against pow(x, 2.2) in floating point for every level, brightness and
+*               PWM depth, and that no lit level truncates to black in 9-bit poker mode.
+*               The fade test plays HaloVM FadeTo over 1 - 255 frames and checks every frame against the straight line.
+*               The hit flash test renders a flash at frame rates from 1 to 200 a second on a host FRAME_TIMER and
+*               checks that it fades by the time that has passed, not by the number of frames.
+*               The pack store test fills slots of the FRAM pack store, replaces the pack in the middle with a longer
+*               one and then with one too long for it, and checks every slot still plays its own pack.
+*               The stream loopback feeds STREAM_FRAME messages from a phone model into USCI0RX_ISR() one byte at a
+*               time, at the pace of a 9600 baud link with delivery jitter, parses them with the firmware's
+*               processCommands() (Commands.cpp), and checks every tick of HaloStream. A second run stalls the main loop
+*               long enough to overflow the bluetooth RX ring, and checks no part of a cut message runs as a command.
+*               -l runs the stream loopback alone at another baud rate.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "LaserTarget.h"
+#include "TLC5957.h"
+#include "HaloPattern.h"
+#include "HaloFramebuffer.h"
+#include "HaloGamma.h"
+#include "HaloCompositor.h"
+#include "HaloVM.h"
+#include "HaloPack.h"
+#include "HaloEffect.h"
+#include "TimeBase.h"
+#include "HaloStream.h"
+#include "Bluetooth.h"
+#include "HaloFlush.h"
+#ifdef HALO_SPI_TRANSPORT
+#include "HaloSPI.h"
+#endif
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// Port access cost model, MCLK cycles.
+// BIS.B / BIC.B / XOR.B #imm, &PxOUT and MOV.B &PxIN, Rn on the MSP430FR2355 CPUX.
+#define CYCLES_PER_PORT_WRITE 5
+#define CYCLES_PER_PORT_READ 3
+// MCLK on the target (main.cpp Setup())
+#define MCLK_MHZ 16
+// eUSCI_B1 SCLK for the SPI transport, UCB1BRW = 1 from SMCLK
+#define SPI_SCLK_MHZ 2
+// longest chain the model takes. halorender -b measures chains of 1 - 8 chips.
+#define CHAIN_CHIPS_MAX ((HALO_CHIP_COUNT > 8) ? HALO_CHIP_COUNT : 8)
+
+// HaloEffect::RenderFrame() cost model, MCLK cycles. Rough figures for the code built with optimization on.
+// fixed cost of a call: timer reads, tick loop, budget check
+#define CYCLES_PER_EFFECT_CALL 60
+// step dispatch and position update
+#define CYCLES_PER_EFFECT_STEP 30
+// one LED level: load, Scale8() on the hardware multiplier, store
+#define CYCLES_PER_EFFECT_LEVEL 20
+// one xorshift16 number, the 7 and 9 bit shifts take several RLAM/RRUM each
+#define CYCLES_PER_EFFECT_RANDOM 30
+// one LED drawn: three Scale8(), HaloLayer::SetPixel() with its mask update
+#define CYCLES_PER_EFFECT_PIXEL 110
+// Frame render cost model for the pattern comparison, MCLK cycles
+// fixed cost of a pattern call
+#define CYCLES_PER_PATTERN_CALL 40
+// one HaloVM opcode: fetch, dispatch, operand fetches
+#define CYCLES_PER_VM_OP 40
+// one LED drawn into a layer: three byte stores and the mask bit
+#define CYCLES_PER_LAYER_PIXEL 25
+// one LED through HaloCompositor::Render(): the layer walk, the gamma lookups, the framebuffer write
+#define CYCLES_PER_COMPOSED_LED 150
+// one HsvToRgb(): the sector split and five Scale8() on the hardware multiplier
+#define CYCLES_PER_HSV 90
+// one HeatColor(): the ramp split and a switch
+#define CYCLES_PER_HEAT 20
+// one HaloGamma::ToGS() call at full brightness: call, table load, round to the PWM depth, lit check
+#define CYCLES_PER_GAMMA_CALL 30
+// each bit of the brightness shift, a variable shift is a RRUM #1 loop
+#define CYCLES_PER_GAMMA_SHIFT 3
+// one channel bit packed by BuildStream() in poker trans mode, and one word laid out in the conventional mode
+#define CYCLES_PER_STREAM_BIT 6
+#define CYCLES_PER_STREAM_WORD 8
+// MCLK cycles per FRAME_TIMER tick: the timer counts 1us, MCLK is 16MHz
+#define MCLK_CYCLES_PER_TICK MCLK_MHZ
+// Loop() stall model, MCLK cycles.
+// a pass that renders nothing: the debounce flag, the bluetooth check, the LED_State check
+#define CYCLES_PER_LOOP_PASS 40
+// a CCR2 interrupt besides its port writes: entry and exit, TB0IV dispatch, the chunk loop, Schedule()
+#define CYCLES_PER_FLUSH_INTERRUPT 60
+// frames the loop stall benchmark renders, at HALO_FPS_MAX
+#define STALL_FRAMES 64
+// frame ticks each effect runs for in the benchmark
+#define BENCH_FRAMES 1024
+
+// Stream loopback: the bluetooth UART rate of Bluetooth::Init(), how long the phone streams for,
+// how often it sends a keyframe, the most a frame is held up on the link, and the main loop period
+#define STREAM_BAUD 9600
+#define STREAM_TEST_SECONDS 20
+#define STREAM_KEYFRAME_INTERVAL 16
+#define STREAM_JITTER_US 40000
+#define LOOP_PERIOD_US 2000
+
+// bits in the common shift register of one TLC5957
+#define SHIFT_BITS 48
+#define SHIFT_MASK ((1ULL << SHIFT_BITS) - 1)
+
+// SCLK rising edges with LAT high that select each latch command
+#define COMMAND_WRTGS 1
+#define COMMAND_LATGS 3
+#define COMMAND_WRTFC 5
+#define COMMAND_READFC 11
+#define COMMAND_FCWRTEN 15
+
+// P6 pin that switches the halo on
+#define HALO_ENABLE BIT0
+
+// Capture entries: one per SCLK rising edge with the SIN and LAT levels, and one per LAT falling edge
+#define CAPTURE_SIN 0x01
+#define CAPTURE_LAT 0x02
+#define CAPTURE_LATCH 0x04
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// Port traffic of one frame
+struct FrameCost
+{
+    unsigned Edges;
+    unsigned Writes;
+    unsigned Reads;
+    // bits the eUSCI shifted out on its own
+    unsigned Shifted;
+
+    unsigned Cycles() const
+    {
+        return Writes * CYCLES_PER_PORT_WRITE + Reads * CYCLES_PER_PORT_READ;
+    }
+
+    // @return unsigned: transfer time on the target. The CPU waits for the eUSCI, so the two add up.
+    unsigned Micros() const
+    {
+        return (Cycles() + MCLK_MHZ - 1) / MCLK_MHZ + (Shifted + SPI_SCLK_MHZ - 1) / SPI_SCLK_MHZ;
+    }
+};
+
+// An effect with the arguments it is rendered and benchmarked with
+struct EffectSetup
+{
+    const char* Name;
+    HaloEffectId Id;
+    HaloRGB Color;
+    uint8_t Speed;
+    uint8_t Param;
+};
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+// The TLC5957 chain, as far as the halo code can see it: SIN, SCLK and LAT in, SOUT out
+class TLC5957Model
+{
+    // common shift registers, chip 0 is the one wired to the MCU
+    uint64_t shift[CHAIN_CHIPS_MAX];
+    uint64_t fc[CHAIN_CHIPS_MAX];
+    // GS data latch 1 (being written) and 2 (displayed), indexed [chip][output * 3 + color]
+    uint16_t latched[CHAIN_CHIPS_MAX][SHIFT_BITS];
+    uint16_t shown[CHAIN_CHIPS_MAX][SHIFT_BITS];
+    // outputs with no LED on them, one bit per channel in the same order as the common shift register
+    uint64_t open[CHAIN_CHIPS_MAX];
+
+    // SCLK rising edges since LAT went high
+    unsigned latchEdges;
+    // output written by the next WRTGS in the conventional trans mode, bit-plane in poker trans mode
+    unsigned group;
+    // true from FCWRTEN until WRTFC. FC data only shifts at the rising edge of SCLK.
+    bool fcWriteEnabled;
+    // chips in the chain
+    unsigned chips;
+
+    bool poker() const
+    {
+        // FC bit 44, the same in every chip
+        return 0 != ((fc[0] >> 32) & MASK_POKER_TRANS_MODE);
+    }
+
+    bool doubleEdge() const
+    {
+        // FC bit 10, the same in every chip
+        return 0 != (fc[0] & MASK_SEL_SCK_EDGE);
+    }
+
+    // LATGS loads the LED open detection result into the common shift register.
+    // Only outputs that are on are checked.
+    void loadOpenDetect()
+    {
+        for (unsigned chip = 0; chip < chips; chip++)
+        {
+            uint64_t lod = 0;
+            for (unsigned channel = 0; channel < SHIFT_BITS; channel++)
+            {
+                if ((0 != shown[chip][channel]) && ((open[chip] >> channel) & 1))
+                {
+                    lod |= 1ULL << channel;
+                }
+            }
+            shift[chip] = lod;
+        }
+    }
+
+    void shiftIn(bool sin)
+    {
+        for (unsigned chip = chips; chip-- > 0;)
+        {
+            bool in = (0 == chip) ? sin : (0 != ((shift[chip - 1] >> (SHIFT_BITS - 1)) & 1));
+            shift[chip] = ((shift[chip] << 1) | (in ? 1 : 0)) & SHIFT_MASK;
+        }
+    }
+
+    void writeGroup()
+    {
+        for (unsigned chip = 0; chip < chips; chip++)
+        {
+            uint64_t bits = shift[chip];
+            if (poker())
+            {
+                // one bit-plane of every channel, MSB plane first. Planes that are never sent read as 0.
+                uint16_t bit = (uint16_t)(0x8000 >> (group & 0x0F));
+                for (unsigned channel = 0; channel < SHIFT_BITS; channel++)
+                {
+                    if (0 == group)
+                    {
+                        latched[chip][channel] = 0;
+                    }
+                    if ((bits >> channel) & 1)
+                    {
+                        latched[chip][channel] |= bit;
+                    }
+                }
+            }
+            else
+            {
+                // one output: Blue, Green, Red from the top of the register, the last output first
+                unsigned output = (TLC5957_OUTPUT_COUNT - 1 - group) & 0x0F;
+                latched[chip][output * RGB_CHANNEL_COUNT + (uint8_t)HaloColor::Blue] = (uint16_t)(bits >> 32);
+                latched[chip][output * RGB_CHANNEL_COUNT + (uint8_t)HaloColor::Green] = (uint16_t)(bits >> 16);
+                latched[chip][output * RGB_CHANNEL_COUNT + (uint8_t)HaloColor::Red] = (uint16_t)bits;
+            }
+        }
+        group++;
+    }
+
+public:
+    // latch commands seen that are not modelled
+    unsigned UnknownCommands;
+    // LATGS commands seen
+    unsigned Frames;
+
+    TLC5957Model() : shift(), fc(), latched(), shown(), open(), latchEdges(0), group(0), fcWriteEnabled(false),
+        chips(HALO_CHIP_COUNT), UnknownCommands(0), Frames(0)
+    {
+    }
+
+    // Change the length of the chain. Every chip gets the FC register of the first one.
+    // @param count: 1 - CHAIN_CHIPS_MAX
+    void SetChips(unsigned count)
+    {
+        chips = count;
+        for (unsigned chip = 1; chip < count; chip++)
+        {
+            fc[chip] = fc[0];
+        }
+        memset(shift, 0, sizeof(shift));
+        group = 0;
+    }
+
+    void RisingEdge(bool sin, bool lat)
+    {
+        if (lat)
+        {
+            latchEdges++;
+        }
+        shiftIn(sin);
+    }
+
+    // Latch commands are only counted on rising edges, so LAT does not matter here
+    void FallingEdge(bool sin)
+    {
+        if (doubleEdge() && !fcWriteEnabled)
+        {
+            shiftIn(sin);
+        }
+    }
+
+    // Take an LED off its output, for the open detection
+    void SetOpen(uint8_t led, HaloColor color)
+    {
+        unsigned channel = (led % HALO_LEDS_PER_CHIP) * RGB_CHANNEL_COUNT + (uint8_t)color;
+        open[led / HALO_LEDS_PER_CHIP] |= 1ULL << channel;
+    }
+
+    // Flip one FC bit in the last chip of the chain, as a bad write would
+    void CorruptFC(unsigned bit)
+    {
+        fc[chips - 1] ^= 1ULL << bit;
+    }
+
+    // Set SEL_SCK_EDGE in every chip without a WRTFC, to compare the two shift modes on the same FC settings
+    void SetDoubleEdge(bool enabled)
+    {
+        for (unsigned chip = 0; chip < chips; chip++)
+        {
+            fc[chip] = enabled ? (fc[chip] | MASK_SEL_SCK_EDGE) : (fc[chip] & ~(uint64_t)MASK_SEL_SCK_EDGE);
+        }
+    }
+
+    void LatchFalling()
+    {
+        switch (latchEdges)
+        {
+        case COMMAND_WRTGS:
+            writeGroup();
+            break;
+
+        case COMMAND_LATGS:
+            writeGroup();
+            memcpy(shown, latched, sizeof(shown));
+            loadOpenDetect();
+            group = 0;
+            Frames++;
+            break;
+
+        case COMMAND_WRTFC:
+            memcpy(fc, shift, sizeof(fc));
+            fcWriteEnabled = false;
+            break;
+
+        case COMMAND_READFC:
+            memcpy(shift, fc, sizeof(shift));
+            break;
+
+        case COMMAND_FCWRTEN:
+            // WRTFC is always let through, the model does not check it was enabled
+            fcWriteEnabled = true;
+            break;
+
+        default:
+            UnknownCommands++;
+            break;
+        }
+        latchEdges = 0;
+    }
+
+    // @return bool: SOUT of the last chip in the chain
+    bool Sout() const
+    {
+        return 0 != ((shift[chips - 1] >> (SHIFT_BITS - 1)) & 1);
+    }
+
+    // @return uint16_t: the displayed GS value of one LED color, counted along the whole chain
+    uint16_t Shown(uint8_t led, HaloColor color) const
+    {
+        return shown[led / HALO_LEDS_PER_CHIP][(led % HALO_LEDS_PER_CHIP) * RGB_CHANNEL_COUNT + (uint8_t)color];
+    }
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+// bit-banged transports, HaloPattern.cpp
+void bitBang16bits(uint16_t data, uint8_t latchBits);
+void doubleEdge16bits(uint16_t data, uint8_t latchBits);
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+HostPort P3OUT;
+HostPort P4OUT;
+HostPort P4IN;
+HostPort P6OUT;
+HostTxBuf UCB1TXBUF;
+
+volatile uint8_t P2OUT;
+volatile uint8_t P3DIR;
+volatile uint8_t P4DIR;
+volatile uint8_t P4SEL0;
+volatile uint8_t P4SEL1;
+volatile uint8_t P6DIR;
+volatile uint16_t SYSCFG0;
+volatile uint16_t PM5CTL0;
+volatile uint16_t TB0CTL;
+volatile uint16_t TB0R;
+volatile uint16_t TB0CCTL1;
+volatile uint16_t TB0CCTL2;
+volatile uint16_t TB0CCR1;
+volatile uint16_t TB0CCR2;
+volatile uint16_t UCB1CTLW0;
+volatile uint16_t UCB1BRW;
+volatile uint16_t UCB1STATW;
+volatile uint16_t UCB1IE;
+volatile uint16_t UCB1IFG = UCTXIFG;
+volatile uint16_t UCB1IV;
+// GIE clear: HaloFlush sends in the foreground unless a test turns interrupts on
+volatile uint16_t HostSR = 0;
+volatile uint8_t P1SEL0;
+volatile uint8_t P1SEL1;
+volatile uint8_t P1DIR;
+volatile uint8_t P1REN;
+volatile uint8_t P1IES;
+volatile uint16_t UCA0CTLW0;
+volatile uint16_t UCA0BRW;
+volatile uint16_t UCA0MCTLW;
+HostUartIE UCA0IE;
+volatile uint16_t UCA0IFG;
+volatile uint16_t UCA0IV;
+volatile uint8_t UCA0RXBUF_L;
+HostUartTxBuf UCA0TXBUF;
+
+static TLC5957Model Chain;
+static FrameCost Cost;
+// when set, every SCLK rising edge and LAT falling edge the chain sees is appended here
+static std::vector<uint8_t>* Capture;
+// what the firmware sent back over bluetooth
+static std::string Replies;
+
+// black draws the color wheel
+static const EffectSetup effects[] = {
+    { "comet", HaloEffectId::Comet, { 0, 0, 0 }, 1, 160 },
+    { "breathe", HaloEffectId::Breathe, { 0, 0, 255 }, 1, 16 },
+    { "sparkle", HaloEffectId::Sparkle, { 255, 255, 255 }, 1, 96 },
+    { "wipe", HaloEffectId::Wipe, { 0, 0, 0 }, 2, 0 }
+};
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+// One SCLK rising edge, from whichever pins are clocking the chain. LAT is always P3.7.
+static void risingEdge(bool sin)
+{
+    bool lat = 0 != (HALO_DATA_OUT.Latch() & HALO_LATCH_LED);
+    Cost.Edges++;
+    if (nullptr != Capture)
+    {
+        Capture->push_back((sin ? CAPTURE_SIN : 0) | (lat ? CAPTURE_LAT : 0));
+    }
+    Chain.RisingEdge(sin, lat);
+}
+
+void HostPortWritten(const HostPort& port, uint8_t before)
+{
+    Cost.Writes++;
+    uint8_t pins = port.Latch();
+
+    if (&port == &HALO_DATA_OUT)
+    {
+        if ((pins & HALO_CLK_SIG) && !(before & HALO_CLK_SIG))
+        {
+            risingEdge(0 != (pins & HALO_DATA_LED));
+        }
+        if (!(pins & HALO_CLK_SIG) && (before & HALO_CLK_SIG))
+        {
+            Chain.FallingEdge(0 != (pins & HALO_DATA_LED));
+        }
+        if (!(pins & HALO_LATCH_LED) && (before & HALO_LATCH_LED))
+        {
+            if (nullptr != Capture)
+            {
+                Capture->push_back(CAPTURE_LATCH);
+            }
+            Chain.LatchFalling();
+        }
+    }
+    else if ((&port == &HALO_SPI_OUT) && !(HALO_SPI_SEL0 & HALO_SPI_CLK))
+    {
+        // the eUSCI pins handed back to GPIO (HaloSPI::SendBits)
+        if ((pins & HALO_SPI_CLK) && !(before & HALO_SPI_CLK))
+        {
+            risingEdge(0 != (pins & HALO_SPI_SIMO));
+        }
+        if (!(pins & HALO_SPI_CLK) && (before & HALO_SPI_CLK))
+        {
+            Chain.FallingEdge(0 != (pins & HALO_SPI_SIMO));
+        }
+    }
+}
+
+void HostTxWritten(uint8_t data)
+{
+    Cost.Writes++;
+    if ((UCB1CTLW0 & UCSWRST) || !(HALO_SPI_SEL0 & HALO_SPI_CLK))
+    {
+        // the eUSCI is held in reset or does not own SCLK
+        return;
+    }
+    // MSB first, one rising edge per bit (UCCKPH)
+    Cost.Shifted += 8;
+    for (uint8_t mask = 0x80; 0 != mask; mask >>= 1)
+    {
+        risingEdge(0 != (data & mask));
+    }
+}
+
+void HostUartTxEnabled()
+{
+    uint16_t vector = UCA0IV;
+    while (0 != (UCA0IE & UCTXIE))
+    {
+        UCA0IV = 4;
+        USCI0RX_ISR();
+    }
+    UCA0IV = vector;
+}
+
+void HostUartWritten(uint8_t data)
+{
+    Replies.push_back((char)data);
+}
+
+// processCommands() starts the animation over when a command changes it. The loopback only streams.
+void restartAnimation(void)
+{
+}
+
+uint8_t HostPortRead(const HostPort& port)
+{
+    Cost.Reads++;
+    if (&port == &HALO_SOUT_IN)
+    {
+        return Chain.Sout() ? HALO_SOUT : 0;
+    }
+    return port.Latch();
+}
+
+// @return uint8_t: a GS value as an 8-bit sRGB level, so the image looks like the LEDs do
+static uint8_t toPixel(uint16_t gs)
+{
+    return (uint8_t)lround(255.0 * pow(gs / 65535.0, 1.0 / 2.2));
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& data)
+{
+    FILE* file = fopen(path, "rb");
+    if (nullptr == file)
+    {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t read;
+    while (0 != (read = fread(buffer, 1, sizeof(buffer), file)))
+    {
+        data.insert(data.end(), buffer, buffer + read);
+    }
+    fclose(file);
+    return true;
+}
+
+// @return const EffectSetup*: the effect with this name, nullptr if there is none
+static const EffectSetup* findEffect(const char* name)
+{
+    for (const EffectSetup& setup : effects)
+    {
+        if (0 == strcmp(name, setup.Name))
+        {
+            return &setup;
+        }
+    }
+    return nullptr;
+}
+
+// @return unsigned: modelled MCLK cycles of the last HaloEffect::RenderFrame()
+static unsigned effectCycles()
+{
+    const HaloEffectWork& work = HaloEffect::Work;
+    return CYCLES_PER_EFFECT_CALL + work.Steps * CYCLES_PER_EFFECT_STEP + work.Levels * CYCLES_PER_EFFECT_LEVEL
+        + work.Randoms * CYCLES_PER_EFFECT_RANDOM + work.Pixels * CYCLES_PER_EFFECT_PIXEL;
+}
+
+// Run every effect and check its worst frame against its budget.
+// @return bool: true if every effect fits its budget
+static bool benchEffects(uint16_t seed)
+{
+    bool result = true;
+    printf("effect   avg us  worst us  budget us\n");
+    for (const EffectSetup& setup : effects)
+    {
+        HaloEffect::Seed(seed);
+        HaloEffect::Start(setup.Id, setup.Color, setup.Speed, setup.Param);
+
+        unsigned total = 0;
+        unsigned worst = 0;
+        for (unsigned frame = 0; frame < BENCH_FRAMES; frame++)
+        {
+            HaloEffect::RenderFrame(1);
+            unsigned cycles = effectCycles();
+            total += cycles;
+            if (cycles > worst)
+            {
+                worst = cycles;
+            }
+        }
+
+        unsigned budget = HaloEffect::Budget(setup.Id);
+        unsigned worstTicks = (worst + MCLK_CYCLES_PER_TICK - 1) / MCLK_CYCLES_PER_TICK;
+        bool fits = worstTicks <= budget;
+        printf("%-7s  %6u  %8u  %9u%s\n", setup.Name, total / BENCH_FRAMES / MCLK_CYCLES_PER_TICK, worstTicks, budget,
+            fits ? "" : "  OVER BUDGET");
+        if (!fits)
+        {
+            result = false;
+        }
+    }
+    HaloEffect::Stop();
+    return result;
+}
+
+#ifdef HALO_SPI_TRANSPORT
+// Check that HaloSPI::Send16() feeds the chain exactly what bitBang16bits() does, for plain words
+// and for every latch command, including those that overlap the byte the eUSCI sends.
+// @return bool: true if every capture matches
+static bool testTransport()
+{
+    static const uint16_t words[] = { 0x0000, 0xFFFF, 0xA55A, 0x8001, 0x1234, 0xFE7F };
+    static const uint8_t latches[] = { 0, COMMAND_WRTGS, COMMAND_LATGS, COMMAND_WRTFC, 8, 9, COMMAND_READFC, COMMAND_FCWRTEN, 16 };
+
+    HaloSPI::Init();
+    unsigned mismatches = 0;
+    for (uint16_t word : words)
+    {
+        for (uint8_t latch : latches)
+        {
+            std::vector<uint8_t> spi;
+            std::vector<uint8_t> bitBang;
+            Capture = &spi;
+            HaloSPI::Send16(word, latch);
+            Capture = &bitBang;
+            bitBang16bits(word, latch);
+            Capture = nullptr;
+
+            if (spi != bitBang)
+            {
+                printf("transport: 0x%04X with %u latch clocks differs from the bit-banged transport\n", word, latch);
+                mismatches++;
+            }
+        }
+    }
+    printf("transport: SPI against bit-bang, %u captures: %s\n", (unsigned)(sizeof(words) / sizeof(words[0]) * sizeof(latches)),
+        (0 == mismatches) ? "ok" : "FAIL");
+    return 0 == mismatches;
+}
+#else
+static bool testTransport()
+{
+    printf("transport: skipped, build with -DHALO_SPI_TRANSPORT and HaloSPI.cpp to check the SPI transport\n");
+    return true;
+}
+#endif
+
+// Fill the framebuffer with GS values of every level
+static void randomFrame()
+{
+    uint16_t value = 0xACE1;
+    for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+    {
+        for (uint8_t c = 0; c < RGB_CHANNEL_COUNT; c++)
+        {
+            // xorshift16
+            value ^= value << 7;
+            value ^= value >> 9;
+            value ^= value << 8;
+            HaloFrame.SetChannel(led, (HaloColor)c, value);
+        }
+    }
+}
+
+// @return unsigned: GS values the chain does not show the way the framebuffer holds them,
+// cut down to the poker trans mode PWM depth
+static unsigned wrongLatches()
+{
+    uint8_t pokerBits = HaloFrame.GetPokerBits();
+    uint16_t mask = (0 == pokerBits) ? 0xFFFF : (uint16_t)(0xFFFF << (16 - pokerBits));
+    unsigned wrong = 0;
+    for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+    {
+        for (uint8_t c = 0; c < RGB_CHANNEL_COUNT; c++)
+        {
+            if (Chain.Shown(led, (HaloColor)c) != (HaloFrame.GetChannel(led, (HaloColor)c) & mask))
+            {
+                wrong++;
+            }
+        }
+    }
+    return wrong;
+}
+
+// Send one frame of every level through the transport of this build and check the chain latched it,
+// cut down to the poker trans mode PWM depth.
+// @return bool: true if the FC register read back and every GS value arrived
+static bool testFrame()
+{
+    Chain = TLC5957Model();
+    bool pass = InitLEDController();
+    if (!pass)
+    {
+        printf("frame: FC register read back: MISMATCH\n");
+    }
+
+    randomFrame();
+    HaloFrame.Flush();
+
+    unsigned wrong = wrongLatches();
+    if (0 != wrong)
+    {
+        printf("frame: %u of %u GS values latched wrong\n", wrong, (unsigned)(RGB_LED_COUNT * RGB_CHANNEL_COUNT));
+        pass = false;
+    }
+    printf("frame: %u LEDs, poker %u bits: %s\n", (unsigned)RGB_LED_COUNT, HaloFrame.GetPokerBits(), pass ? "ok" : "FAIL");
+    return pass;
+}
+
+// Deliver the next interrupt a background frame is waiting for: the eUSCI_B1 TX interrupt, or else TB0 CCR2.
+// @return bool: false when neither is enabled
+static bool deliverFlushInterrupt()
+{
+#ifdef HALO_SPI_TRANSPORT
+    if (0 != (UCB1IE & UCTXIE))
+    {
+        UCB1IV = 4;
+        USCI_B1_ISR();
+        return true;
+    }
+#endif
+    if (0 != (TB0CCTL2 & CCIE))
+    {
+        HaloFlush::Tick();
+        return true;
+    }
+    return false;
+}
+
+// Send a frame with interrupts on, delivering its interrupts one by one, and check the chain latched it
+// and the halo was only turned back on at the end.
+// @return bool: true if Flush() returned before the frame went out and every GS value arrived
+static bool testBackgroundFlush()
+{
+    Chain = TLC5957Model();
+    InitLEDController();
+    randomFrame();
+
+    HostSR = GIE;
+    HaloFrame.Flush();
+    bool background = HaloFrame.Busy() && (0 == (P6OUT.Latch() & BIT0));
+    unsigned interrupts = 0;
+    while (HaloFrame.Busy() && deliverFlushInterrupt())
+    {
+        interrupts++;
+    }
+    HostSR = 0;
+    if (HaloFrame.Busy())
+    {
+        // nothing would ever finish the frame, and the next HaloFlush::Wait() would hang
+        printf("background flush: stuck after %u interrupts: FAIL\n", interrupts);
+        exit(1);
+    }
+
+    unsigned wrong = wrongLatches();
+    bool enabled = 0 != (P6OUT.Latch() & BIT0);
+    bool pass = background && (0 == wrong) && enabled;
+    printf("background flush: %u interrupts, %u GS values wrong%s%s: %s\n", interrupts, wrong,
+        background ? "" : ", sent before Flush() returned", enabled ? "" : ", halo left off", pass ? "ok" : "FAIL");
+    return pass;
+}
+
+// Send one random frame to a chain of Chips TLC5957s the way HaloFramebuffer::Flush() does, and check what it latched.
+// The chain model has to be Chips long already.
+// @param send: the transport, send16bits for the one this build uses
+// @param cost: receives the port traffic of the frame
+// @return bool: true if every GS value arrived
+template <uint8_t Chips>
+static bool sendFrame(void (*send)(uint16_t, uint8_t), FrameCost& cost)
+{
+    typedef HaloChainFramebuffer<Chips, HALO_LEDS_PER_CHIP> ChainFramebuffer;
+    static uint16_t gs[ChainFramebuffer::WordCount];
+    static uint16_t words[ChainFramebuffer::WordCount];
+
+    uint16_t value = 0x1D2B;
+    for (uint16_t i = 0; i < ChainFramebuffer::WordCount; i++)
+    {
+        // xorshift16
+        value ^= value << 7;
+        value ^= value >> 9;
+        value ^= value << 8;
+        gs[i] = value;
+    }
+    uint8_t pokerBits = HaloFrame.GetPokerBits();
+    ChainFramebuffer::BuildStream(gs, pokerBits, words);
+
+    Cost = FrameCost();
+    const uint16_t* word = words;
+    for (uint8_t k = (0 == pokerBits) ? TLC5957_OUTPUT_COUNT : pokerBits; k-- > 0;)
+    {
+        for (uint8_t w = ChainFramebuffer::GroupWords - 1; w-- > 0;)
+        {
+            send(*word++, 0);
+        }
+        send(*word++, (0 == k) ? COMMAND_LATGS : COMMAND_WRTGS);
+    }
+    cost = Cost;
+
+    uint16_t mask = (0 == pokerBits) ? 0xFFFF : (uint16_t)(0xFFFF << (16 - pokerBits));
+    bool pass = true;
+    for (uint8_t led = 0; led < ChainFramebuffer::LedCount; led++)
+    {
+        for (uint8_t c = 0; c < RGB_CHANNEL_COUNT; c++)
+        {
+            pass &= (Chain.Shown(led, (HaloColor)c) == (gs[ChainFramebuffer::LedOffset(led) + c] & mask));
+        }
+    }
+    return pass;
+}
+
+// Send the same frame on single and double SCLK edges and compare the port writes.
+// @return bool: true if both frames arrived, and double edge took fewer writes
+static bool testDoubleEdge()
+{
+    Chain = TLC5957Model();
+    InitLEDController();
+
+    FrameCost cost;
+    Chain.SetDoubleEdge(false);
+    bool singleOk = sendFrame<HALO_CHIP_COUNT>(bitBang16bits, cost);
+    unsigned single = cost.Writes;
+    Chain.SetDoubleEdge(true);
+    bool bothOk = sendFrame<HALO_CHIP_COUNT>(doubleEdge16bits, cost);
+    unsigned both = cost.Writes;
+    bool pass = singleOk && bothOk && (both < single);
+    printf("double edge: %u port writes per frame against %u on the rising edge only (%u%%)%s%s: %s\n", both, single,
+        100 * both / single, singleOk ? "" : ", single edge frame wrong", bothOk ? "" : ", double edge frame wrong",
+        pass ? "ok" : "FAIL");
+    return pass;
+}
+
+// Read the FC register and the LED open detection back over SOUT.
+// @return bool: true if a good FC register verifies, a corrupted one does not, and LOD reports exactly
+//               the open LEDs that were on
+static bool testReadBack()
+{
+    Chain = TLC5957Model();
+    bool written = InitLEDController();
+    Chain.CorruptFC(17);
+    bool corrupted = VerifyFCRegister();
+    printf("read back: FC register %s, corrupted FC register %s\n", written ? "verified" : "MISMATCH",
+        corrupted ? "VERIFIED" : "rejected");
+
+    // open LEDs: red of the first, all of the middle one and blue of the last, which is off
+    Chain.SetOpen(0, HaloColor::Red);
+    Chain.SetOpen(RGB_LED_COUNT / 2, HaloColor::Red);
+    Chain.SetOpen(RGB_LED_COUNT / 2, HaloColor::Green);
+    Chain.SetOpen(RGB_LED_COUNT / 2, HaloColor::Blue);
+    Chain.SetOpen(RGB_LED_COUNT - 1, HaloColor::Blue);
+
+    uint16_t expected[HALO_CHIP_COUNT][RGB_CHANNEL_COUNT] = {};
+    expected[0][(uint8_t)HaloColor::Red] |= 1 << 0;
+    for (uint8_t c = 0; c < RGB_CHANNEL_COUNT; c++)
+    {
+        expected[(RGB_LED_COUNT / 2) / HALO_LEDS_PER_CHIP][c] |= 1 << ((RGB_LED_COUNT / 2) % HALO_LEDS_PER_CHIP);
+    }
+
+    // every LED on at full brightness except the last
+    for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+    {
+        uint16_t level = (RGB_LED_COUNT - 1 == led) ? 0 : 0xFFFF;
+        HaloFrame.SetPixel(led, level, level, level);
+    }
+    HaloFrame.Flush();
+
+    uint16_t openLEDs[HALO_CHIP_COUNT][RGB_CHANNEL_COUNT];
+    ReadLEDOpenDetect(openLEDs);
+    bool lod = (0 == memcmp(openLEDs, expected, sizeof(expected)));
+    printf("read back: LED open detection %s\n", lod ? "matches" : "MISMATCH");
+
+    // the read back left SOUT zeros in the chain, so the next frame has to go out
+    HaloFrame.Invalidate();
+    return written && !corrupted && lod;
+}
+
+// Check ToGS() against the gamma curve worked out in floating point, at every PWM depth and brightness.
+// @return bool: true if every level is within one step of the PWM depth of the reference, the curve never falls,
+//               only level 0 is black and ToLevel() inverts it
+static bool testGamma()
+{
+    // 9 is the shortest poker depth, where rounding matters most
+    const uint8_t depths[] = { 0, 9, 12 };
+    bool pass = true;
+
+    for (uint8_t pwmBits : depths)
+    {
+        HaloGamma::SetPwmBits(pwmBits);
+        unsigned lsb = (0 == pwmBits) ? 1 : 1u << (16 - pwmBits);
+        unsigned top = 0x10000 - lsb;
+        double worst = 0;
+        unsigned truncated = 0;
+        unsigned truncatedFull = 0;
+        bool ok = true;
+
+        for (uint8_t brightness = 0; brightness <= HALO_BRIGHTNESS_MAX; brightness++)
+        {
+            HaloGamma::SetBrightness(brightness);
+            unsigned shift = HALO_BRIGHTNESS_MAX - brightness;
+            uint16_t previous = 0;
+            for (unsigned level = 0; level < GAMMA_LEVEL_COUNT; level++)
+            {
+                uint16_t gs = HaloGamma::ToGS((uint8_t)level);
+                double reference = pow(level / 255.0, 2.2) * 65535.0 / (1 << shift);
+                double error = fabs(gs - reference) / lsb;
+                if (error > worst)
+                {
+                    worst = error;
+                }
+
+                // what plain truncation to the top PWM bits used to send
+                uint16_t table = (uint16_t)(pow(level / 255.0, 2.2) * 65535.0 + 0.5);
+                if ((0 != level) && (0 == ((table >> shift) & top)))
+                {
+                    truncated++;
+                    truncatedFull += (0 == shift);
+                }
+
+                ok &= (error <= 1.0) && (gs >= previous) && ((0 == level) == (0 == gs)) && (0 == (gs & (lsb - 1)))
+                    && (HaloGamma::ToGS(HaloGamma::ToLevel(gs)) == gs);
+                previous = gs;
+            }
+        }
+
+        printf("gamma %2u bits: worst error %.2f steps of the PWM depth, lit levels kept off black: %u at full brightness,"
+            " %u over all: %s\n", (0 == pwmBits) ? 16 : pwmBits, worst, truncatedFull, truncated, ok ? "ok" : "FAIL");
+        pass &= ok;
+    }
+
+    HaloGamma::SetBrightness(HALO_BRIGHTNESS_MAX);
+    HaloGamma::SetPwmBits(HaloFrame.GetPokerBits());
+    return pass;
+}
+
+// Move the host FRAME_TIMER on, counting its overflows the way TIMER0_B1_ISR does
+// @param ticks: microseconds
+static void advanceTimer(uint32_t ticks)
+{
+    uint32_t count = (uint32_t)TB0R + ticks;
+    for (uint32_t wraps = count >> 16; wraps-- > 0;)
+    {
+        TimeBase::Overflow();
+    }
+    TB0R = (uint16_t)count;
+}
+
+// Play HaloVM FadeTo over lengths from 1 to 255 frames, up and down, and check every frame is within a level
+// of the straight line between the two colors and the last one lands on the target.
+// @return bool: true if every fade does
+static bool testFade()
+{
+    const uint8_t lengths[] = { 1, 2, 3, 7, 100, 254, 255 };
+    const uint8_t ends[][2] = { { 0, 255 }, { 255, 0 }, { 17, 200 }, { 200, 199 }, { 90, 90 } };
+    HaloLayer& layer = HaloCompositor::Layer(HaloLayerId::Background);
+    unsigned wrong = 0;
+    unsigned fades = 0;
+
+    for (uint8_t length : lengths)
+    {
+        for (const uint8_t* end : ends)
+        {
+            const uint8_t code[] = { (uint8_t)HaloOp::Fill, end[0], end[1], 0,
+                (uint8_t)HaloOp::FadeTo, end[1], end[0], 0, length, (uint8_t)HaloOp::End };
+            HaloVM::Load(code, sizeof(code));
+            for (unsigned frame = 1; frame <= length; frame++)
+            {
+                HaloVM::RenderFrame(1);
+                HaloRGB shown;
+                layer.GetPixel(0, shown);
+                const uint8_t got[2] = { shown.Red, shown.Green };
+                for (uint8_t c = 0; c < 2; c++)
+                {
+                    int from = end[c];
+                    int to = end[1 - c];
+                    int line = (from * 256 + (to - from) * 256 * (int)frame / length) >> 8;
+                    bool ok = (frame == length) ? (got[c] == to) : (abs(got[c] - line) <= 1);
+                    wrong += ok ? 0 : 1;
+                }
+            }
+            fades++;
+        }
+    }
+    HaloVM::Stop();
+    layer.Clear();
+
+    printf("fade: %u fades, %u frames off the line: %s\n", fades, wrong, (0 == wrong) ? "ok" : "FAIL");
+    return 0 == wrong;
+}
+
+// Fade a hit flash at different render rates.
+// @return bool: true if at every rate and every frame the flash alpha is what the time since the flash calls for
+static bool testFlash()
+{
+    const uint32_t periods[] = { 5000, FRAME_TIMER_HZ / HALO_FPS_MAX, HIT_FLASH_STEP_TICKS,
+        FRAME_TIMER_HZ / HALO_FPS_DEFAULT, 250000, FRAME_TIMER_HZ / HALO_FPS_MIN };
+    HaloLayer& flash = HaloCompositor::Layer(HaloLayerId::HitFlash);
+    bool pass = true;
+
+    Chain = TLC5957Model();
+    InitLEDController();
+
+    for (uint32_t period : periods)
+    {
+        TB0R = 0;
+        TimeBase::Start();
+        HaloCompositor::Flash(HaloRGB{ 0xFF, 0x00, 0x00 });
+        HaloCompositor::Render();
+
+        bool ok = (0xFF == flash.Alpha);
+        uint32_t elapsed = 0;
+        uint32_t gone = 0;
+        while ((0 != flash.Alpha) && (elapsed < 4 * FRAME_TIMER_HZ))
+        {
+            advanceTimer(period);
+            elapsed += period;
+            HaloCompositor::Render();
+
+            uint8_t expected = 0xFF;
+            for (uint32_t step = elapsed / HIT_FLASH_STEP_TICKS; (0 != expected) && (step-- > 0);)
+            {
+                expected = Scale8(expected, HIT_FLASH_DECAY);
+                if (expected < HIT_FLASH_CUTOFF)
+                {
+                    expected = 0;
+                }
+            }
+            ok &= (flash.Alpha == expected);
+            gone = elapsed;
+        }
+        ok &= (0 == flash.Alpha);
+
+        printf("hit flash: a frame every %7lu us, gone after %7lu us: %s\n", (unsigned long)period,
+            (unsigned long)gone, ok ? "ok" : "FAIL");
+        pass &= ok;
+    }
+
+    flash.Clear();
+    flash.Alpha = 0;
+    HaloCompositor::Render();
+    return pass;
+}
+
+// A pack of frames that each fill the halo with one color, its own for every pack and frame
+static void makePack(uint8_t seed, unsigned frames, std::vector<uint8_t>& pack)
+{
+    pack.assign(1, (uint8_t)RGB_LED_COUNT);
+    for (unsigned frame = 0; frame < frames; frame++)
+    {
+        for (unsigned led = 0; led < RGB_LED_COUNT; led += HALO_PACK_COUNT_MAX)
+        {
+            unsigned count = RGB_LED_COUNT - led;
+            count = (count < HALO_PACK_COUNT_MAX) ? count : HALO_PACK_COUNT_MAX;
+            pack.push_back((uint8_t)(HALO_PACK_RUN | (count - 1)));
+            pack.push_back(seed);
+            pack.push_back((uint8_t)frame);
+            pack.push_back((uint8_t)(frame >> 8));
+        }
+        pack.push_back(HALO_PACK_SHOW);
+    }
+}
+
+// Write a pack into a slot of the pack store the way STORE_PACK does, in HALO_PACK_PART_MAX parts
+// @return bool: true if every part was taken and the pack finished
+static bool storePack(uint8_t slot, const std::vector<uint8_t>& pack)
+{
+    for (size_t offset = 0; offset < pack.size(); offset += HALO_PACK_PART_MAX)
+    {
+        size_t part = pack.size() - offset;
+        part = (part < HALO_PACK_PART_MAX) ? part : HALO_PACK_PART_MAX;
+        if (!HaloPack::StorePart(slot, (uint16_t)offset, &pack[offset], (uint8_t)part))
+        {
+            return false;
+        }
+    }
+    return HaloPack::FinishStore(slot);
+}
+
+// @return bool: true if a slot of the pack store plays every frame of a pack, and then starts it over
+static bool playsPack(uint8_t slot, const std::vector<uint8_t>& pack, unsigned frames)
+{
+    HaloLayer& layer = HaloCompositor::Layer(HaloLayerId::Background);
+    if (!HaloPack::LoadStored(slot))
+    {
+        return false;
+    }
+    bool ok = true;
+    for (unsigned frame = 0; frame <= frames; frame++)
+    {
+        HaloPack::RenderFrame(1);
+        HaloRGB shown;
+        layer.GetPixel(RGB_LED_COUNT - 1, shown);
+        unsigned expected = frame % frames;
+        ok &= (shown.Red == pack[2]) && (shown.Green == (uint8_t)expected) && (shown.Blue == (uint8_t)(expected >> 8));
+    }
+    return ok;
+}
+
+// Fill the pack store, replace a pack in the middle of it with a longer one, then with one too long for what is left.
+// @return bool: true if every slot plays its own pack after each change, a rejected pack leaves its slot empty,
+//               and StoreFree() adds up
+static bool testPackStore()
+{
+    const unsigned frames[] = { 5, 40, 9 };
+    const unsigned longer = 70;
+    std::vector<uint8_t> packs[3];
+    uint16_t free = HaloPack::StoreFree();
+    bool pass = true;
+
+    for (uint8_t slot = 0; slot < 3; slot++)
+    {
+        makePack((uint8_t)(0x10 + slot), frames[slot], packs[slot]);
+        pass &= storePack(slot, packs[slot]);
+        free -= (uint16_t)packs[slot].size();
+    }
+    pass &= (HaloPack::StoreFree() == free);
+    for (uint8_t slot = 0; slot < 3; slot++)
+    {
+        pass &= playsPack(slot, packs[slot], frames[slot]);
+    }
+    printf("pack store: 3 packs, %u bytes free: %s\n", HaloPack::StoreFree(), pass ? "ok" : "FAIL");
+
+    // slot 1 again, longer: slot 2 moves down over its old bytes and the new one goes at the end
+    std::vector<uint8_t> replacement;
+    makePack(0x21, longer, replacement);
+    bool ok = storePack(1, replacement);
+    free = free + (uint16_t)packs[1].size() - (uint16_t)replacement.size();
+    ok &= (HaloPack::StoreFree() == free);
+    ok &= playsPack(0, packs[0], frames[0]) && playsPack(1, replacement, longer) && playsPack(2, packs[2], frames[2]);
+    printf("pack store: slot 1 replaced by a longer pack, %u bytes free: %s\n", HaloPack::StoreFree(),
+        ok ? "ok" : "FAIL");
+    pass &= ok;
+
+    // slot 1 once more, with more than there is room for
+    std::vector<uint8_t> tooLong;
+    makePack(0x31, (free + replacement.size()) / (replacement.size() / longer) + 1, tooLong);
+    ok = !storePack(1, tooLong) && !HaloPack::LoadStored(1);
+    ok &= (HaloPack::StoreFree() == free + replacement.size());
+    ok &= playsPack(0, packs[0], frames[0]) && playsPack(2, packs[2], frames[2]);
+    printf("pack store: a pack too long for slot 1 rejected, the slot left empty: %s\n", ok ? "ok" : "FAIL");
+    pass &= ok;
+
+    HaloPack::Stop();
+    HaloCompositor::Layer(HaloLayerId::Background).Clear();
+    return pass;
+}
+
+// One frame of the phone end of the stream loopback: a comet going round the halo, changing color as it goes
+static void phoneFrame(unsigned frame, HaloRGB leds[RGB_LED_COUNT])
+{
+    for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+    {
+        leds[led] = HaloRGB{ 0, 0, 0 };
+    }
+    HaloRGB head = ColorWheel((uint8_t)(frame * 7));
+    leds[frame % RGB_LED_COUNT] = head;
+    leds[(frame + RGB_LED_COUNT - 1) % RGB_LED_COUNT] = HaloRGB{ Scale8(head.Red, 64), Scale8(head.Green, 64),
+        Scale8(head.Blue, 64) };
+}
+
+// Encode a frame as the STREAM_FRAME message the phone sends: the changes from the frame before as HaloPack records.
+// A keyframe is encoded from an all black halo.
+static void streamMessage(uint8_t sequence, bool keyframe, const HaloRGB* before, const HaloRGB* after,
+    std::vector<uint8_t>& wire)
+{
+    std::vector<uint8_t> records;
+    uint8_t led = 0;
+    while (led < RGB_LED_COUNT)
+    {
+        const HaloRGB from = keyframe ? HaloRGB{ 0, 0, 0 } : before[led];
+        bool same = (from.Red == after[led].Red) && (from.Green == after[led].Green) && (from.Blue == after[led].Blue);
+        uint8_t count = 1;
+        for (; (led + count < RGB_LED_COUNT) && (count < HALO_PACK_COUNT_MAX); count++)
+        {
+            const HaloRGB& next = after[led + count];
+            const HaloRGB nextFrom = keyframe ? HaloRGB{ 0, 0, 0 } : before[led + count];
+            if (same != ((nextFrom.Red == next.Red) && (nextFrom.Green == next.Green) && (nextFrom.Blue == next.Blue)))
+            {
+                break;
+            }
+        }
+        records.push_back((uint8_t)((same ? HALO_PACK_SKIP : HALO_PACK_LITERAL) | (count - 1)));
+        for (uint8_t i = 0; !same && (i < count); i++)
+        {
+            records.push_back(after[led + i].Red);
+            records.push_back(after[led + i].Green);
+            records.push_back(after[led + i].Blue);
+        }
+        led += count;
+    }
+    records.push_back(HALO_PACK_SHOW);
+
+    wire.push_back(STREAM_FRAME);
+    wire.push_back(sequence);
+    wire.push_back((uint8_t)(records.size() | (keyframe ? HALO_STREAM_KEYFRAME : 0)));
+    wire.insert(wire.end(), records.begin(), records.end());
+}
+
+// Stream frames from a phone model through a bluetooth link of the given baud rate into the real RX ring and
+// USCI0RX_ISR(), processCommands() and HaloStream, and check what the background layer shows at every tick.
+// @param baud: UART baud rate, 10 bits a byte
+// @param stall: stall the main loop once, half way through, for as long as the stream takes to send twice what
+//               the RX ring holds
+// @return bool: true if every tick shows a frame the phone sent, never an older one than the tick before,
+//               and the stream is showing the last frames when it ends. Without a stall nothing may be lost.
+//               With one, the only reply is the overflow report, and no other command runs.
+static bool testStream(uint32_t baud, bool stall)
+{
+    const uint32_t tickUs = FRAME_TIMER_HZ / HALO_FPS_DEFAULT;
+    const uint32_t byteUs = 10 * FRAME_TIMER_HZ / baud;
+    const unsigned frameCount = STREAM_TEST_SECONDS * HALO_FPS_DEFAULT;
+    const uint32_t stallStart = frameCount / 2 * tickUs;
+
+    // every frame the phone sends, and when each byte of them lands in UCA0RXBUF
+    std::vector<HaloRGB> sent(frameCount * RGB_LED_COUNT);
+    std::vector<uint8_t> wire;
+    std::vector<uint32_t> arrival;
+    uint32_t wireFree = 0;
+    uint32_t random = 1;
+    for (unsigned frame = 0; frame < frameCount; frame++)
+    {
+        phoneFrame(frame, &sent[frame * RGB_LED_COUNT]);
+        size_t start = wire.size();
+        streamMessage((uint8_t)frame, 0 == frame % STREAM_KEYFRAME_INTERVAL,
+            (0 == frame) ? nullptr : &sent[(frame - 1) * RGB_LED_COUNT], &sent[frame * RGB_LED_COUNT], wire);
+
+        // the phone sends on its own frame clock, and the bluetooth link delivers with some jitter
+        random = random * 1103515245 + 12345;
+        uint32_t at = frame * tickUs + (random >> 8) % STREAM_JITTER_US;
+        wireFree = (at > wireFree) ? at : wireFree;
+        for (size_t i = start; i < wire.size(); i++)
+        {
+            wireFree += byteUs;
+            arrival.push_back(wireFree);
+        }
+    }
+
+    uint32_t stallUs = stall ? (uint32_t)((uint64_t)2 * BT_BUFFER_LEN * arrival.back() / wire.size()) : 0;
+
+    HaloStream::Stop();
+    HaloStream::Underruns = 0;
+    HaloStream::Dropped = 0;
+    HaloVM::Stop();
+    HaloPack::Stop();
+    HaloEffect::Stop();
+    Bluetooth::Init();
+    Bluetooth::TakeRxOverflow();
+    Bluetooth::FlushRx();
+    Bluetooth::RxDropped = 0;
+    Replies.clear();
+    HaloLayer& layer = HaloCompositor::Layer(HaloLayerId::Background);
+    layer.Clear();
+
+    size_t delivered = 0;
+    uint32_t ticksDone = 0;
+    int shown = -1;
+    unsigned shownFrames = 0;
+    unsigned corrupt = 0;
+    unsigned backwards = 0;
+    uint32_t end = (frameCount + HALO_STREAM_DEPTH + 2) * tickUs;
+    for (uint32_t now = 0; (now < end) && (shown + 1 < (int)frameCount);)
+    {
+        // the ISR takes every byte as it arrives, also while the main loop is stalled
+        for (; (delivered < wire.size()) && (arrival[delivered] <= now); delivered++)
+        {
+            // the ISR times the gaps between bytes on FRAME_TIMER
+            TB0R = (uint16_t)arrival[delivered];
+            UCA0RXBUF_L = wire[delivered];
+            UCA0IV = 2;
+            USCI0RX_ISR();
+        }
+
+        processCommands();
+
+        uint32_t ticks = now / tickUs - ticksDone;
+        if ((0 != ticks) && HaloStream::Active())
+        {
+            HaloStream::RenderFrame((ticks < 0xFF) ? (uint8_t)ticks : 0xFF);
+
+            // which frame is on the layer
+            HaloRGB leds[RGB_LED_COUNT];
+            for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+            {
+                layer.GetPixel(led, leds[led]);
+            }
+            int match = -1;
+            for (int frame = (shown < 0) ? 0 : shown; (frame < (int)frameCount) && (match < 0); frame++)
+            {
+                if (0 == memcmp(leds, &sent[frame * RGB_LED_COUNT], sizeof(leds)))
+                {
+                    match = frame;
+                }
+            }
+            bool black = true;
+            for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+            {
+                black &= (0 == leds[led].Red) && (0 == leds[led].Green) && (0 == leds[led].Blue);
+            }
+
+            if (match >= 0)
+            {
+                shownFrames += (match != shown);
+                shown = match;
+            }
+            else if (!black || (shown >= 0))
+            {
+                // a frame the phone never sent, or one older than what was already shown
+                bool older = false;
+                for (int frame = 0; (frame < shown) && !older; frame++)
+                {
+                    older = (0 == memcmp(leds, &sent[frame * RGB_LED_COUNT], sizeof(leds)));
+                }
+                corrupt += !older;
+                backwards += older;
+            }
+        }
+        ticksDone += ticks;
+
+        bool stalled = stall && (now >= stallStart) && (now < stallStart + LOOP_PERIOD_US);
+        now += stalled ? stallUs : LOOP_PERIOD_US;
+    }
+
+    // the stream got through to the last frame
+    bool caughtUp = (shown + 1 == (int)frameCount);
+    bool ok = (0 == corrupt) && (0 == backwards) && caughtUp;
+    if (!stall)
+    {
+        ok &= (0 == HaloStream::Underruns) && (0 == HaloStream::Dropped) && (0 == Bluetooth::RxDropped);
+    }
+    else
+    {
+        // The stall is long enough to overflow the ring, which has to be seen and counted. Parsing starts again
+        // at a command byte, so nothing in the middle of a frame is run as a command.
+        ok &= (0 != Bluetooth::RxDropped);
+        std::string overflow = "Bluetooth RX overflow\r\n";
+        bool onlyOverflow = !Replies.empty();
+        for (size_t at = 0; onlyOverflow && (at < Replies.size()); at += overflow.size())
+        {
+            onlyOverflow = (0 == Replies.compare(at, overflow.size(), overflow));
+        }
+        ok &= onlyOverflow && !HaloVM::Playing() && !HaloPack::Playing() && !HaloEffect::Playing();
+    }
+    ok &= stall || Replies.empty();
+
+    printf("stream loopback %6lu baud, %u fps, %3lu ms stall: %u frames sent, %u shown, %u underruns, %u dropped,"
+        " %u RX bytes dropped, %u wrong: %s\n", (unsigned long)baud, (unsigned)HALO_FPS_DEFAULT,
+        (unsigned long)(stallUs / 1000), frameCount, shownFrames, HaloStream::Underruns, HaloStream::Dropped,
+        Bluetooth::RxDropped, corrupt + backwards, ok ? "ok" : "FAIL");
+
+    HaloStream::Stop();
+    layer.Clear();
+    return ok;
+}
+
+// @return unsigned: modelled MCLK cycles of the frame render: the pattern, the compositor and the stream build.
+// The VM and compositor work counters have to be cleared before the frame.
+static unsigned renderCycles()
+{
+    const HaloVMWork& vm = HaloVM::Work;
+    const HaloCompositorWork& compositor = HaloCompositor::Work;
+    uint8_t pokerBits = HaloFrame.GetPokerBits();
+    unsigned build = (0 == pokerBits) ? HaloFramebuffer::WordCount * CYCLES_PER_STREAM_WORD
+        : pokerBits * HaloFramebuffer::GroupWords * 16 * CYCLES_PER_STREAM_BIT;
+
+    return CYCLES_PER_PATTERN_CALL + vm.Ops * CYCLES_PER_VM_OP + vm.FadeLevels * CYCLES_PER_EFFECT_LEVEL
+        + compositor.LayerPixels * CYCLES_PER_LAYER_PIXEL + compositor.Composed * CYCLES_PER_COMPOSED_LED
+        + compositor.Flushed * build;
+}
+
+// Play the blue chase as the hand-coded BlueCW() and as its bytecode in pattern slot 0, and compare what a frame costs.
+// @return bool: true if both put the same frames on the halo
+static bool benchPatterns()
+{
+    const unsigned frameCount = RGB_LED_COUNT * 4;
+    std::vector<uint16_t> shown[2];
+
+    Chain = TLC5957Model();
+    InitLEDController();
+
+    printf("\npattern       avg us  worst us  render cycles  port cycles\n");
+    for (unsigned run = 0; run < 2; run++)
+    {
+        bool vm = (1 == run);
+        unsigned total = 0;
+        unsigned worst = 0;
+        unsigned renderTotal = 0;
+        unsigned portTotal = 0;
+        uint16_t animationFrame = 0;
+
+        HaloCompositor::Layer(HaloLayerId::Background).Clear();
+        HaloFrame.Invalidate();
+        if (vm)
+        {
+            HaloVM::LoadSlot(0);
+        }
+        for (unsigned frame = 0; frame < frameCount; frame++)
+        {
+            Cost = FrameCost();
+            HaloVM::Work = HaloVMWork();
+            HaloCompositor::Work = HaloCompositorWork();
+
+            // the same steps as RenderHaloFrame(). The slot plays once there, here it starts over.
+            if (vm)
+            {
+                if (!HaloVM::RenderFrame(1))
+                {
+                    HaloVM::LoadSlot(0);
+                }
+            }
+            else
+            {
+                animationFrame = BlueCW(animationFrame) ? animationFrame + 1 : 0;
+            }
+            HaloCompositor::Render();
+
+            unsigned render = renderCycles();
+            unsigned cycles = render + Cost.Cycles();
+            renderTotal += render;
+            portTotal += Cost.Cycles();
+            total += cycles;
+            if (cycles > worst)
+            {
+                worst = cycles;
+            }
+
+            for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+            {
+                for (uint8_t c = 0; c < RGB_CHANNEL_COUNT; c++)
+                {
+                    shown[run].push_back(Chain.Shown(led, (HaloColor)c));
+                }
+            }
+        }
+        HaloVM::Stop();
+
+        printf("%-12s  %6u  %8u  %13u  %11u\n", vm ? "slot 0 (VM)" : "BlueCW()", total / frameCount / MCLK_MHZ,
+            (worst + MCLK_MHZ - 1) / MCLK_MHZ, renderTotal / frameCount, portTotal / frameCount);
+    }
+
+    bool same = (shown[0] == shown[1]);
+    printf("same frames: %s\n", same ? "yes" : "NO");
+    return same;
+}
+
+// Send one frame to a chain of Chips TLC5957s through the transport of this build and print what it takes.
+// @return bool: true if the chain latched the frame
+template <uint8_t Chips>
+static bool benchChain()
+{
+    FrameCost cost;
+    Chain.SetChips(Chips);
+    bool pass = sendFrame<Chips>(send16bits, cost);
+    unsigned us = cost.Micros();
+    printf("%5u  %4u  %10u  %11u  %11u  %7u%s\n", Chips, Chips * HALO_LEDS_PER_CHIP, cost.Edges, cost.Writes, us,
+        1000000 / us, pass ? "" : "  WRONG");
+    return pass;
+}
+
+#ifndef HALO_SPI_TRANSPORT
+// Play the blue chase at HALO_FPS_MAX on a modelled MCLK, the way Loop() renders it, and measure the longest
+// Loop() pass as main.cpp does for loopStallMax: from one pass to the next, including the interrupts in between.
+// @param background: send the frames from the CCR2 interrupt, instead of in the foreground
+// @param interruptMax: receives the longest CCR2 interrupt, MCLK cycles
+// @param latchMax: receives the longest time from the start of a render to its frame being latched, MCLK cycles
+// @return unsigned: the longest Loop() pass, MCLK cycles
+static unsigned loopStall(bool background, unsigned& interruptMax, unsigned& latchMax)
+{
+    const uint64_t period = (uint64_t)MCLK_MHZ * FRAME_TIMER_HZ / HALO_FPS_MAX;
+    uint64_t now = 0;
+    uint64_t nextFrame = 0;
+    // the pending CCR2 compare, and the start of the render whose frame is going out
+    uint64_t compareAt = 0;
+    uint64_t renderAt = 0;
+    uint16_t animationFrame = 0;
+    unsigned frames = 0;
+    unsigned stallMax = 0;
+    interruptMax = 0;
+    latchMax = 0;
+
+    Chain = TLC5957Model();
+    InitLEDController();
+    HaloCompositor::Layer(HaloLayerId::Background).Clear();
+    HaloFrame.Invalidate();
+    HostSR = background ? GIE : 0;
+
+    while (frames < STALL_FRAMES)
+    {
+        uint64_t start = now;
+        unsigned work = CYCLES_PER_LOOP_PASS;
+        if ((now >= nextFrame) && !HaloFrame.Busy())
+        {
+            Cost = FrameCost();
+            HaloVM::Work = HaloVMWork();
+            HaloCompositor::Work = HaloCompositorWork();
+            animationFrame = BlueCW(animationFrame) ? animationFrame + 1 : 0;
+            HaloCompositor::Render();
+            work += renderCycles() + Cost.Cycles();
+            nextFrame += period;
+            frames++;
+
+            renderAt = start;
+            if (HaloFrame.Busy())
+            {
+                // Flush() starts the frame as the render ends
+                compareAt = start + work + (uint16_t)(TB0CCR2 - TB0R) * MCLK_CYCLES_PER_TICK;
+            }
+            else if (start + work - renderAt > latchMax)
+            {
+                latchMax = (unsigned)(start + work - renderAt);
+            }
+        }
+
+        // the CCR2 interrupts that come in before the pass ends make it that much longer
+        uint64_t end = start + work;
+        while (HaloFrame.Busy() && (compareAt <= end))
+        {
+            Cost = FrameCost();
+            HaloFlush::Tick();
+            unsigned cycles = CYCLES_PER_FLUSH_INTERRUPT + Cost.Cycles();
+            end += cycles;
+            if (cycles > interruptMax)
+            {
+                interruptMax = cycles;
+            }
+            if (HaloFrame.Busy())
+            {
+                compareAt += cycles + (uint16_t)(TB0CCR2 - TB0R) * MCLK_CYCLES_PER_TICK;
+            }
+            else if (compareAt + cycles - renderAt > latchMax)
+            {
+                latchMax = (unsigned)(compareAt + cycles - renderAt);
+            }
+        }
+
+        if (end - start > stallMax)
+        {
+            stallMax = (unsigned)(end - start);
+        }
+        now = end;
+    }
+
+    // let the last frame finish, so nothing is left for the next Wait()
+    while (HaloFrame.Busy() && deliverFlushInterrupt());
+    HostSR = 0;
+    HaloCompositor::Layer(HaloLayerId::Background).Clear();
+    HaloCompositor::Render();
+    return stallMax;
+}
+
+// loopStallMax with the halo frames sent in the foreground, and with HaloFlush sending them from CCR2
+// @return bool: true if sending in the background shortened the longest Loop() pass
+static bool benchLoopStall()
+{
+    unsigned foregroundInterrupt;
+    unsigned foregroundLatch;
+    unsigned backgroundInterrupt;
+    unsigned backgroundLatch;
+    unsigned foreground = loopStall(false, foregroundInterrupt, foregroundLatch);
+    unsigned background = loopStall(true, backgroundInterrupt, backgroundLatch);
+
+    printf("\nflush       loop stall max us  longest CCR2 us  latched after us  (BlueCW() at %u fps)\n",
+        (unsigned)HALO_FPS_MAX);
+    printf("foreground  %17u  %15u  %16u\n", (foreground + MCLK_MHZ - 1) / MCLK_MHZ, 0u,
+        (foregroundLatch + MCLK_MHZ - 1) / MCLK_MHZ);
+    printf("background  %17u  %15u  %16u\n", (background + MCLK_MHZ - 1) / MCLK_MHZ,
+        (backgroundInterrupt + MCLK_MHZ - 1) / MCLK_MHZ, (backgroundLatch + MCLK_MHZ - 1) / MCLK_MHZ);
+    return background < foreground;
+}
+#else
+static bool benchLoopStall()
+{
+    printf("\nloop stall: skipped, the host has no model of the eUSCI_B1 interrupt pace\n");
+    return true;
+}
+#endif
+
+// Frame transfer time for chains of 1 - 8 chips. Only the transfer is counted, not rendering the frame.
+// @return bool: true if every chain latched its frame
+static bool benchChains()
+{
+    Chain = TLC5957Model();
+    InitLEDController();
+
+    printf("\nchips  LEDs  SCLK edges  port writes  transfer us  max fps  (poker %u bits, MCLK %uMHz)\n",
+        HaloFrame.GetPokerBits(), MCLK_MHZ);
+    bool pass = benchChain<1>();
+    pass &= benchChain<2>();
+    pass &= benchChain<3>();
+    pass &= benchChain<4>();
+    pass &= benchChain<5>();
+    pass &= benchChain<6>();
+    pass &= benchChain<7>();
+    pass &= benchChain<8>();
+
+    Chain = TLC5957Model();
+    return pass;
+}
+
+// Cost of a frame of the color wheel patterns: the kernel per LED, the layer writes, compositing and the stream build.
+static void benchFills()
+{
+    struct Fill
+    {
+        const char* Name;
+        bool (*Pattern)(uint16_t);
+        unsigned KernelCycles;
+    };
+    const Fill fills[] = {
+        { "RainbowCW()", RainbowCW, CYCLES_PER_HSV },
+        { "HeatCW()", HeatCW, CYCLES_PER_HEAT },
+    };
+
+    Chain = TLC5957Model();
+    InitLEDController();
+
+    printf("\nfill          kernel cycles  render cycles  port cycles  frame us\n");
+    for (const Fill& fill : fills)
+    {
+        unsigned kernel = 0;
+        unsigned render = 0;
+        unsigned port = 0;
+        const unsigned frameCount = 64;
+        for (unsigned frame = 0; frame < frameCount; frame++)
+        {
+            Cost = FrameCost();
+            HaloVM::Work = HaloVMWork();
+            HaloCompositor::Work = HaloCompositorWork();
+            fill.Pattern((uint16_t)frame);
+            HaloCompositor::Render();
+
+            kernel += RGB_LED_COUNT * fill.KernelCycles;
+            render += renderCycles();
+            port += Cost.Cycles();
+        }
+        printf("%-12s  %13u  %13u  %11u  %8u\n", fill.Name, kernel / frameCount, render / frameCount,
+            port / frameCount, (kernel + render + port) / frameCount / MCLK_MHZ);
+    }
+    HaloCompositor::Layer(HaloLayerId::Background).Clear();
+    HaloCompositor::Render();
+}
+
+// Gamma cost of a composed frame, three ToGS() per LED, at every brightness
+static void benchGamma()
+{
+    HaloLayer& background = HaloCompositor::Layer(HaloLayerId::Background);
+    background.Fill(HaloRGB{ 0x80, 0x80, 0x80 });
+    HaloCompositor::Work = HaloCompositorWork();
+    HaloCompositor::Render();
+    unsigned calls = HaloCompositor::Work.Composed * RGB_CHANNEL_COUNT;
+    background.Clear();
+    HaloCompositor::Render();
+
+    printf("\nbrightness  ToGS cycles  per frame  frame us  (%u calls, poker %u bits)\n", calls,
+        HaloFrame.GetPokerBits());
+    for (uint8_t brightness = HALO_BRIGHTNESS_MAX + 1; brightness-- > 0;)
+    {
+        unsigned cycles = CYCLES_PER_GAMMA_CALL + (HALO_BRIGHTNESS_MAX - brightness) * CYCLES_PER_GAMMA_SHIFT;
+        printf("%10u  %11u  %9u  %8u\n", brightness, cycles, calls * cycles,
+            (calls * cycles + MCLK_MHZ - 1) / MCLK_MHZ);
+    }
+}
+
+// Run the benchmarks
+// @return int: 0 if every effect fits its budget, every chain latched its frame and the chase patterns agree, 1 if not
+static int benchmark(uint16_t seed)
+{
+    bool pass = benchEffects(seed);
+    pass &= benchChains();
+    pass &= benchPatterns();
+    pass &= benchLoopStall();
+    benchFills();
+    benchGamma();
+    return pass ? 0 : 1;
+}
+
+// Run every host test
+// @return int: 0 if they all pass, 1 if not
+static int selfTest()
+{
+    bool pass = testTransport();
+    pass &= testFrame();
+    pass &= testBackgroundFlush();
+    pass &= testDoubleEdge();
+    pass &= testReadBack();
+    pass &= testGamma();
+    pass &= testFade();
+    pass &= testFlash();
+    pass &= testPackStore();
+    pass &= testStream(STREAM_BAUD, false);
+    pass &= testStream(STREAM_BAUD, true);
+    return pass ? 0 : 1;
+}
+
+static int usage()
+{
+    fprintf(stderr, "usage: halorender [-p pattern] [-n frames] [-s size] [-S seed] [-q] strip.ppm\n");
+    fprintf(stderr, "       halorender -b [-S seed]\n");
+    fprintf(stderr, "       halorender -t\n");
+    fprintf(stderr, "       halorender -l baud\n");
+    fprintf(stderr, "  -p pattern  blue (default), red, green, rainbow, heat, slot:N for a HaloVM pattern slot, pack:file for a HaloPack,\n");
+    fprintf(stderr, "              effect:comet, effect:breathe, effect:sparkle or effect:wipe for a HaloEffect\n");
+    fprintf(stderr, "  -n frames   frames to render, default %u\n", (unsigned)RGB_LED_COUNT * 2);
+    fprintf(stderr, "  -s size     pixels per LED in the image, default 8\n");
+    fprintf(stderr, "  -S seed     HaloEffect random seed, default %u\n", (unsigned)HALO_EFFECT_DEFAULT_SEED);
+    fprintf(stderr, "  -q          only print the summary\n");
+    fprintf(stderr, "  -b          check the effects against their per frame budgets, measure chains of 1 - 8 chips\n");
+    fprintf(stderr, "  -t          run the host tests against the TLC5957 model\n");
+    fprintf(stderr, "  -l baud     stream frames into the bluetooth RX ring at a baud rate and check what the halo shows\n");
+    return 2;
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+int main(int argc, char** argv)
+{
+    const char* pattern = "blue";
+    unsigned frameCount = RGB_LED_COUNT * 2;
+    unsigned size = 8;
+    uint16_t seed = HALO_EFFECT_DEFAULT_SEED;
+    bool quiet = false;
+    bool bench = false;
+    const char* path = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((0 == strcmp(argv[i], "-p")) && (i + 1 < argc))
+        {
+            pattern = argv[++i];
+        }
+        else if ((0 == strcmp(argv[i], "-n")) && (i + 1 < argc))
+        {
+            frameCount = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if ((0 == strcmp(argv[i], "-s")) && (i + 1 < argc))
+        {
+            size = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if ((0 == strcmp(argv[i], "-S")) && (i + 1 < argc))
+        {
+            seed = (uint16_t)strtoul(argv[++i], nullptr, 0);
+        }
+        else if (0 == strcmp(argv[i], "-q"))
+        {
+            quiet = true;
+        }
+        else if (0 == strcmp(argv[i], "-b"))
+        {
+            bench = true;
+        }
+        else if (0 == strcmp(argv[i], "-t"))
+        {
+            return selfTest();
+        }
+        else if ((0 == strcmp(argv[i], "-l")) && (i + 1 < argc))
+        {
+            uint32_t baud = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            if (0 == baud)
+            {
+                return usage();
+            }
+            bool pass = testStream(baud, false);
+            pass &= testStream(baud, true);
+            return pass ? 0 : 1;
+        }
+        else if (('-' != argv[i][0]) && (nullptr == path))
+        {
+            path = argv[i];
+        }
+        else
+        {
+            return usage();
+        }
+    }
+    if (bench)
+    {
+        return benchmark(seed);
+    }
+    if ((nullptr == path) || (0 == frameCount) || (0 == size))
+    {
+        return usage();
+    }
+
+    bool (*chase)(uint16_t) = nullptr;
+    std::vector<uint8_t> pack;
+    if (0 == strcmp(pattern, "blue"))
+    {
+        chase = BlueCW;
+    }
+    else if (0 == strcmp(pattern, "red"))
+    {
+        chase = RedCW;
+    }
+    else if (0 == strcmp(pattern, "green"))
+    {
+        chase = GreenCW;
+    }
+    else if (0 == strcmp(pattern, "rainbow"))
+    {
+        chase = RainbowCW;
+    }
+    else if (0 == strcmp(pattern, "heat"))
+    {
+        chase = HeatCW;
+    }
+    else if (0 == strncmp(pattern, "slot:", 5))
+    {
+        if (!HaloVM::LoadSlot((uint8_t)strtoul(pattern + 5, nullptr, 10)))
+        {
+            fprintf(stderr, "%s: no pattern in the slot\n", pattern);
+            return 1;
+        }
+    }
+    else if (0 == strncmp(pattern, "pack:", 5))
+    {
+        if (!readFile(pattern + 5, pack))
+        {
+            return 1;
+        }
+        // load it the way STORE_PACK and PLAY_PACK do, through slot 0 of the FRAM pack store
+        bool stored = true;
+        for (size_t offset = 0; stored && (offset < pack.size()); offset += HALO_PACK_PART_MAX)
+        {
+            size_t part = pack.size() - offset;
+            part = (part < HALO_PACK_PART_MAX) ? part : HALO_PACK_PART_MAX;
+            stored = HaloPack::StorePart(0, (uint16_t)offset, &pack[offset], (uint8_t)part);
+        }
+        if (!stored)
+        {
+            fprintf(stderr, "%s: does not fit the pack store\n", pattern + 5);
+            return 1;
+        }
+        if (!HaloPack::FinishStore(0) || !HaloPack::LoadStored(0))
+        {
+            fprintf(stderr, "%s: not a pack for %u LEDs\n", pattern + 5, (unsigned)RGB_LED_COUNT);
+            return 1;
+        }
+    }
+    else if (0 == strncmp(pattern, "effect:", 7))
+    {
+        const EffectSetup* setup = findEffect(pattern + 7);
+        if (nullptr == setup)
+        {
+            return usage();
+        }
+        HaloEffect::Seed(seed);
+        HaloEffect::Start(setup->Id, setup->Color, setup->Speed, setup->Param);
+    }
+    else
+    {
+        return usage();
+    }
+
+    bool verified = InitLEDController();
+    printf("FC register read back: %s\n", verified ? "ok" : "MISMATCH");
+
+    const unsigned width = RGB_LED_COUNT * size;
+    std::vector<uint8_t> image(width * frameCount * size * 3);
+    FrameCost total = {};
+    FrameCost worst = {};
+    uint16_t animationFrame = 0;
+
+    if (!quiet)
+    {
+        printf("frame  SCLK edges  port writes  port reads  port cycles\n");
+    }
+    for (unsigned frame = 0; frame < frameCount; frame++)
+    {
+        Cost = FrameCost();
+
+        // the same steps as RenderHaloFrame(), one frame tick at a time
+        bool nextFrame;
+        if (nullptr != chase)
+        {
+            nextFrame = chase(animationFrame);
+        }
+        else if (HaloVM::Playing())
+        {
+            nextFrame = HaloVM::RenderFrame(1);
+        }
+        else if (HaloPack::Playing())
+        {
+            nextFrame = HaloPack::RenderFrame(1);
+        }
+        else
+        {
+            nextFrame = HaloEffect::RenderFrame(1);
+        }
+        animationFrame = nextFrame ? animationFrame + 1 : 0;
+        HaloCompositor::Render();
+
+        bool enabled = 0 != (P6OUT.Latch() & HALO_ENABLE);
+        for (uint8_t led = 0; led < RGB_LED_COUNT; led++)
+        {
+            const HaloColor colors[RGB_CHANNEL_COUNT] = { HaloColor::Red, HaloColor::Green, HaloColor::Blue };
+            for (unsigned y = 0; y < size; y++)
+            {
+                for (unsigned x = 0; x < size; x++)
+                {
+                    uint8_t* pixel = &image[(((frame * size + y) * width) + led * size + x) * 3];
+                    for (uint8_t c = 0; c < RGB_CHANNEL_COUNT; c++)
+                    {
+                        pixel[c] = enabled ? toPixel(Chain.Shown(led, colors[c])) : 0;
+                    }
+                }
+            }
+        }
+
+        if (!quiet)
+        {
+            printf("%5u  %10u  %11u  %10u  %11u\n", frame, Cost.Edges, Cost.Writes, Cost.Reads, Cost.Cycles());
+        }
+        total.Edges += Cost.Edges;
+        total.Writes += Cost.Writes;
+        total.Reads += Cost.Reads;
+        if (Cost.Cycles() > worst.Cycles())
+        {
+            worst = Cost;
+        }
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (nullptr == file)
+    {
+        fprintf(stderr, "%s: cannot create\n", path);
+        return 1;
+    }
+    fprintf(file, "P6\n%u %u\n255\n", width, frameCount * size);
+    fwrite(image.data(), 1, image.size(), file);
+    fclose(file);
+
+    printf("frames latched: %u of %u rendered\n", Chain.Frames, frameCount);
+    if (0 != Chain.UnknownCommands)
+    {
+        printf("latch commands not modelled: %u\n", Chain.UnknownCommands);
+    }
+    printf("per frame: %u SCLK edges, %u port writes, %u port cycles on average; worst %u port writes, %u port cycles\n",
+        total.Edges / frameCount, total.Writes / frameCount, total.Cycles() / frameCount, worst.Writes, worst.Cycles());
+    return 0;
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
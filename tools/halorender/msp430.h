@@ -0,0 +1,290 @@
+/**
+* @brief      Stand-in for the TI msp430.h when building halo code on the PC
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Only what the halo modules touch is here. The halo pins (P3OUT, P4OUT, P4IN, P6OUT) are HostPort objects
+*               that report every write and read to halorender.cpp, which runs them through a TLC5957 model.
+*               UCB1TXBUF reports every byte written to it, for the eUSCI_B1 SPI transport (HALO_SPI_TRANSPORT).
+*               The bluetooth UART replies the same way: setting UCTXIE in UCA0IE calls the host program, which
+*               delivers the TX interrupts, and UCA0TXBUF reports every byte written to it.
+*               Every other register is a plain variable. Interrupt handlers build as plain functions, so the host
+*               delivers an interrupt by setting the vector register (UCA0IV) and calling the handler.
+*               __get_SR_register() reads HostSR, which leaves GIE clear unless a test sets it, so HaloFlush sends
+*               frames in the foreground the way it does before Setup() enables interrupts. A test that sets GIE
+*               delivers the TB0 CCR2 interrupt itself, by calling HaloFlush::Tick().
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef HOST_MSP430_H
+#define HOST_MSP430_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+#define HALO_HOST_RENDER
+
+#define BIT0 (0x0001)
+#define BIT1 (0x0002)
+#define BIT2 (0x0004)
+#define BIT3 (0x0008)
+#define BIT4 (0x0010)
+#define BIT5 (0x0020)
+#define BIT6 (0x0040)
+#define BIT7 (0x0080)
+
+// FRAM write protection
+#define FRWPPW (0xA500)
+#define PFWP (0x0001)
+#define DFWP (0x0002)
+
+// Timer_B control bits used by the LaserTarget.h timer settings
+#define TBSSEL__SMCLK (0x0200)
+#define ID_1 (0x0040)
+#define ID_3 (0x00C0)
+#define MC_2 (0x0020)
+#define MC_3 (0x0030)
+#define TBCLR (0x0004)
+#define TBIE (0x0002)
+#define CCIE (0x0010)
+
+// status register
+#define GIE (0x0008)
+
+// PMM
+#define LOCKLPM5 (0x0001)
+
+// eUSCI_B SPI mode bits used by HaloSPI
+#define UCSWRST (0x0001)
+#define UCSSEL__SMCLK (0x0080)
+#define UCSYNC (0x0100)
+#define UCMODE_0 (0x0000)
+#define UCMST (0x0800)
+#define UCMSB (0x2000)
+#define UCCKPH (0x8000)
+#define UCBUSY (0x0001)
+#define UCTXIFG (0x0002)
+#define UCTXIE (0x0002)
+
+// eUSCI_A UART bits used by Bluetooth
+#define UCRXIE (0x0001)
+#define UCOS16 (0x0001)
+#define USCI_A0_VECTOR 0
+#define TBIFG (0x0001)
+
+#define __no_operation()
+#define __enable_interrupt()
+#define __disable_interrupt()
+#define __get_interrupt_state() ((uint16_t)0)
+#define __get_SR_register() (HostSR)
+#define __set_interrupt_state(state) ((void)(state))
+#define __delay_cycles(cycles)
+#define __even_in_range(value, range) (value)
+#define _even_in_range(value, range) (value)
+
+// the host compiler has no interrupt keyword, and the GCC interrupt(vector) attribute becomes a plain function
+#define __interrupt
+#define interrupt(vector) used
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+class HostPort;
+
+// Implemented by the host program
+// @param port: the port that was written
+// @param before: pin levels before the write
+void HostPortWritten(const HostPort& port, uint8_t before);
+// @return uint8_t: pin levels of an input port
+uint8_t HostPortRead(const HostPort& port);
+// @param data: byte written to UCB1TXBUF
+void HostTxWritten(uint8_t data);
+// UCTXIE was set in UCA0IE: deliver the USCI_A0 TX interrupts until the handler clears it
+void HostUartTxEnabled();
+// @param data: byte written to UCA0TXBUF
+void HostUartWritten(uint8_t data);
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+// An 8-bit port register that tells the host program about every access
+class HostPort
+{
+	uint8_t value;
+
+	HostPort& write(uint8_t next)
+	{
+		uint8_t before = value;
+		value = next;
+		HostPortWritten(*this, before);
+		return *this;
+	}
+
+public:
+	HostPort() : value(0)
+	{
+	}
+
+	// current output latch, without counting as a read
+	uint8_t Latch() const
+	{
+		return value;
+	}
+
+	operator uint8_t() const
+	{
+		return HostPortRead(*this);
+	}
+
+	// int operands, like the register macros, so ~BITn masks need no casts
+	HostPort& operator=(int next)
+	{
+		return write((uint8_t)next);
+	}
+	HostPort& operator|=(int bits)
+	{
+		return write(value | (uint8_t)bits);
+	}
+	HostPort& operator&=(int bits)
+	{
+		return write(value & (uint8_t)bits);
+	}
+	HostPort& operator^=(int bits)
+	{
+		return write(value ^ (uint8_t)bits);
+	}
+};
+
+// The eUSCI TX buffer. The host eUSCI shifts a byte out the moment it is written, so UCTXIFG is always set.
+class HostTxBuf
+{
+public:
+	HostTxBuf& operator=(int data)
+	{
+		HostTxWritten((uint8_t)data);
+		return *this;
+	}
+};
+
+// The bluetooth UART interrupt enables. The host UART sends a byte the moment it is written, so once UCTXIE is set
+// the TX interrupts run back to back until the handler has nothing left and clears it.
+class HostUartIE
+{
+	uint16_t value;
+
+	HostUartIE& write(uint16_t next)
+	{
+		value = next;
+		if (0 != (value & UCTXIE))
+		{
+			HostUartTxEnabled();
+		}
+		return *this;
+	}
+
+public:
+	HostUartIE() : value(0)
+	{
+	}
+
+	operator uint16_t() const
+	{
+		return value;
+	}
+
+	HostUartIE& operator=(int next)
+	{
+		return write((uint16_t)next);
+	}
+	HostUartIE& operator|=(int bits)
+	{
+		return write(value | (uint16_t)bits);
+	}
+	HostUartIE& operator&=(int bits)
+	{
+		return write(value & (uint16_t)bits);
+	}
+	HostUartIE& operator^=(int bits)
+	{
+		return write(value ^ (uint16_t)bits);
+	}
+};
+
+// The bluetooth UART TX buffer
+class HostUartTxBuf
+{
+public:
+	HostUartTxBuf& operator=(int data)
+	{
+		HostUartWritten((uint8_t)data);
+		return *this;
+	}
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+// halo pins
+extern HostPort P3OUT;
+extern HostPort P4OUT;
+extern HostPort P4IN;
+extern HostPort P6OUT;
+extern HostTxBuf UCB1TXBUF;
+
+// everything else the halo modules write
+extern volatile uint8_t P2OUT;
+extern volatile uint8_t P3DIR;
+extern volatile uint8_t P4DIR;
+extern volatile uint8_t P4SEL0;
+extern volatile uint8_t P4SEL1;
+extern volatile uint8_t P6DIR;
+extern volatile uint16_t SYSCFG0;
+extern volatile uint16_t PM5CTL0;
+extern volatile uint16_t TB0CTL;
+extern volatile uint16_t TB0R;
+extern volatile uint16_t TB0CCTL1;
+extern volatile uint16_t TB0CCTL2;
+extern volatile uint16_t TB0CCR1;
+extern volatile uint16_t TB0CCR2;
+extern volatile uint16_t UCB1CTLW0;
+extern volatile uint16_t UCB1BRW;
+extern volatile uint16_t UCB1STATW;
+extern volatile uint16_t UCB1IE;
+extern volatile uint16_t UCB1IFG;
+extern volatile uint16_t UCB1IV;
+// the status register, for GIE
+extern volatile uint16_t HostSR;
+
+// the bluetooth UART
+extern volatile uint8_t P1SEL0;
+extern volatile uint8_t P1SEL1;
+extern volatile uint8_t P1DIR;
+extern volatile uint8_t P1REN;
+extern volatile uint8_t P1IES;
+extern volatile uint16_t UCA0CTLW0;
+extern volatile uint16_t UCA0BRW;
+extern volatile uint16_t UCA0MCTLW;
+extern HostUartIE UCA0IE;
+extern volatile uint16_t UCA0IFG;
+extern volatile uint16_t UCA0IV;
+extern volatile uint8_t UCA0RXBUF_L;
+extern HostUartTxBuf UCA0TXBUF;
+
+#endif // !HOST_MSP430_H
@@ -0,0 +1,412 @@
+/**
+* @brief      Host side cycles per sample benchmark for the light sensor detection stage
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Runs the detection stage of LightSensor::DetectHit(), HitDetector then ShooterDecoder, over a set of
+*               light sensor waveforms in LIGHT_BATCH_SIZE batches, and reports the MCLK cycles per sample it costs.
+*
+*               Build on the PC:   g++ -std=c++14 -O2 -Itools/halorender -o hitbench tools/hitbench.cpp HitDetector.cpp ShooterDecoder.cpp
+*               Run:               hitbench [-n samples] [-S seed]
+*
+*               The cycles come from the cost model in hitcost.h. For each waveform the mean is what a capture
+*               costs on average, the worst batch is what main_real.cpp reports as DetectTicksPerSampleMax, so
+*               the two can be compared on the target; both are also given in FRAME_TIMER ticks. The host time per
+*               sample is measured as well, which only tells whether a code change made the stage slower.
+*               The dimming waveform is what the ring holds on the target: the window only lets captures through,
+*               each one after an ambient sample marked with LIGHT_SAMPLE_AMBIENT, and the light drops between
+*               them by as much as a shot adds. A detector that kept the baseline from the capture before would
+*               take the next shot for ambient light, so every shot sent has to come out as a frame.
+*               Exits 1 if the worst batch needs more cycles per sample than MCLK has between two samples, or if
+*               the dimming waveform loses a shot.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <chrono>
+#include <vector>
+
+#include "../HitDetector.h"
+#include "../ShooterDecoder.h"
+#include "hitcost.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+#define SAMPLES_PER_BIT (2 * SHOOTER_HALF_BIT_SAMPLES)
+#define SAMPLES_PER_FRAME (SHOOTER_FRAME_BITS * SAMPLES_PER_BIT)
+
+#define DEFAULT_SAMPLES 262144
+#define AMBIENT 1200
+#define AMPLITUDE 400
+// ambient light the dimming waveform starts at, and goes back to once it has dropped to AMBIENT
+#define DIMMING_START 3000
+// host timing runs of each waveform, the fastest counts
+#define HOST_RUNS 5
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// The light sensor waveforms
+enum class Waveform
+{
+    // ambient light with a little sensor noise
+    Steady,
+    // ambient light with a lot of sensor noise
+    Noisy,
+    // strong 100Hz mains flicker
+    Flicker,
+    // coded shots back to back, as many as the decoder gap allows
+    Shots,
+    // a lamp turning on and off: long runs over the threshold
+    Lamp,
+    // captures only, as the window passes them, with the ambient light dropping between shots
+    Dimming
+};
+
+// What the detection stage cost on a waveform, in MCLK cycles per sample
+struct BenchResult
+{
+    double Mean;
+    double WorstBatch;
+    // host nanoseconds per sample
+    double HostNs;
+    // frames the decoder finished, known shooter or not
+    uint32_t Shots;
+    // frames in the dimming waveform, which has to decode every one
+    uint32_t Sent;
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+
+static uint32_t randomState = 1;
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+static double uniform()
+{
+    // xorshift32
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return (randomState >> 8) / 16777216.0;
+}
+
+static double gaussian()
+{
+    double u = uniform();
+    double v = uniform();
+    if (u < 1e-12)
+    {
+        u = 1e-12;
+    }
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static const char* waveformName(Waveform waveform)
+{
+    switch (waveform)
+    {
+    case Waveform::Steady: return "steady";
+    case Waveform::Noisy: return "noisy";
+    case Waveform::Flicker: return "flicker";
+    case Waveform::Shots: return "shots";
+    case Waveform::Lamp: return "lamp";
+    case Waveform::Dimming: return "dimming";
+    }
+    return "?";
+}
+
+// Whether a shot starting at sample 0 lights the sensor at a sample: Manchester, a 1 is light then dark
+static bool shotLit(uint8_t shooter, uint32_t sample)
+{
+    uint8_t parity = 0;
+    for (uint8_t value = shooter; 0 != value; value >>= 1)
+    {
+        parity ^= value & 1;
+    }
+    uint8_t bits = (uint8_t)((1 << (SHOOTER_FRAME_BITS - 1)) | (shooter << 1) | parity);
+    uint32_t bit = sample / SAMPLES_PER_BIT;
+    bool first = (sample % SAMPLES_PER_BIT) < SHOOTER_HALF_BIT_SAMPLES;
+    bool one = 0 != ((bits >> (SHOOTER_FRAME_BITS - 1 - bit)) & 1);
+    return first == one;
+}
+
+static uint16_t adcValue(double light)
+{
+    long value = lround(light);
+    return (uint16_t)((value < 0) ? 0 : ((value > ADC_MAX) ? ADC_MAX : value));
+}
+
+// The dimming waveform: per shot an ambient sample, the frame, and the dark rest of the capture
+// @return uint32_t: whole frames in it
+static uint32_t makeDimming(uint32_t count, std::vector<uint16_t>& samples)
+{
+    uint32_t capture = 1 + SAMPLES_PER_FRAME + LIGHT_CAPTURE_SAMPLES;
+    double ambient = DIMMING_START;
+    uint32_t sent = 0;
+    samples.clear();
+    while (samples.size() + capture <= count)
+    {
+        uint8_t shooter = (uint8_t)(uniform() * (1 << SHOOTER_ID_BITS));
+        samples.push_back(adcValue(ambient + gaussian() * 4.0) | LIGHT_SAMPLE_AMBIENT);
+        for (uint32_t s = 0; s < SAMPLES_PER_FRAME + LIGHT_CAPTURE_SAMPLES; s++)
+        {
+            bool lit = (s < SAMPLES_PER_FRAME) && shotLit(shooter, s);
+            samples.push_back(adcValue(ambient + (lit ? AMPLITUDE : 0) + gaussian() * 4.0));
+        }
+        sent++;
+        ambient = (ambient - AMPLITUDE < AMBIENT) ? DIMMING_START : ambient - AMPLITUDE;
+    }
+    return sent;
+}
+
+static void makeWaveform(Waveform waveform, uint32_t count, std::vector<uint16_t>& samples)
+{
+    samples.clear();
+    // a shot and the dark gap the decoder needs before the next one
+    uint32_t shotPeriod = SAMPLES_PER_FRAME + SHOOTER_GAP_SAMPLES + 1;
+    uint8_t shooter = 0;
+    for (uint32_t s = 0; s < count; s++)
+    {
+        double light = AMBIENT;
+        switch (waveform)
+        {
+        case Waveform::Steady:
+            light += gaussian() * 2.0;
+            break;
+        case Waveform::Noisy:
+            light += gaussian() * 40.0;
+            break;
+        case Waveform::Flicker:
+            light += 60.0 * sin(2.0 * M_PI * 100.0 * s / SAMPLE_HZ) + gaussian() * 4.0;
+            break;
+        case Waveform::Shots:
+        {
+            // the gap first, so the detector starts on ambient light like it does after StartWindow()
+            uint32_t at = s % shotPeriod;
+            if (0 == at)
+            {
+                shooter = (uint8_t)(uniform() * (1 << SHOOTER_ID_BITS));
+            }
+            if ((at >= shotPeriod - SAMPLES_PER_FRAME) && shotLit(shooter, at - (shotPeriod - SAMPLES_PER_FRAME)))
+            {
+                light += AMPLITUDE;
+            }
+            light += gaussian() * 4.0;
+            break;
+        }
+        case Waveform::Lamp:
+            // on for a quarter of a second every second
+            if ((s % (uint32_t)SAMPLE_HZ) >= (uint32_t)(SAMPLE_HZ * 3 / 4))
+            {
+                light += AMPLITUDE;
+            }
+            light += gaussian() * 4.0;
+            break;
+        case Waveform::Dimming:
+            // makeDimming()
+            break;
+        }
+        samples.push_back(adcValue(light));
+    }
+}
+
+// Run the detection stage the way LightSensor::DetectHit() does, pricing every step.
+// @return uint32_t: frames the decoder finished
+static uint32_t detect(const std::vector<uint16_t>& samples, uint64_t& cycles, uint32_t& worstBatch)
+{
+    HitDetector detector;
+    ShooterDecoder decoder;
+    detector.Reset(samples[0] & ADC_MAX);
+    uint32_t shots = 0;
+    // samples into the frame being received
+    uint32_t frameSample = 0;
+    cycles = 0;
+    worstBatch = 0;
+
+    for (size_t first = 0; first < samples.size(); first += BATCH_SIZE)
+    {
+        size_t last = first + BATCH_SIZE;
+        if (last > samples.size())
+        {
+            last = samples.size();
+        }
+        uint32_t batch = CYCLES_PER_BATCH;
+        for (size_t i = first; i < last; i++)
+        {
+            if (0 != (samples[i] & LIGHT_SAMPLE_AMBIENT))
+            {
+                batch += CYCLES_AMBIENT;
+                detector.Rebase(samples[i] & ADC_MAX);
+                continue;
+            }
+
+            bool lit = detector.Update(samples[i]);
+            batch += lit ? CYCLES_HIT : (CYCLES_QUIET + CYCLES_THRESHOLD);
+
+            bool receiving = decoder.Receiving();
+            HitEvent event;
+            batch += CYCLES_DECODE;
+            bool done = decoder.Update(lit, event);
+            if (receiving || decoder.Receiving() || done)
+            {
+                if (0 == (++frameSample % SAMPLES_PER_BIT))
+                {
+                    batch += CYCLES_BIT;
+                }
+            }
+            if (done)
+            {
+                batch += CYCLES_FRAME;
+                frameSample = 0;
+                shots++;
+            }
+        }
+        cycles += batch;
+        // what DetectTicksPerSampleMax sees: the batch time over its sample count
+        uint32_t perSample = batch / (uint32_t)(last - first);
+        if (perSample > worstBatch)
+        {
+            worstBatch = perSample;
+        }
+    }
+    return shots;
+}
+
+static BenchResult bench(Waveform waveform, uint32_t count)
+{
+    std::vector<uint16_t> samples;
+    BenchResult result;
+    result.Sent = 0;
+    if (Waveform::Dimming == waveform)
+    {
+        result.Sent = makeDimming(count, samples);
+        count = (uint32_t)samples.size();
+    }
+    else
+    {
+        makeWaveform(waveform, count, samples);
+    }
+    uint64_t cycles;
+    uint32_t worstBatch;
+    result.Shots = detect(samples, cycles, worstBatch);
+    result.Mean = (double)cycles / count;
+    result.WorstBatch = worstBatch;
+
+    result.HostNs = 0.0;
+    for (int run = 0; run < HOST_RUNS; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        detect(samples, cycles, worstBatch);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+        if ((0 == run) || (ns < result.HostNs))
+        {
+            result.HostNs = ns;
+        }
+    }
+    return result;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: hitbench [-n samples] [-S seed]\n");
+    exit(2);
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+int main(int argc, char** argv)
+{
+    uint32_t count = DEFAULT_SAMPLES;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((i + 1 >= argc) || ('-' != argv[i][0]) || (0 != argv[i][2]))
+        {
+            usage();
+        }
+        uint32_t value = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        switch (argv[i - 1][1])
+        {
+        case 'n': count = value; break;
+        case 'S': seed = value; break;
+        default: usage();
+        }
+    }
+    if (0 == count)
+    {
+        usage();
+    }
+    randomState = (0 != seed) ? seed : 1;
+
+    double budget = MCLK_HZ / SAMPLE_HZ;
+    printf("%u samples per waveform, %.0f MCLK cycles between samples at %.0f samples/s\n",
+        count, budget, SAMPLE_HZ);
+    printf("waveform   cycles/sample  worst batch  worst ticks  host ns/sample  frames\n");
+
+    const Waveform waveforms[] = { Waveform::Steady, Waveform::Noisy, Waveform::Flicker, Waveform::Shots, Waveform::Lamp,
+        Waveform::Dimming };
+    bool fail = false;
+    bool lost = false;
+    for (Waveform waveform : waveforms)
+    {
+        BenchResult result = bench(waveform, count);
+        printf("%-10s %13.0f  %11.0f  %11.0f  %14.1f  %6u\n", waveformName(waveform), result.Mean,
+            result.WorstBatch, ceil(result.WorstBatch / CYCLES_PER_TICK), result.HostNs, result.Shots);
+        if (result.WorstBatch > budget)
+        {
+            fail = true;
+        }
+        if ((Waveform::Dimming == waveform) && (result.Shots != result.Sent))
+        {
+            printf("dimming: %u of %u shots decoded, the baseline did not follow the ambient light: FAIL\n",
+                result.Shots, result.Sent);
+            lost = true;
+        }
+    }
+    if (fail)
+    {
+        printf("a batch needs more MCLK than the samples it holds: FAIL\n");
+    }
+    return (fail || lost) ? 1 : 0;
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
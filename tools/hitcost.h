@@ -0,0 +1,77 @@
+/**
+* @brief      Target figures and detector cost model shared by the host hit detection tools
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    hitsim and hitbench run HitDetector and ShooterDecoder on the PC, so they cannot time them the way
+*               main_real.cpp does with DetectTicksPerSampleMax. They count what the detection stage did instead,
+*               and price each step in MCLK cycles with the model below.
+*               The sample rate and batch size come from LightSensor.h, which needs the stub msp430.h in
+*               tools/halorender on the include path.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+#pragma once
+#ifndef HIT_COST_H
+#define HIT_COST_H
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include "../LightSensor.h"
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// ACLK runs from REFO in main.cpp and main_real.cpp
+#define ACLK_HZ 32768.0
+#define SAMPLE_HZ (ACLK_HZ / LIGHT_SAMPLE_PERIOD)
+#define ADC_MAX LIGHT_ADC_MAX
+#define BATCH_SIZE LIGHT_BATCH_SIZE
+// main.cpp and main_real.cpp run MCLK at 16MHz
+#define MCLK_HZ 16000000.0
+// MCLK cycles per FRAME_TIMER tick: the timer runs at SMCLK/2, SMCLK is MCLK/8
+#define CYCLES_PER_TICK 16
+
+// Detector cost model, MCLK cycles. Rough figures for LightSensor::DetectHit() built with optimization on.
+// fixed cost of a batch: call, priming check, threshold copy for the window
+#define CYCLES_PER_BATCH 40
+// HitDetector::Update() of a sample below the threshold: 32 bit deviation, baseline and noise averages
+#define CYCLES_QUIET 90
+// HitDetector::Update() of a hit
+#define CYCLES_HIT 40
+// updateThreshold(): one multiply on MPY32. It runs whenever the noise average moves, which is nearly
+// every quiet sample, so the model charges it on all of them.
+#define CYCLES_THRESHOLD 30
+// HitDetector::Rebase() of an ambient sample between captures: mask, shift, store
+#define CYCLES_AMBIENT 15
+// ShooterDecoder::Update() of one sample
+#define CYCLES_DECODE 25
+// end of a bit, SHOOTER_FRAME_BITS of them a shot: margin and shift
+#define CYCLES_BIT 30
+// finish(): parity and confidence
+#define CYCLES_FRAME 60
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Classes declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+
+
+#endif // !HIT_COST_H
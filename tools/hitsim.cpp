@@ -0,0 +1,347 @@
+/**
+* @brief      Host side simulator for hit detection and shooter ID decoding
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Feeds synthetic light sensor waveforms through the same HitDetector and ShooterDecoder the target
+*               runs in LightSensor::DetectHit(), and reports how many shots were decoded to the right shooter.
+*
+*               Build on the PC:   g++ -std=c++14 -O2 -Itools/halorender -o hitsim tools/hitsim.cpp HitDetector.cpp ShooterDecoder.cpp
+*               Run:               hitsim [-n shots] [-a amplitude] [-N noise] [-j jitter] [-c clock] [-f flicker]
+*                                         [-u uncoded] [-S seed]
+*
+*               Every shot is a random shooter ID sent as a Manchester frame on top of the ambient light, with
+*               gaussian sensor noise, edge jitter, a laser clock that is off by up to -c percent, mains flicker
+*               and a random sampling phase. -u sends that fraction of shots as plain pulses from uncoded lasers,
+*               which should come out as SHOOTER_UNKNOWN.
+*
+*               The detector cycles are an estimate from the cost model in hitcost.h; tools/hitbench.cpp looks
+*               at the worst batch, and on the target main_real.cpp measures the real cost as DetectTicksPerSampleMax. Exits 1 if a shot decoded to the wrong shooter
+*               with a non-zero confidence, or the decoder needs more CPU than a capture can give it.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <vector>
+
+#include "../HitDetector.h"
+#include "../ShooterDecoder.h"
+#include "hitcost.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+#define SAMPLES_PER_BIT (2 * SHOOTER_HALF_BIT_SAMPLES)
+
+#define DEFAULT_SHOTS 1000
+#define DEFAULT_AMBIENT 1200
+#define DEFAULT_AMPLITUDE 400
+#define DEFAULT_NOISE 6.0
+// edge jitter, standard deviation in us
+#define DEFAULT_JITTER 40.0
+// laser bit clock error, up to this many percent either way
+#define DEFAULT_CLOCK 3.0
+// 100Hz flicker, ADC counts peak
+#define DEFAULT_FLICKER 10.0
+// dark time before and after a shot, in frames
+#define GAP_FRAMES_MIN 2
+#define GAP_FRAMES_MAX 6
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// A shot that was sent
+struct Shot
+{
+    // first and last sample of the shot
+    uint32_t First;
+    uint32_t Last;
+    uint8_t Shooter;
+    bool Coded;
+};
+
+// What came out for a shot
+struct Outcome
+{
+    uint32_t Shots;
+    uint32_t Correct;
+    uint32_t Unknown;
+    uint32_t Wrong;
+    uint32_t WrongConfident;
+    uint32_t Missed;
+    uint32_t ConfidenceSum;
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+
+static uint32_t randomState = 1;
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+static double uniform()
+{
+    // xorshift32
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return (randomState >> 8) / 16777216.0;
+}
+
+static double gaussian()
+{
+    double u = uniform();
+    double v = uniform();
+    if (u < 1e-12)
+    {
+        u = 1e-12;
+    }
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+// The frame bits of a shooter, first bit highest
+static uint8_t frameBits(uint8_t shooter)
+{
+    uint8_t parity = 0;
+    for (uint8_t value = shooter; 0 != value; value >>= 1)
+    {
+        parity ^= value & 1;
+    }
+    return (uint8_t)((1 << (SHOOTER_FRAME_BITS - 1)) | (shooter << 1) | parity);
+}
+
+// Light edges of a shot, in seconds from its start: on, off, on, off...
+static void shotEdges(const Shot& shot, double bitTime, double jitter, std::vector<double>& edges)
+{
+    edges.clear();
+    if (!shot.Coded)
+    {
+        edges.push_back(0.0);
+        edges.push_back(SHOOTER_FRAME_BITS * bitTime);
+        return;
+    }
+
+    uint8_t bits = frameBits(shot.Shooter);
+    bool lit = false;
+    for (int half = 0; half < 2 * SHOOTER_FRAME_BITS; half++)
+    {
+        int bit = (bits >> (SHOOTER_FRAME_BITS - 1 - half / 2)) & 1;
+        // a 1 is light then dark
+        bool on = (0 == (half & 1)) ? (1 == bit) : (0 == bit);
+        if (on != lit)
+        {
+            edges.push_back(half * bitTime / 2 + gaussian() * jitter);
+            lit = on;
+        }
+    }
+    if (lit)
+    {
+        edges.push_back(SHOOTER_FRAME_BITS * bitTime + gaussian() * jitter);
+    }
+}
+
+static void usage()
+{
+    fprintf(stderr,
+        "usage: hitsim [-n shots] [-a amplitude] [-N noise] [-j jitter_us] [-c clock_percent]\n"
+        "              [-f flicker] [-u uncoded_fraction] [-S seed]\n");
+    exit(2);
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+int main(int argc, char** argv)
+{
+    uint32_t shots = DEFAULT_SHOTS;
+    double amplitude = DEFAULT_AMPLITUDE;
+    double noise = DEFAULT_NOISE;
+    double jitter = DEFAULT_JITTER;
+    double clock = DEFAULT_CLOCK;
+    double flicker = DEFAULT_FLICKER;
+    double uncoded = 0.0;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((i + 1 >= argc) || ('-' != argv[i][0]) || (0 != argv[i][2]))
+        {
+            usage();
+        }
+        double value = atof(argv[++i]);
+        switch (argv[i - 1][1])
+        {
+        case 'n': shots = (uint32_t)value; break;
+        case 'a': amplitude = value; break;
+        case 'N': noise = value; break;
+        case 'j': jitter = value; break;
+        case 'c': clock = value; break;
+        case 'f': flicker = value; break;
+        case 'u': uncoded = value; break;
+        case 'S': seed = (uint32_t)value; break;
+        default: usage();
+        }
+    }
+    randomState = (0 != seed) ? seed : 1;
+
+    HitDetector detector;
+    ShooterDecoder decoder;
+    detector.Reset(DEFAULT_AMBIENT);
+
+    Outcome coded = {};
+    Outcome plain = {};
+    uint32_t falseShots = 0;
+    uint64_t cycles = 0;
+    uint32_t samples = 0;
+
+    std::vector<double> edges;
+    std::vector<uint16_t> batch;
+    double phase = uniform();
+    uint32_t sample = 0;
+    double frameTime = SHOOTER_FRAME_BITS * SAMPLES_PER_BIT / SAMPLE_HZ;
+
+    for (uint32_t n = 0; n < shots; n++)
+    {
+        Shot shot;
+        shot.Shooter = (uint8_t)(uniform() * (1 << SHOOTER_ID_BITS));
+        shot.Coded = uniform() >= uncoded;
+        double bitTime = (SAMPLES_PER_BIT / SAMPLE_HZ) * (1.0 + (2.0 * uniform() - 1.0) * clock / 100.0);
+        shotEdges(shot, bitTime, jitter / 1e6, edges);
+
+        uint32_t gap = (uint32_t)((GAP_FRAMES_MIN + uniform() * (GAP_FRAMES_MAX - GAP_FRAMES_MIN)) * frameTime * SAMPLE_HZ);
+        // the shot starts anywhere between two samples
+        double start = (sample + gap + uniform()) / SAMPLE_HZ;
+        shot.First = sample + gap;
+        shot.Last = (uint32_t)((start + edges.back()) * SAMPLE_HZ) + 1;
+        uint32_t end = shot.Last + gap;
+
+        Outcome& outcome = shot.Coded ? coded : plain;
+        outcome.Shots++;
+        bool decoded = false;
+
+        for (; sample < end; sample += BATCH_SIZE)
+        {
+            batch.clear();
+            for (uint32_t s = sample; s < sample + BATCH_SIZE; s++)
+            {
+                double t = (s + phase) / SAMPLE_HZ;
+                double light = DEFAULT_AMBIENT + flicker * sin(2.0 * M_PI * 100.0 * t) + gaussian() * noise;
+                bool on = false;
+                for (size_t e = 0; e < edges.size(); e++)
+                {
+                    if (t >= start + edges[e])
+                    {
+                        on = (0 == (e & 1));
+                    }
+                }
+                if (on)
+                {
+                    light += amplitude;
+                }
+                long value = lround(light);
+                batch.push_back((uint16_t)((value < 0) ? 0 : ((value > ADC_MAX) ? ADC_MAX : value)));
+            }
+
+            cycles += CYCLES_PER_BATCH;
+            for (uint32_t i = 0; i < batch.size(); i++)
+            {
+                bool lit = detector.Update(batch[i]);
+                cycles += lit ? CYCLES_HIT : (CYCLES_QUIET + CYCLES_THRESHOLD);
+
+                cycles += CYCLES_DECODE;
+                HitEvent event;
+                if (!decoder.Update(lit, event))
+                {
+                    continue;
+                }
+                cycles += SHOOTER_FRAME_BITS * CYCLES_BIT + CYCLES_FRAME;
+
+                uint32_t at = sample + i;
+                if (decoded || (at < shot.First))
+                {
+                    falseShots++;
+                    continue;
+                }
+                decoded = true;
+                if (SHOOTER_UNKNOWN == event.Shooter)
+                {
+                    outcome.Unknown++;
+                }
+                else if (shot.Coded && (event.Shooter == shot.Shooter))
+                {
+                    outcome.Correct++;
+                    outcome.ConfidenceSum += event.Confidence;
+                }
+                else
+                {
+                    outcome.Wrong++;
+                    outcome.WrongConfident += (0 != event.Confidence) ? 1 : 0;
+                }
+            }
+            samples += (uint32_t)batch.size();
+        }
+        if (!decoded)
+        {
+            outcome.Missed++;
+        }
+    }
+
+    printf("shots          %u coded, %u uncoded\n", coded.Shots, plain.Shots);
+    printf("coded          %u right shooter (%.1f%%), %u unknown, %u wrong (%u with confidence), %u missed\n",
+        coded.Correct, coded.Shots ? 100.0 * coded.Correct / coded.Shots : 0.0,
+        coded.Unknown, coded.Wrong, coded.WrongConfident, coded.Missed);
+    if (0 != coded.Correct)
+    {
+        printf("confidence     %.0f mean when right\n", (double)coded.ConfidenceSum / coded.Correct);
+    }
+    if (0 != plain.Shots)
+    {
+        printf("uncoded        %u unknown shooter, %u given a shooter (%u with confidence), %u missed\n",
+            plain.Unknown, plain.Wrong, plain.WrongConfident, plain.Missed);
+    }
+    printf("false shots    %u\n", falseShots);
+
+    double perSample = samples ? (double)cycles / samples : 0.0;
+    double budget = MCLK_HZ / SAMPLE_HZ;
+    printf("detector       %.0f cycles per sample (model), %.0f per sample at %.0f samples/s: %.0f%% of MCLK in a capture\n",
+        perSample, budget, SAMPLE_HZ, 100.0 * perSample / budget);
+
+    bool fail = (0 != coded.WrongConfident) || (0 != plain.WrongConfident) || (perSample > budget);
+    return fail ? 1 : 0;
+}
+
+/************************************************************************/
+/*                      Implementation (INTERRUPTS)                     */
+/************************************************************************/
@@ -0,0 +1,256 @@
+/**
+* @brief      Host side two thread stress test for SampleRing
+*
+* @copyright  Copyright (c) 2022 Bebop Arms. All rights reserved.
+*
+*
+* @details    Runs the SampleRing producer and consumer on two threads, the way the ADC ISR and the main loop
+*               share LightSensor::Samples, and checks that nothing is lost, duplicated or reordered.
+*
+*               Build on the PC:   g++ -std=c++14 -O2 -pthread -I. -o ringstress tools/ringstress.cpp
+*               Run:               ringstress [-n pushes] [-S seed]
+*
+*               The producer pushes a counting sequence in random bursts, the consumer pops random sized batches
+*               with random pauses, so the ring runs empty, full and everything in between, and the free running
+*               indexes wrap many times. The consumer checks the values it gets only ever go up, that every
+*               value it skipped was dropped by a full ring, and that NewOverruns() adds up to the drops the
+*               producer saw. Each ring size runs on its own: 2, LIGHT_RING_SIZE and the largest allowed.
+*
+*               On the MSP430 SampleRing relies on volatile alone. Threads on a host can see another core's stores
+*               out of order, so this defines SAMPLE_RING_RELEASE() and SAMPLE_RING_ACQUIRE() as thread fences,
+*               which GCC and Clang emit as barriers on weakly ordered hosts such as ARM. What the run checks is the
+*               index arithmetic and the order of the ring's accesses; the C++ memory model still calls volatile
+*               shared between threads a data race, so it is no proof of the fences. Exits 1 if any check fails.
+*
+* @link       TODO: Link to the article that describe your module in the
+*                   WIKI.
+**/
+
+/************************************************************************/
+/*                           Include section                            */
+/************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+
+// the producer and the consumer run on separate cores here, unlike the ISR and the main loop
+#define SAMPLE_RING_RELEASE() std::atomic_thread_fence(std::memory_order_release)
+#define SAMPLE_RING_ACQUIRE() std::atomic_thread_fence(std::memory_order_acquire)
+#include "SampleRing.h"
+
+/************************************************************************/
+/*                            Using section                             */
+/************************************************************************/
+
+/************************************************************************/
+/*                         #define declarations                         */
+/************************************************************************/
+
+// LightSensor.h LIGHT_RING_SIZE
+#define RING_SIZE 64
+// LightSensor.h LIGHT_BATCH_SIZE
+#define BATCH_SIZE 8
+
+#define DEFAULT_PUSHES 5000000
+// longest producer burst, in pushes
+#define BURST_MAX 200
+// longest pause of either side, in spin loops
+#define PAUSE_MAX 400
+
+/************************************************************************/
+/*                         Forward declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                     Data structures declarations                     */
+/************************************************************************/
+
+// What one side of a run saw
+struct RingResult
+{
+    // values the producer tried to push
+    uint32_t Pushes;
+    // Push() returned false
+    uint32_t Drops;
+    // values the consumer got
+    uint32_t Pops;
+    // values missing from the sequence the consumer got
+    uint32_t Skipped;
+    // sum of NewOverruns()
+    uint32_t Overruns;
+    // values that came out of order or twice
+    uint32_t Disordered;
+    // Count() above the ring size
+    uint32_t BadCounts;
+};
+
+/************************************************************************/
+/*                         Routine declarations                         */
+/************************************************************************/
+
+/************************************************************************/
+/*                        Variables declarations                        */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PRIVATE)                        */
+/************************************************************************/
+
+static uint32_t next(uint32_t& state)
+{
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static void pause(uint32_t loops)
+{
+    for (volatile uint32_t i = 0; i < loops; i++)
+    {
+    }
+}
+
+template <uint16_t Size>
+static bool run(uint32_t pushes, uint32_t seed)
+{
+    static SampleRing<uint32_t, Size> ring;
+    RingResult result = {};
+    std::atomic<bool> done(false);
+
+    // the producer stands in for the ADC ISR: it only pushes
+    std::thread producer([&]()
+    {
+        uint32_t state = seed;
+        uint32_t value = 1;
+        while (value <= pushes)
+        {
+            uint32_t burst = 1 + next(state) % BURST_MAX;
+            for (; (0 != burst) && (value <= pushes); burst--)
+            {
+                if (!ring.Push(value))
+                {
+                    // An ISR cannot wait, so the sample is gone. Let the consumer in before the next one,
+                    // so a single CPU host still interleaves the two sides, and NewOverruns() is read
+                    // long before the 16 bit overrun count wraps.
+                    result.Drops++;
+                    std::this_thread::yield();
+                }
+                value++;
+                if (0 == (next(state) & 7))
+                {
+                    pause(next(state) % PAUSE_MAX);
+                }
+            }
+            std::this_thread::yield();
+        }
+        result.Pushes = value - 1;
+        done = true;
+    });
+
+    // the consumer stands in for the main loop: it pops, counts and reads the overruns
+    uint32_t state = seed ^ 0x5A5A5A5A;
+    uint32_t last = 0;
+    uint32_t batch[BATCH_SIZE];
+    for (;;)
+    {
+        // read done first: once it is set, everything the producer pushed is in the ring
+        bool finished = done;
+        if (ring.Count() > Size)
+        {
+            result.BadCounts++;
+        }
+        uint16_t count = ring.Pop(batch, 1 + next(state) % BATCH_SIZE);
+        for (uint16_t i = 0; i < count; i++)
+        {
+            if (batch[i] <= last)
+            {
+                result.Disordered++;
+            }
+            else
+            {
+                result.Skipped += batch[i] - last - 1;
+            }
+            last = batch[i];
+        }
+        result.Pops += count;
+        result.Overruns += ring.NewOverruns();
+
+        if (finished && (0 == ring.Count()))
+        {
+            break;
+        }
+        if (0 == count)
+        {
+            std::this_thread::yield();
+        }
+        pause(next(state) % PAUSE_MAX);
+    }
+    producer.join();
+    result.Overruns += ring.NewOverruns();
+    // drops at the end of the sequence never show up as a gap
+    result.Skipped += result.Pushes - last;
+
+    bool good = (0 == result.Disordered) && (0 == result.BadCounts)
+        && (result.Pops + result.Drops == result.Pushes)
+        && (result.Skipped == result.Drops)
+        && (result.Overruns == result.Drops)
+        && (ring.Overruns == (uint16_t)result.Drops);
+
+    printf("ring %5u: %u pushed, %u popped, %u dropped, %u skipped, %u overruns reported, %u out of order%s\n",
+        (unsigned)Size, result.Pushes, result.Pops, result.Drops, result.Skipped, result.Overruns,
+        result.Disordered, good ? "" : "  FAIL");
+    if (0 != result.BadCounts)
+    {
+        printf("           Count() above the ring size %u times  FAIL\n", result.BadCounts);
+    }
+    return good;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: ringstress [-n pushes] [-S seed]\n");
+    exit(2);
+}
+
+/************************************************************************/
+/*                      Implementation (PROTECTED)                      */
+/************************************************************************/
+
+/************************************************************************/
+/*                      Implementation (PUBLIC)                         */
+/************************************************************************/
+
+int main(int argc, char** argv)
+{
+    uint32_t pushes = DEFAULT_PUSHES;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((i + 1 >= argc) || ('-' != argv[i][0]) || (0 != argv[i][2]))
+        {
+            usage();
+        }
+        uint32_t value = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        switch (argv[i - 1][1])
+        {
+        case 'n': pushes = value; break;
+        case 'S': seed = value; break;
+        default: usage();
+        }
+    }
+    if (0 == seed)
+    {
+        seed = 1;
+    }
+
+    bool good = run<2>(pushes, seed);
+    good &= run<RING_SIZE>(pushes, seed);
+    good &= run<0x8000>(pushes, seed);
+    return good ? 0 : 1;
+}